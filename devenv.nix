@@ -75,6 +75,12 @@ in {
       genshades
     '';
 
+    genwasmthreads.exec = ''
+      export EM_CACHE=$PWD/.cache
+      emcmake cmake -B ./build -DCMAKE_TOOLCHAIN_FILE=$EMROOT/cmake/Modules/Platform/Emscripten.cmake -DCMAKE_BUILD_TYPE=Release -DCTRI_WEB_THREADS=ON
+      genshades
+    '';
+
     build.exec = ''
       cmake --build ./build -j $(nproc)
     '';
@@ -0,0 +1,22 @@
+#version 300 es  
+// Instanced Vertex Shader
+
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec4 aColor;
+// xy: position, zw: forward axis (direction scaled by size)
+layout(location = 2) in vec4 aInstance;
+layout(location = 3) in vec4 aInstanceColor;
+
+uniform mat4 uVP;
+uniform vec4 uColor;
+
+out vec4 vColor;
+
+void main() {
+    vec2 forward = aInstance.zw;
+    vec2 side = vec2(-forward.y, forward.x);
+    vec2 position = aInstance.xy + forward * aPosition.x + side * aPosition.y;
+
+    vColor = aColor * aInstanceColor * uColor;
+    gl_Position = uVP * vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,73 @@
+#include "ailod.h"
+#include "trace.h"
+
+void g_ai_lod_init(g_ai_lod *lod) {
+    *lod = (g_ai_lod){
+        .level_distance = {16.0f, 32.0f, 64.0f},
+    };
+}
+
+// Append the due actors of view to out, returns the count.
+static size_t g_ai_lod_collect(g_ai_lod *lod, const g_actor_stack *stack,
+                               const stable_index_view *view,
+                               const float *player_position, uint64_t tick,
+                               uint32_t interval, float fixed_dt,
+                               stable_index_t *out) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < view->size; i++) {
+        const stable_index_t idx = view->indices[i];
+
+        uint32_t level = 0;
+        if (player_position != NULL) {
+            const float *position = stack->transforms[idx].position;
+            const float dx = position[0] - player_position[0];
+            const float dy = position[1] - player_position[1];
+            const float distance2 = dx * dx + dy * dy;
+
+            while (level < G_AI_LOD_LEVELS - 1 &&
+                   distance2 >= lod->level_distance[level] *
+                                    lod->level_distance[level]) {
+                level++;
+            }
+        }
+        lod->level_counts[level]++;
+
+        // Offset by index, so each tick takes an even share of a level
+        const uint32_t period = interval << level;
+        if ((tick + idx) % period != 0) {
+            continue;
+        }
+
+        out[count++] = idx;
+        lod->dt[idx] = fixed_dt * period;
+        lod->merged += period - 1;
+    }
+
+    lod->updates += count;
+    return count;
+}
+
+void g_ai_lod_plan(g_ai_lod *lod, g_actor_stack *stack,
+                   stable_index_handle player, uint64_t tick,
+                   uint32_t interval, float fixed_dt) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "ai_lod_plan");
+
+    const float *player_position =
+        g_actor_stack_valid(stack, player)
+            ? stack->transforms[player.index].position
+            : NULL;
+
+    for (size_t l = 0; l < G_AI_LOD_LEVELS; l++) {
+        lod->level_counts[l] = 0;
+    }
+
+    lod->enemy_count =
+        g_ai_lod_collect(lod, stack, stack->enemy_view, player_position,
+                         tick, interval, fixed_dt, lod->enemies);
+    lod->ally_count =
+        g_ai_lod_collect(lod, stack, stack->ally_view, player_position, tick,
+                         interval, fixed_dt, lod->allies);
+
+    G_TRACE_END(G_TRACE_SYSTEM, "ai_lod_plan");
+}
@@ -0,0 +1,44 @@
+// AI level of detail. Enemies and allies far from the player run their
+// steering every few ticks with a scaled dt, staggered by actor index so
+// every tick updates about the same share of them.
+#ifndef AILOD_H
+#define AILOD_H
+
+#include "common.h"
+
+#define G_AI_LOD_LEVELS 4
+
+typedef struct g_ai_lod {
+    // Distance from the player where levels 1 and up start. Level l
+    // updates every 2^l ticks.
+    float level_distance[G_AI_LOD_LEVELS - 1];
+
+    // Actors due this tick, by view
+    stable_index_t enemies[MAX_G_ACTORS];
+    size_t enemy_count;
+    stable_index_t allies[MAX_G_ACTORS];
+    size_t ally_count;
+
+    // Nominal update period of the due actors, by actor index. Not the time
+    // since their last update, which differs right after their level or
+    // the interval changed.
+    float dt[MAX_G_ACTORS];
+
+    // Actors per level as of the last plan
+    size_t level_counts[G_AI_LOD_LEVELS];
+
+    // Counters
+    uint64_t updates;
+    // Actor updates folded into a later, longer one
+    uint64_t merged;
+} g_ai_lod;
+
+void g_ai_lod_init(g_ai_lod *lod);
+
+// Collect the enemies and allies due on tick. interval, the scheduler's AI
+// interval, scales every level's. Everything is due without a player.
+void g_ai_lod_plan(g_ai_lod *lod, g_actor_stack *stack,
+                   stable_index_handle player, uint64_t tick,
+                   uint32_t interval, float fixed_dt);
+
+#endif
@@ -0,0 +1,136 @@
+#include "alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const g_alloc_tag_names[G_ALLOC_TAG_COUNT] = {
+    [G_ALLOC_TAG_INDEX] = "index",
+    [G_ALLOC_TAG_ACTORS] = "actors",
+    [G_ALLOC_TAG_MESHES] = "meshes",
+    [G_ALLOC_TAG_FRAME] = "frame",
+    [G_ALLOC_TAG_SCRATCH] = "scratch",
+    [G_ALLOC_TAG_REWIND] = "rewind",
+    [G_ALLOC_TAG_OTHER] = "other",
+};
+
+// Without common.h, the index tests build this alone
+static inline size_t g_alloc_max(size_t a, size_t b) { return a > b ? a : b; }
+
+static inline size_t g_align_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+static void *g_heap_alloc(void *user, size_t size, size_t align) {
+    (void)user;
+
+#ifdef _MSC_VER
+    return _aligned_malloc(size, align);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    return aligned_alloc(align, g_align_up(size, align));
+#endif
+}
+
+static void g_heap_free(void *user, void *ptr, size_t size, size_t align) {
+    (void)user;
+    (void)size;
+    (void)align;
+
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+g_allocator g_heap_allocator = {
+    .alloc = g_heap_alloc,
+    .free = g_heap_free,
+};
+
+void *g_alloc(g_allocator *allocator, enum g_alloc_tag tag, size_t size,
+              size_t align) {
+    g_alloc_stats *stats = &allocator->stats[tag];
+
+    // Never ask the backend for nothing, NULL means failure
+    void *ptr = allocator->alloc(allocator->user, g_alloc_max(size, 1),
+                                 g_alloc_max(align, sizeof(void *)));
+    if (ptr == NULL) {
+        printf("Couldn't allocate %zu bytes for %s, %llu bytes live!\n", size,
+               g_alloc_tag_names[tag], (unsigned long long)stats->live);
+        stats->failures++;
+        return NULL;
+    }
+
+    stats->live += size;
+    if (stats->live > stats->peak) {
+        stats->peak = stats->live;
+    }
+    stats->allocations++;
+
+    return ptr;
+}
+
+void g_free(g_allocator *allocator, enum g_alloc_tag tag, void *ptr,
+            size_t size, size_t align) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    allocator->free(allocator->user, ptr, g_alloc_max(size, 1),
+                    g_alloc_max(align, sizeof(void *)));
+    allocator->stats[tag].live -= size;
+}
+
+void *g_realloc(g_allocator *allocator, enum g_alloc_tag tag, void *ptr,
+                size_t old_size, size_t size, size_t align) {
+    void *moved = g_alloc(allocator, tag, size, align);
+    if (moved == NULL) {
+        return NULL;
+    }
+
+    if (ptr != NULL) {
+        memcpy(moved, ptr, old_size < size ? old_size : size);
+        g_free(allocator, tag, ptr, old_size, align);
+    }
+
+    return moved;
+}
+
+size_t g_alloc_soa_size(size_t count, const g_alloc_soa_array *arrays,
+                        size_t array_count) {
+    size_t size = 0;
+    for (size_t i = 0; i < array_count; i++) {
+        size += g_align_up(arrays[i].element_size * count, G_ALLOC_SOA_ALIGN);
+    }
+
+    return size;
+}
+
+void *g_alloc_soa(g_allocator *allocator, enum g_alloc_tag tag, size_t count,
+                  const g_alloc_soa_array *arrays, size_t array_count) {
+    uint8_t *block =
+        g_alloc(allocator, tag, g_alloc_soa_size(count, arrays, array_count),
+                G_ALLOC_SOA_ALIGN);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < array_count; i++) {
+        *arrays[i].array = block + offset;
+        offset += g_align_up(arrays[i].element_size * count, G_ALLOC_SOA_ALIGN);
+    }
+
+    return block;
+}
+
+uint64_t g_alloc_live(const g_allocator *allocator) {
+    uint64_t live = 0;
+    for (size_t t = 0; t < G_ALLOC_TAG_COUNT; t++) {
+        live += allocator->stats[t].live;
+    }
+
+    return live;
+}
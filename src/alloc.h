@@ -0,0 +1,81 @@
+// Pluggable allocation with per subsystem accounting. Like the rest of the
+// simulation, an allocator is used from one thread at a time.
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Who an allocation is accounted to
+enum g_alloc_tag : uint8_t {
+    G_ALLOC_TAG_INDEX,
+    G_ALLOC_TAG_ACTORS,
+    G_ALLOC_TAG_MESHES,
+    // Frame and tick arenas
+    G_ALLOC_TAG_FRAME,
+    // Per thread scratch arenas, each with its own allocator
+    G_ALLOC_TAG_SCRATCH,
+    // Rewind history
+    G_ALLOC_TAG_REWIND,
+    G_ALLOC_TAG_OTHER,
+    G_ALLOC_TAG_COUNT,
+};
+
+extern const char *const g_alloc_tag_names[G_ALLOC_TAG_COUNT];
+
+// Every SoA array starts on a cache line
+#define G_ALLOC_SOA_ALIGN 64
+
+typedef struct {
+    uint64_t live;
+    uint64_t peak;
+    uint64_t allocations;
+    uint64_t failures;
+} g_alloc_stats;
+
+typedef struct g_allocator {
+    // Backend, align is a power of two. Returns NULL on failure.
+    void *(*alloc)(void *user, size_t size, size_t align);
+    // Gets the size and align ptr was allocated with.
+    void (*free)(void *user, void *ptr, size_t size, size_t align);
+    void *user;
+
+    g_alloc_stats stats[G_ALLOC_TAG_COUNT];
+} g_allocator;
+
+// The C heap, through aligned_alloc.
+extern g_allocator g_heap_allocator;
+
+// Allocate and account size bytes to tag, reports and returns NULL on
+// failure.
+void *g_alloc(g_allocator *allocator, enum g_alloc_tag tag, size_t size,
+              size_t align);
+
+// Size and align must match the g_alloc call, NULL is ignored.
+void g_free(g_allocator *allocator, enum g_alloc_tag tag, void *ptr,
+            size_t size, size_t align);
+
+// Move to a new allocation of size bytes, keeping the common prefix. Leaves
+// ptr untouched and returns NULL on failure.
+void *g_realloc(g_allocator *allocator, enum g_alloc_tag tag, void *ptr,
+                size_t old_size, size_t size, size_t align);
+
+// One array of a SoA allocation, *array is pointed at count elements.
+typedef struct {
+    void **array;
+    size_t element_size;
+} g_alloc_soa_array;
+
+// Bytes of a SoA block of count elements per array.
+size_t g_alloc_soa_size(size_t count, const g_alloc_soa_array *arrays,
+                        size_t array_count);
+
+// Allocate every array in one block, each G_ALLOC_SOA_ALIGN aligned. Free the
+// returned block with g_free and g_alloc_soa_size.
+void *g_alloc_soa(g_allocator *allocator, enum g_alloc_tag tag, size_t count,
+                  const g_alloc_soa_array *arrays, size_t array_count);
+
+// Live bytes over every tag.
+uint64_t g_alloc_live(const g_allocator *allocator);
+
+#endif
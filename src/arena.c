@@ -0,0 +1,127 @@
+#include "arena.h"
+
+// Pool blocks are aligned like max_align_t on every supported target
+#define G_POOL_ALIGN 16
+
+static _Thread_local g_allocator g_scratch_allocator;
+static _Thread_local g_arena g_scratch_arena;
+
+bool g_arena_init(g_arena *arena, g_allocator *allocator,
+                  enum g_alloc_tag tag, size_t capacity) {
+    *arena = (g_arena){
+        .base = g_alloc(allocator, tag, capacity, G_ALLOC_SOA_ALIGN),
+        .capacity = capacity,
+        .allocator = allocator,
+        .tag = tag,
+    };
+
+    return arena->base != NULL;
+}
+
+void g_arena_delete(g_arena *arena) {
+    g_free(arena->allocator, arena->tag, arena->base, arena->capacity,
+           G_ALLOC_SOA_ALIGN);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+void *g_arena_push(g_arena *arena, size_t size, size_t align) {
+    const uintptr_t base = (uintptr_t)arena->base;
+    const uintptr_t start = (base + arena->used + align - 1) & ~(align - 1);
+    const size_t end = start - base + size;
+
+    if (end > arena->capacity) {
+        arena->failures++;
+        return NULL;
+    }
+
+    arena->used = end;
+    if (end > arena->peak) {
+        arena->peak = end;
+    }
+
+    return (void *)start;
+}
+
+g_arena *g_scratch(void) {
+    if (g_scratch_arena.base != NULL) {
+        return &g_scratch_arena;
+    }
+
+    // The shared allocator's counters aren't thread safe, account each
+    // thread's scratch on its own
+    g_scratch_allocator = (g_allocator){
+        .alloc = g_heap_allocator.alloc,
+        .free = g_heap_allocator.free,
+        .user = g_heap_allocator.user,
+    };
+
+    if (!g_arena_init(&g_scratch_arena, &g_scratch_allocator,
+                      G_ALLOC_TAG_SCRATCH, G_SCRATCH_SIZE)) {
+        return NULL;
+    }
+
+    return &g_scratch_arena;
+}
+
+void g_scratch_release(void) {
+    if (g_scratch_arena.base != NULL) {
+        g_arena_delete(&g_scratch_arena);
+    }
+}
+
+bool g_pool_init(g_pool *pool, g_allocator *allocator, enum g_alloc_tag tag,
+                 size_t block_size, size_t capacity) {
+    // Free blocks hold a pointer, so never empty
+    block_size = block_size > 0 ? block_size : 1;
+    block_size = (block_size + G_POOL_ALIGN - 1) & ~(size_t)(G_POOL_ALIGN - 1);
+
+    *pool = (g_pool){
+        .base = g_alloc(allocator, tag, block_size * capacity,
+                        G_ALLOC_SOA_ALIGN),
+        .block_size = block_size,
+        .capacity = capacity,
+        .allocator = allocator,
+        .tag = tag,
+    };
+
+    if (pool->base == NULL) {
+        return false;
+    }
+
+    // Threaded back to front, so blocks are handed out in address order
+    for (size_t i = capacity; i > 0; i--) {
+        void *block = pool->base + block_size * (i - 1);
+        *(void **)block = pool->free;
+        pool->free = block;
+    }
+
+    return true;
+}
+
+void g_pool_delete(g_pool *pool) {
+    g_free(pool->allocator, pool->tag, pool->base,
+           pool->block_size * pool->capacity, G_ALLOC_SOA_ALIGN);
+    pool->base = NULL;
+    pool->free = NULL;
+    pool->live = 0;
+}
+
+void *g_pool_alloc(g_pool *pool) {
+    void *block = pool->free;
+    if (block == NULL) {
+        return NULL;
+    }
+
+    pool->free = *(void **)block;
+    pool->live++;
+
+    return block;
+}
+
+void g_pool_free(g_pool *pool, void *block) {
+    *(void **)block = pool->free;
+    pool->free = block;
+    pool->live--;
+}
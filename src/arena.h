@@ -0,0 +1,81 @@
+// Linear arenas for transient data and fixed size pools for long lived
+// objects, both carved out of one g_allocator allocation.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "alloc.h"
+
+// Scratch arena of every thread, see g_scratch
+#define G_SCRATCH_SIZE ((size_t)1 << 20)
+
+// Bump allocation from one block, freed all at once by a reset or rewind.
+typedef struct {
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+    // High water mark, for sizing
+    size_t peak;
+    // Pushes that didn't fit
+    uint64_t failures;
+
+    g_allocator *allocator;
+    enum g_alloc_tag tag;
+} g_arena;
+
+// Returns false if out of memory.
+bool g_arena_init(g_arena *arena, g_allocator *allocator,
+                  enum g_alloc_tag tag, size_t capacity);
+void g_arena_delete(g_arena *arena);
+
+// Uninitialized memory valid until the arena is reset or rewound past it.
+// Returns NULL once full, align is a power of two.
+void *g_arena_push(g_arena *arena, size_t size, size_t align);
+
+#define g_arena_push_array(arena, type, count)                                 \
+    ((type *)g_arena_push((arena), sizeof(type) * (count), alignof(type)))
+
+static inline size_t g_arena_mark(const g_arena *arena) {
+    return arena->used;
+}
+
+// Drop everything pushed since mark.
+static inline void g_arena_rewind(g_arena *arena, size_t mark) {
+    arena->used = mark;
+}
+
+static inline void g_arena_reset(g_arena *arena) { arena->used = 0; }
+
+// The calling thread's scratch arena, created on first use with an allocator
+// of its own. Nobody resets it, rewind to a mark taken before use instead.
+// NULL if out of memory.
+g_arena *g_scratch(void);
+
+// Free the calling thread's scratch arena, before a worker thread exits.
+void g_scratch_release(void);
+
+// Fixed size blocks threaded on a free list, for objects of a bounded count.
+typedef struct {
+    uint8_t *base;
+    size_t block_size;
+    size_t capacity;
+    // First free block, each free block starts with the next
+    void *free;
+    size_t live;
+
+    g_allocator *allocator;
+    enum g_alloc_tag tag;
+} g_pool;
+
+// Blocks are rounded up to 16 bytes and aligned as much. Returns false if
+// out of memory.
+bool g_pool_init(g_pool *pool, g_allocator *allocator, enum g_alloc_tag tag,
+                 size_t block_size, size_t capacity);
+void g_pool_delete(g_pool *pool);
+
+// Uninitialized block, NULL once every block is live.
+void *g_pool_alloc(g_pool *pool);
+
+// Return a block from g_pool_alloc.
+void g_pool_free(g_pool *pool, void *block);
+
+#endif
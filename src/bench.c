@@ -0,0 +1,319 @@
+// Scripted scenario benchmarks on sokol_gfx's dummy backend. Every scenario
+// runs at each actor count and reports per stage ns/tick and ticks/s as JSON,
+// so builds can be compared.
+#define SOKOL_IMPL
+#include <sokol/sokol_gfx.h>
+#include <sokol/sokol_log.h>
+#include <sokol/sokol_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "world.h"
+
+// Untimed ticks before measuring
+#define G_BENCH_WARMUP 8
+#define G_BENCH_MAX_COUNTS 16
+
+static g_world world;
+
+typedef enum {
+    G_BENCH_SPARSE,
+    G_BENCH_ALLY_BALL,
+    G_BENCH_SWARM,
+    G_BENCH_CHURN,
+    G_BENCH_SHAPES,
+    G_BENCH_SCENARIO_COUNT,
+} g_bench_scenario;
+
+static const char *const g_bench_names[G_BENCH_SCENARIO_COUNT] = {
+    [G_BENCH_SPARSE] = "sparse",
+    [G_BENCH_ALLY_BALL] = "ally_ball",
+    [G_BENCH_SWARM] = "swarm",
+    [G_BENCH_CHURN] = "churn",
+    [G_BENCH_SHAPES] = "shapes",
+};
+
+static void usage(const char *name) {
+    printf("usage: %s [--scenario NAME] [--counts N,N,...] [--ticks N] "
+           "[--seconds S] [--seed N] [--out PATH]\n"
+           "scenarios: sparse, ally_ball, swarm, churn, shapes "
+           "(default: all)\n",
+           name);
+}
+
+static stable_index_handle g_bench_spawn(g_rng *rng,
+                                         enum g_actor_type type,
+                                         float x, float y) {
+    const bool ally = type & ACTOR_TYPE_ALLY;
+
+    return g_actor_stack_create(
+        &world.actors,
+        &(g_actor_stack_create_ctx){
+            .color = {ally ? 0.0f : 1.0f, 0.0f, ally ? 1.0f : 0.0f, 1.0f},
+            .type = type | ACTOR_TYPE_ALIVE,
+            .transform.z = -1.0f,
+            .transform.position = {x, y},
+            .transform.rotation = rand_float(rng, -GLM_PIf, GLM_PIf),
+            .transform.scale = {ally ? 0.5f : 1.0f, ally ? 0.5f : 1.0f},
+            .drag = 4.0f,
+            .mass = ally ? 0.25f : 1.0f,
+        });
+}
+
+// Uniform over a square holding about one actor per 36 square units.
+static void g_bench_spawn_sparse(g_rng *rng, enum g_actor_type type,
+                                 size_t count, float half) {
+    for (size_t i = 0; i < count; i++) {
+        g_bench_spawn(rng, type, rand_float(rng, -half, half),
+                      rand_float(rng, -half, half));
+    }
+}
+
+// Replace the default actors with the scenario's, count including the
+// player. Returns false if out of memory.
+static bool g_bench_setup(g_bench_scenario scenario, size_t count,
+                          uint64_t seed) {
+    if (!g_world_init(&world, &g_heap_allocator, seed)) {
+        return false;
+    }
+    world.scheduler.adaptive = false;
+    world.player.input_map.fire = true;
+
+    const stable_index_view *alive = world.actors.alive_view;
+    for (size_t i = alive->size; i > 0; i--) {
+        const stable_index_t idx = alive->indices[i - 1];
+
+        if (idx != world.player.actor_handle.index) {
+            g_actor_stack_remove(
+                &world.actors,
+                (stable_index_handle){
+                    .index = idx,
+                    .generation = world.actors.actor_index.generations[idx],
+                });
+        }
+    }
+
+    g_rng rng;
+    g_rng_seed(&rng, seed);
+
+    const size_t n = count - 1;
+    const float half = sqrtf((float)n) * 3.0f;
+
+    switch (scenario) {
+    case G_BENCH_SPARSE:
+        g_bench_spawn_sparse(&rng, ACTOR_TYPE_ENEMY, n / 2, half);
+        g_bench_spawn_sparse(&rng, 0, n - n / 2, half);
+        break;
+    case G_BENCH_ALLY_BALL:
+        for (size_t i = 0; i < n; i++) {
+            const float angle = rand_float(&rng, -GLM_PIf, GLM_PIf);
+            const float r = sqrtf(rand_float(&rng, 0.0f, 1.0f)) *
+                            sqrtf((float)n) * 0.4f;
+            g_bench_spawn(&rng, ACTOR_TYPE_ALLY, cosf(angle) * r,
+                          sinf(angle) * r);
+        }
+        break;
+    case G_BENCH_SWARM:
+    // The swarm cycling through the built in shapes
+    case G_BENCH_SHAPES:
+        for (size_t i = 0; i < n; i++) {
+            const float angle = rand_float(&rng, -GLM_PIf, GLM_PIf);
+            const float r = 20.0f + rand_float(&rng, 0.0f, sqrtf((float)n));
+            const stable_index_handle handle =
+                g_bench_spawn(&rng, ACTOR_TYPE_ENEMY, cosf(angle) * r,
+                              sinf(angle) * r);
+
+            if (scenario == G_BENCH_SHAPES) {
+                world.actors.shapes[handle.index] =
+                    (g_shape_id)(i % G_SHAPE_BUILTIN_COUNT);
+            }
+        }
+        break;
+    case G_BENCH_CHURN:
+        g_bench_spawn_sparse(&rng, ACTOR_TYPE_ENEMY, n / 2, half);
+        g_bench_spawn_sparse(&rng, ACTOR_TYPE_ALLY, n - n / 2, half);
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+// Despawn and respawn 1/32 of the actors, keeping the count.
+static void g_bench_churn(g_rng *rng, size_t count) {
+    const stable_index_view *alive = world.actors.alive_view;
+    const size_t churn = max((count - 1) / 32, (size_t)1);
+    const float half = sqrtf((float)count) * 3.0f;
+
+    for (size_t i = 0; i < churn && alive->size > 1; i++) {
+        const stable_index_t idx =
+            alive->indices[g_rng_next(rng) % alive->size];
+
+        if (idx == world.player.actor_handle.index) {
+            continue;
+        }
+
+        g_actor_stack_remove(
+            &world.actors,
+            (stable_index_handle){
+                .index = idx,
+                .generation = world.actors.actor_index.generations[idx],
+            });
+    }
+
+    while (alive->size < count) {
+        g_bench_spawn(rng, g_rng_next(rng) & 1 ? ACTOR_TYPE_ALLY
+                                               : ACTOR_TYPE_ENEMY,
+                      rand_float(rng, -half, half),
+                      rand_float(rng, -half, half));
+    }
+}
+
+static bool g_bench_run(FILE *out, bool *first, g_bench_scenario scenario,
+                        size_t count, uint64_t max_ticks, double max_seconds,
+                        uint64_t seed) {
+    if (!g_bench_setup(scenario, count, seed)) {
+        return false;
+    }
+
+    g_rng rng;
+    g_rng_seed(&rng, seed ^ 0x5bd1e995u);
+
+    for (int i = 0; i < G_BENCH_WARMUP; i++) {
+        g_world_update(g_fixed_dt, &world);
+    }
+
+    uint64_t stage_start[G_WORLD_STAGE_COUNT];
+    memcpy(stage_start, world.stage_time, sizeof(stage_start));
+
+    uint64_t churn_time = 0;
+    uint64_t ticks = 0;
+    const uint64_t start = stm_now();
+
+    // At least one tick, the biggest counts can take seconds each
+    do {
+        if (scenario == G_BENCH_CHURN) {
+            const uint64_t churn_start = stm_now();
+            g_bench_churn(&rng, count);
+            churn_time += stm_since(churn_start);
+        }
+
+        g_world_update(g_fixed_dt, &world);
+        ticks++;
+    } while (ticks < max_ticks && stm_sec(stm_since(start)) < max_seconds);
+
+    const uint64_t elapsed = stm_since(start);
+
+    fprintf(out,
+            "%s  {\"scenario\": \"%s\", \"actors\": %zu, \"alive\": %u, "
+            "\"ticks\": %llu, \"ticks_per_sec\": %.2f, \"ns_per_tick\": {",
+            *first ? "" : ",\n", g_bench_names[scenario], count,
+            world.actors.alive_view->size, (unsigned long long)ticks,
+            ticks / stm_sec(elapsed));
+    *first = false;
+
+    for (size_t s = 0; s < G_WORLD_STAGE_COUNT; s++) {
+        fprintf(out, "\"%s\": %.1f, ", g_world_stage_names[s],
+                stm_ns(world.stage_time[s] - stage_start[s]) / ticks);
+    }
+    if (scenario == G_BENCH_CHURN) {
+        fprintf(out, "\"churn\": %.1f, ", stm_ns(churn_time) / ticks);
+    }
+    fprintf(out, "\"total\": %.1f}}", stm_ns(elapsed) / ticks);
+    fflush(out);
+
+    g_world_delete(&world);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    size_t counts[G_BENCH_MAX_COUNTS] = {100, 1000, 10000};
+    size_t count_size = 3;
+    int only = -1;
+    uint64_t max_ticks = 256;
+    double max_seconds = 2.0;
+    uint64_t seed = 1;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+            for (int s = 0; s < G_BENCH_SCENARIO_COUNT; s++) {
+                if (strcmp(name, g_bench_names[s]) == 0) {
+                    only = s;
+                }
+            }
+            if (only < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--counts") == 0 && i + 1 < argc) {
+            count_size = 0;
+            for (char *s = argv[++i]; *s != '\0' &&
+                                      count_size < G_BENCH_MAX_COUNTS;) {
+                counts[count_size++] = strtoull(s, &s, 10);
+                s += *s == ',';
+            }
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            max_ticks = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            max_seconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t c = 0; c < count_size; c++) {
+        if (counts[c] < 2 || counts[c] > MAX_G_ACTORS) {
+            printf("Actor counts must be within [2, %zu]!\n",
+                   (size_t)MAX_G_ACTORS);
+            return 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+        printf("Couldn't open %s!\n", out_path);
+        return 1;
+    }
+
+    sg_setup(&(sg_desc){
+        .logger.func = slog_func,
+    });
+    stm_setup();
+
+    fprintf(out, "{\"max_actors\": %zu, \"results\": [\n",
+            (size_t)MAX_G_ACTORS);
+
+    bool first = true;
+    for (int s = 0; s < G_BENCH_SCENARIO_COUNT; s++) {
+        if (only >= 0 && s != only) {
+            continue;
+        }
+
+        for (size_t c = 0; c < count_size; c++) {
+            if (!g_bench_run(out, &first, (g_bench_scenario)s, counts[c],
+                             max_ticks, max_seconds, seed)) {
+                return 1;
+            }
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    sg_shutdown();
+
+    return 0;
+}
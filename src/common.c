@@ -1,8 +1,11 @@
 #include "common.h"
+#include "ailod.h"
+#include "fastmath.h"
+#include "flow.h"
+#include "formation.h"
+#include "spatial.h"
 
 #include <cglm/affine-post.h>
-#include <minitrace/minitrace.h>
-#include <sokol/sokol_app.h>
 #include <sokol/sokol_gfx.h>
 #include <sokol/sokol_time.h>
 
@@ -11,25 +14,38 @@
 #include <string.h>
 #include <time.h>
 
-g_static_meshes g_static_meshes_init(size_t capacity) {
-    g_static_meshes meshes;
+static size_t g_static_meshes_arrays(g_static_meshes *meshes,
+                                     g_alloc_soa_array *arrays) {
+    arrays[0] = (g_alloc_soa_array){(void **)&meshes->bindings,
+                                    sizeof(sg_bindings)};
+    arrays[1] = (g_alloc_soa_array){(void **)&meshes->transforms,
+                                    sizeof(mat4)};
+    arrays[2] = (g_alloc_soa_array){(void **)&meshes->sizes, sizeof(size_t)};
+    arrays[3] = (g_alloc_soa_array){(void **)&meshes->aabbs,
+                                    sizeof(vec2[2])};
+    arrays[4] = (g_alloc_soa_array){(void **)&meshes->vertices,
+                                    sizeof(g_vertex *)};
+    arrays[5] = (g_alloc_soa_array){(void **)&meshes->owned, sizeof(bool)};
+    return 6;
+}
 
-    meshes.bindings = malloc(sizeof(sg_bindings) * capacity);
-    meshes.transforms = malloc(sizeof(mat4) * capacity);
-    meshes.sizes = malloc(sizeof(size_t) * capacity);
-    meshes.size = 0;
-    meshes.capacity = capacity;
+bool g_static_meshes_init(g_static_meshes *meshes, g_allocator *allocator,
+                          size_t capacity) {
+    *meshes = (g_static_meshes){
+        .capacity = capacity,
+        .allocator = allocator,
+    };
 
-    return meshes;
-}
+    g_alloc_soa_array arrays[6];
+    meshes->block = g_alloc_soa(allocator, G_ALLOC_TAG_MESHES, capacity,
+                                arrays, g_static_meshes_arrays(meshes, arrays));
 
-size_t g_static_meshes_add(g_static_meshes *meshes, mat4 transform,
-                           g_vertex *vertices, size_t num_vertices) {
-    if (meshes->size >= meshes->capacity) {
-        printf("Reached g_static_meshes capacity!");
-        sapp_quit();
-    }
+    return meshes->block != NULL;
+}
 
+static size_t g_static_meshes_push(g_static_meshes *meshes, mat4 transform,
+                                   const g_vertex *vertices,
+                                   size_t num_vertices, bool owned) {
     size_t idx = meshes->size;
     meshes->size++;
 
@@ -46,20 +62,122 @@ size_t g_static_meshes_add(g_static_meshes *meshes, mat4 transform,
     glm_mat4_copy(transform, meshes->transforms[idx]);
 
     meshes->sizes[idx] = num_vertices;
+    meshes->vertices[idx] = vertices;
+    meshes->owned[idx] = owned;
+    meshes->vertex_count += num_vertices;
+
+    vec2 *aabb = meshes->aabbs[idx];
+    glm_aabb2d_invalidate(aabb);
+    for (size_t i = 0; i < num_vertices; i++) {
+        vec4 p = {vertices[i].x, vertices[i].y, 0.0f, 1.0f};
+        glm_mat4_mulv(transform, p, p);
+        glm_vec2_minv(aabb[0], p, aabb[0]);
+        glm_vec2_maxv(aabb[1], p, aabb[1]);
+    }
 
     return idx;
 }
 
+size_t g_static_meshes_add(g_static_meshes *meshes, mat4 transform,
+                           const g_vertex *vertices, size_t num_vertices) {
+    if (meshes->size >= meshes->capacity) {
+        printf("Reached g_static_meshes capacity!\n");
+        return SIZE_MAX;
+    }
+
+    g_vertex *copy = g_alloc(meshes->allocator, G_ALLOC_TAG_MESHES,
+                             sizeof(g_vertex) * num_vertices,
+                             alignof(g_vertex));
+    if (copy == NULL) {
+        return SIZE_MAX;
+    }
+    memcpy(copy, vertices, sizeof(g_vertex) * num_vertices);
+
+    return g_static_meshes_push(meshes, transform, copy, num_vertices, true);
+}
+
+size_t g_static_meshes_add_borrowed(g_static_meshes *meshes, mat4 transform,
+                                    const g_vertex *vertices,
+                                    size_t num_vertices) {
+    if (meshes->size >= meshes->capacity) {
+        printf("Reached g_static_meshes capacity!\n");
+        return SIZE_MAX;
+    }
+
+    return g_static_meshes_push(meshes, transform, vertices, num_vertices,
+                                false);
+}
+
+void g_static_meshes_clear(g_static_meshes *meshes) {
+    for (size_t i = 0; i < meshes->size; i++) {
+        sg_destroy_buffer(meshes->bindings[i].vertex_buffers[0]);
+
+        if (meshes->owned[i]) {
+            g_free(meshes->allocator, G_ALLOC_TAG_MESHES,
+                   (void *)meshes->vertices[i],
+                   sizeof(g_vertex) * meshes->sizes[i], alignof(g_vertex));
+        }
+    }
+
+    meshes->size = 0;
+    meshes->vertex_count = 0;
+}
+
 void g_static_meshes_delete(g_static_meshes *meshes) {
-    free(meshes->bindings);
-    free(meshes->transforms);
-    free(meshes->sizes);
+    if (meshes->block == NULL) {
+        return;
+    }
+
+    g_static_meshes_clear(meshes);
+
+    g_alloc_soa_array arrays[6];
+    g_free(meshes->allocator, G_ALLOC_TAG_MESHES, meshes->block,
+           g_alloc_soa_size(meshes->capacity, arrays,
+                            g_static_meshes_arrays(meshes, arrays)),
+           G_ALLOC_SOA_ALIGN);
+
+    meshes->block = NULL;
 }
 
 bool g_actor_type_hostility(enum g_actor_type at) { return at >> 1 == 1; }
 
-void g_actor_stack_init(g_actor_stack *stack) {
-    stable_index_init(&stack->actor_index, MAX_G_ACTORS, 8);
+static size_t g_actor_stack_arrays(g_actor_stack *stack,
+                                   g_alloc_soa_array *arrays) {
+    arrays[0] = (g_alloc_soa_array){(void **)&stack->colors, sizeof(vec4)};
+    arrays[1] = (g_alloc_soa_array){(void **)&stack->transforms,
+                                    sizeof(g_transform)};
+    arrays[2] = (g_alloc_soa_array){(void **)&stack->global_transforms,
+                                    sizeof(mat4)};
+    arrays[3] = (g_alloc_soa_array){(void **)&stack->velocities,
+                                    sizeof(g_velocity)};
+    arrays[4] = (g_alloc_soa_array){(void **)&stack->drag, sizeof(float)};
+    arrays[5] = (g_alloc_soa_array){(void **)&stack->mass, sizeof(float)};
+    arrays[6] = (g_alloc_soa_array){(void **)&stack->shapes,
+                                    sizeof(g_shape_id)};
+    arrays[7] = (g_alloc_soa_array){(void **)&stack->poses,
+                                    sizeof(g_shape_pose)};
+    return 8;
+}
+
+bool g_actor_stack_init(g_actor_stack *stack, g_allocator *allocator) {
+    *stack = (g_actor_stack){.allocator = allocator};
+
+    g_shapes_init();
+
+    g_alloc_soa_array arrays[8];
+    stack->block = g_alloc_soa(allocator, G_ALLOC_TAG_ACTORS, MAX_G_ACTORS,
+                               arrays, g_actor_stack_arrays(stack, arrays));
+
+    if (stack->block == NULL ||
+        !stable_index_init(&stack->actor_index, allocator, MAX_G_ACTORS, 8)) {
+        g_actor_stack_delete(stack);
+        return false;
+    }
+
+    // Never read before written, but keeps snapshots of fresh slots stable
+    memset(stack->block, 0,
+           g_alloc_soa_size(MAX_G_ACTORS, arrays,
+                            g_actor_stack_arrays(stack, arrays)));
 
     stack->alive_view =
         stable_index_add_view(&stack->actor_index, ACTOR_TYPE_ALIVE);
@@ -69,6 +187,12 @@ void g_actor_stack_init(g_actor_stack *stack) {
 
     stack->ally_view = stable_index_add_view(
         &stack->actor_index, ACTOR_TYPE_ALLY | ACTOR_TYPE_ALIVE);
+
+    stack->pairs_tested = 0;
+    stack->contacts = 0;
+
+    return stack->alive_view != NULL && stack->enemy_view != NULL &&
+           stack->ally_view != NULL;
 }
 
 stable_index_handle g_actor_stack_create(g_actor_stack *stack,
@@ -82,6 +206,7 @@ stable_index_handle g_actor_stack_create(g_actor_stack *stack,
         stack->velocities[handle.index] = ctx->velocity;
         stack->drag[handle.index] = ctx->drag;
         stack->mass[handle.index] = ctx->mass;
+        stack->shapes[handle.index] = ctx->shape;
     }
 
     return handle;
@@ -102,134 +227,6 @@ const vec2 g_unit_triangle[3] = {
     {-0.25f, -0.433f},
 };
 
-static inline void calculate_normal(vec2 p1, vec2 p2, vec2 out) {
-    vec2 d;
-    glm_vec2_sub(p2, p1, d);
-    glm_vec2_normalize(d);
-    out[0] = d[1];
-    out[1] = -d[0];
-}
-
-static inline bool triangle_axis_overlap(vec2 t1[3], vec2 norm, vec2 t2[3],
-                                         float *overlap_min,
-                                         float *overlap_max) {
-    float t2_min = FLT_MAX;
-    float t2_max = -FLT_MAX;
-
-    float t1_min = FLT_MAX;
-    float t1_max = -FLT_MAX;
-
-    for (int i = 0; i < 3; i++) {
-        float t1_p = glm_vec2_dot(t1[i], norm);
-        float t2_p = glm_vec2_dot(t2[i], norm);
-
-        t1_min = glm_min(t1_min, t1_p);
-        t1_max = glm_max(t1_max, t1_p);
-
-        t2_min = glm_min(t2_min, t2_p);
-        t2_max = glm_max(t2_max, t2_p);
-    }
-
-    if (t2_max >= t1_min && t1_max >= t2_min) {
-        *overlap_min = max(t1_min, t2_min);
-        *overlap_max = min(t1_max, t2_max);
-
-        return true;
-    }
-
-    return false;
-}
-
-// Calculate the overlap of two seperate ranges
-static inline float get_overlap(float min_a, float max_a, float min_b,
-                                float max_b) {
-    return glm_min(max_a, max_b) - glm_max(min_a, min_b);
-}
-
-typedef struct {
-    bool intersection;
-    // Whether or not the intersection normal originates from the first triangle
-    bool first;
-    float overlap;
-    vec2 normal;
-} g_phys_intersection_res;
-
-// Test two triangles for physics interactions
-void g_phys_intersection(vec2 p1, vec2 p2, vec2 t1[3], vec2 t2[3],
-                         g_phys_intersection_res *result) {
-    vec2 norm1[3];
-    vec2 norm2[3];
-
-    for (int i = 0; i < 3; i++) {
-        int j = (i + 1) - 3 * (i == 2);
-
-        calculate_normal(t1[i], t1[j], norm1[i]);
-        calculate_normal(t2[i], t2[j], norm2[i]);
-    }
-
-    vec2 overlap_normal;
-
-    g_phys_intersection_res res;
-    res.intersection = true;
-    res.overlap = FLT_MAX;
-    res.first = true;
-
-    for (int i = 0; i < 3; i++) {
-        float current_overlap_min = FLT_MAX;
-        float current_overlap_max = -FLT_MAX;
-
-        bool overlap = triangle_axis_overlap(
-            t1, norm1[i], t2, &current_overlap_min, &current_overlap_max);
-
-        if (overlap &&
-            current_overlap_max - current_overlap_min < res.overlap) {
-            res.overlap = current_overlap_max - current_overlap_min;
-            glm_vec2_copy(norm1[i], overlap_normal);
-
-        } else if (!overlap) {
-            res.intersection = false;
-            *result = res;
-            return;
-        }
-    }
-
-    for (int i = 0; i < 3; i++) {
-        float current_overlap_min = FLT_MAX;
-        float current_overlap_max = -FLT_MAX;
-
-        bool overlap = triangle_axis_overlap(
-            t2, norm2[i], t1, &current_overlap_min, &current_overlap_max);
-
-        if (overlap &&
-            current_overlap_max - current_overlap_min < res.overlap) {
-            res.overlap = current_overlap_max - current_overlap_min;
-            glm_vec2_copy(norm2[i], overlap_normal);
-
-            res.first = false;
-
-        } else if (!overlap) {
-            res.intersection = false;
-            *result = res;
-            return;
-        }
-    }
-
-    vec2 dir;
-
-    if (res.first) {
-        glm_vec2_sub(p2, p1, dir);
-    } else {
-        glm_vec2_sub(p1, p2, dir);
-    }
-
-    if (glm_vec2_dot(overlap_normal, dir) < 0) {
-        res.first = !res.first;
-    }
-
-    glm_vec2_copy(overlap_normal, res.normal);
-    *result = res;
-}
-
 static inline void g_vec2_mirror(vec2 n, vec2 v) {
     const float dot = glm_vec2_dot(v, n);
     glm_vec2_mulsubs(n, (2.0f * dot) * (dot < 0.0f), v);
@@ -238,53 +235,58 @@ static inline void g_vec2_mirror(vec2 n, vec2 v) {
 // Crappy naive collision detection and response (for now)
 // ... What the fuck is this 'broad phase' you speak of???
 void g_actor_stack_phys(float dt, g_actor_stack *stack) {
-    static vec2 t1[3];
-    static vec2 t2[3];
-    static vec3 t = {0.0f, 0.0f, 1.0f};
-    static vec3 to;
-    static mat3 m1, m2;
-
+    const stable_index_mask_t *masks = stack->actor_index.masks;
     const stable_index_view *alive = stack->alive_view;
+
+    // Only positions change below, so every shape is rotated once
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+        const g_transform *transform = &stack->transforms[idx];
+
+        g_shape_orient(g_shape_get(stack->shapes[idx]), transform->rotation,
+                       transform->scale, &stack->poses[idx]);
+    }
+
     for (int i = 0; i < alive->size - 1; i++) {
         for (int j = i + 1; j < alive->size; j++) {
             const stable_index_t idx1 = alive->indices[i];
             const stable_index_t idx2 =
                 alive->indices[j % stack->actor_index.capacity];
 
+            // Allies keep apart by steering, see g_ally_update
+            if (stable_index_mask_contains(masks[idx1], ACTOR_TYPE_ALLY) &&
+                stable_index_mask_contains(masks[idx2], ACTOR_TYPE_ALLY)) {
+                continue;
+            }
+
             g_transform *tr1 = &stack->transforms[idx1];
             g_transform *tr2 = &stack->transforms[idx2];
+            const g_shape_pose *pose1 = &stack->poses[idx1];
+            const g_shape_pose *pose2 = &stack->poses[idx2];
 
-            glm_mat3_identity(m1);
-            glm_mat3_identity(m2);
-            g_transform_model_2d(tr1, &m1);
-            g_transform_model_2d(tr2, &m2);
-
-            for (int i = 0; i < 3; i++) {
-                t[0] = g_unit_triangle[i][0];
-                t[1] = g_unit_triangle[i][1];
-
-                glm_mat3_mulv(m1, t, to);
-                t1[i][0] = to[0];
-                t1[i][1] = to[1];
+            vec2 offset;
+            glm_vec2_sub(tr2->position, tr1->position, offset);
 
-                glm_mat3_mulv(m2, t, to);
-                t2[i][0] = to[0];
-                t2[i][1] = to[1];
+            // Bounding circles apart
+            const float reach = pose1->radius + pose2->radius;
+            if (glm_vec2_norm2(offset) > reach * reach) {
+                continue;
             }
 
             // Detection and response
-            g_phys_intersection_res res;
-            g_phys_intersection(tr1->position, tr2->position, t1, t2, &res);
+            g_shape_contact res;
+            g_shape_collide(pose1, pose2, offset, &res);
+            stack->pairs_tested++;
 
             if (res.intersection) {
-                const stable_index_t i1 = res.first ? idx1 : idx2;
-                const stable_index_t i2 = res.first ? idx2 : idx1;
+                stack->contacts++;
 
-                g_velocity *v1 = &stack->velocities[i1];
-                g_velocity *v2 = &stack->velocities[i2];
+                // The normal points from the first actor to the second
+                g_velocity *v1 = &stack->velocities[idx1];
+                g_velocity *v2 = &stack->velocities[idx2];
 
-                float mass1 = stack->mass[i1];
-                float mass2 = stack->mass[i2];
+                float mass1 = stack->mass[idx1];
+                float mass2 = stack->mass[idx2];
 
                 float inv_mass1 = (mass1 > 0) ? 1.0f / mass1 : 0.0f;
                 float inv_mass2 = (mass2 > 0) ? 1.0f / mass2 : 0.0f;
@@ -345,82 +347,76 @@ void g_actor_stack_phys(float dt, g_actor_stack *stack) {
 }
 
 void g_actor_stack_transform(g_actor_stack *stack, float fixed_overstep) {
-    const stable_index_view *alive = stack->alive_view;
-    for (size_t i = 0; i < alive->size; i++) {
-        stable_index_t index = alive->indices[i];
-
-        g_velocity *velocity = &stack->velocities[index];
-        g_transform *transform = &stack->transforms[index];
+    const g_f4 overstep = g_f4_set1(fixed_overstep);
 
-        g_transform lerped_transform = (g_transform){
-            .rotation = transform->rotation,
-            .z = transform->z,
-        };
-
-        glm_vec2_copy(transform->position, lerped_transform.position);
-        glm_vec2_copy(transform->scale, lerped_transform.scale);
-        glm_vec2_muladds(velocity->linear, fixed_overstep,
-                         lerped_transform.position);
+    // Same matrix as g_transform_model, with the rotations 4 at a time
+    const stable_index_view *alive = stack->alive_view;
+    for (size_t i = 0; i < alive->size; i += 4) {
+        const size_t lanes = min(alive->size - i, (size_t)4);
 
-        lerped_transform.rotation += velocity->angular * fixed_overstep;
+        float rotation[4] = {0}, angular[4] = {0};
+        for (size_t k = 0; k < lanes; k++) {
+            const stable_index_t index = alive->indices[i + k];
 
-        mat4 *global_transform = &stack->global_transforms[index];
+            rotation[k] = stack->transforms[index].rotation;
+            angular[k] = stack->velocities[index].angular;
+        }
 
-        mat4 t = GLM_MAT4_IDENTITY_INIT;
-        g_transform_model(&lerped_transform, &t);
-        glm_mat4_copy(t, *global_transform);
+        g_f4 s, c;
+        g_f4_sincos(g_f4_add(g_f4_load(rotation),
+                             g_f4_mul(g_f4_load(angular), overstep)),
+                    &s, &c);
+
+        float sines[4], cosines[4];
+        g_f4_store(sines, s);
+        g_f4_store(cosines, c);
+
+        for (size_t k = 0; k < lanes; k++) {
+            const stable_index_t index = alive->indices[i + k];
+
+            const g_velocity *velocity = &stack->velocities[index];
+            const g_transform *transform = &stack->transforms[index];
+            const float sx = transform->scale[0];
+            const float sy = transform->scale[1];
+
+            // Rotation times scale, the z axis is scaled to zero
+            mat4 *m = &stack->global_transforms[index];
+            glm_mat4_zero(*m);
+            (*m)[0][0] = cosines[k] * sx;
+            (*m)[0][1] = sines[k] * sx;
+            (*m)[1][0] = -sines[k] * sy;
+            (*m)[1][1] = cosines[k] * sy;
+            (*m)[3][0] = transform->position[0] +
+                         velocity->linear[0] * fixed_overstep;
+            (*m)[3][1] = transform->position[1] +
+                         velocity->linear[1] * fixed_overstep;
+            (*m)[3][2] = transform->z;
+            (*m)[3][3] = 1.0f;
+        }
     }
 }
 
 void g_actor_stack_delete(g_actor_stack *stack) {
     stable_index_delete(&stack->actor_index);
-}
 
-void g_player_input_map(const sapp_event *event, g_input_map *imap) {
-    bool update_dir = false;
-    if (event->type == SAPP_EVENTTYPE_UNFOCUSED) {
-        imap->left = false;
-        imap->right = false;
-        imap->up = false;
-        imap->down = false;
-
-        update_dir = true;
-    } else if (event->type == SAPP_EVENTTYPE_KEY_DOWN ||
-               event->type == SAPP_EVENTTYPE_KEY_UP) {
-        bool val = event->type == SAPP_EVENTTYPE_KEY_DOWN;
-
-        if (event->key_code == SAPP_KEYCODE_A) {
-            imap->left = val;
-        } else if (event->key_code == SAPP_KEYCODE_D) {
-            imap->right = val;
-        } else if (event->key_code == SAPP_KEYCODE_W) {
-            imap->up = val;
-        } else if (event->key_code == SAPP_KEYCODE_S) {
-            imap->down = val;
-        }
-        update_dir = true;
-    }
+    g_alloc_soa_array arrays[8];
+    g_free(stack->allocator, G_ALLOC_TAG_ACTORS, stack->block,
+           g_alloc_soa_size(MAX_G_ACTORS, arrays,
+                            g_actor_stack_arrays(stack, arrays)),
+           G_ALLOC_SOA_ALIGN);
+    stack->block = NULL;
+}
 
-    if (update_dir) {
-        imap->direction[0] = 1.0f * imap->right - 1.0f * imap->left;
-        imap->direction[1] = 1.0f * imap->up - 1.0f * imap->down;
+void g_input_map_direction(g_input_map *imap) {
+    imap->direction[0] = 1.0f * imap->right - 1.0f * imap->left;
+    imap->direction[1] = 1.0f * imap->up - 1.0f * imap->down;
 
-        if (!glm_vec2_eq_eps(imap->direction, 0.0f)) {
-            float len = glm_vec2_norm(imap->direction);
-            glm_vec2_divs(imap->direction, len, imap->direction);
-        }
+    if (!glm_vec2_eq_eps(imap->direction, 0.0f)) {
+        float len = glm_vec2_norm(imap->direction);
+        glm_vec2_divs(imap->direction, len, imap->direction);
     }
 }
 
-static inline float wrapMax(float x, float max) {
-    /* integer math: `(max + x % max) % max` */
-    return fmodf(max + fmodf(x, max), max);
-}
-/* wrap x -> [min,max) */
-static inline float wrapMinMax(float x, float min, float max) {
-    return min + wrapMax(x - min, max - min);
-}
-
 void g_player_update(float dt, g_player *player, g_actor_stack *stack,
                      g_camera *camera) {
     if (!g_actor_stack_valid(stack, player->actor_handle)) {
@@ -441,58 +437,87 @@ void g_player_update(float dt, g_player *player, g_actor_stack *stack,
     glm_vec2_sub(dir_to_cam, transform->position, dir_to_cam);
     glm_vec2_normalize(dir_to_cam);
 
-    vel->angular =
-        wrapMinMax(atan2(dir_to_cam[1], dir_to_cam[0]) - transform->rotation,
-                   -M_PI, M_PI) *
-        20.0f;
+    vel->angular = g_wrap_anglef(g_atan2f(dir_to_cam[1], dir_to_cam[0]) -
+                                 transform->rotation) *
+                   20.0f;
 
     // transform->rotation = atan2(dir_to_cam[1], dir_to_cam[0]);
 }
 
-void g_ally_update(float dt, g_actor_stack *stack,
-                   stable_index_handle player_handle) {
+void g_ally_update(const g_ai_lod *lod, g_actor_stack *stack,
+                   stable_index_handle player_handle, g_formation *formation,
+                   g_actor_grid *grid) {
     if (!g_actor_stack_valid(stack, player_handle)) {
         printf("No player actor!");
         return;
     }
 
-    float r = 1.0f;
-    float c = r * M_PI * 2;
-    int n = (int)(c / 2.0f);
-    int ci = 0;
+    g_formation_assign(formation, stack);
 
     g_transform *player_transform = &stack->transforms[player_handle.index];
 
-    stable_index_view *allies = stack->ally_view;
-    for (int i = 0; i < allies->size; i++) {
-        stable_index_t idx = allies->indices[i];
+    // Every due ally is a member once assigned
+    for (size_t i = 0; i < lod->ally_count; i++) {
+        const stable_index_t idx = lod->allies[i];
+        const float dt = lod->dt[idx];
 
         g_transform *transform = &stack->transforms[idx];
-
-        if (i >= n) {
-            r += 1.0f;
-            c = r * M_PI * 2;
-            n = (int)(c / 2.0f);
-            ci = 0;
-        }
-
-        vec2 target_pos = {r * cos(ci * (M_PI / n)), r * sin(ci * (M_PI / n))};
-        ci++;
-
         g_velocity *vel = &stack->velocities[idx];
 
+        vec2 target_pos;
+        glm_vec2_add(player_transform->position,
+                     formation->offsets[formation->slots[idx]], target_pos);
+
         vec2 dir;
         glm_vec2_sub(target_pos, transform->position, dir);
-        float len = glm_min(g_vec2_length(dir) * 10.0f, 10.0f);
 
-        if (len > 0.0001f) {
+        if (glm_vec2_norm2(dir) > 0.0001f) {
             glm_vec2_muladds(dir, dt, vel->linear);
         }
+
+        // Push away from everything closer than the separation radius,
+        // harder the closer it is
+        vec2 rect[2] = {
+            {transform->position[0] - G_FORMATION_SEPARATION,
+             transform->position[1] - G_FORMATION_SEPARATION},
+            {transform->position[0] + G_FORMATION_SEPARATION,
+             transform->position[1] + G_FORMATION_SEPARATION},
+        };
+
+        stable_index_t neighbours[G_FORMATION_NEIGHBOURS];
+        const size_t count = g_actor_grid_query_rect(grid, rect, neighbours,
+                                                     G_FORMATION_NEIGHBOURS);
+
+        vec2 push = GLM_VEC2_ZERO_INIT;
+        for (size_t n = 0; n < count; n++) {
+            if (neighbours[n] == idx) {
+                continue;
+            }
+
+            vec2 away;
+            glm_vec2_sub(transform->position,
+                         stack->transforms[neighbours[n]].position, away);
+
+            const float distance2 = glm_vec2_norm2(away);
+            if (distance2 >= G_FORMATION_SEPARATION * G_FORMATION_SEPARATION ||
+                distance2 < 0.000001f) {
+                continue;
+            }
+
+            const float distance = sqrtf(distance2);
+            glm_vec2_muladds(away,
+                             (G_FORMATION_SEPARATION - distance) /
+                                 (G_FORMATION_SEPARATION * distance),
+                             push);
+        }
+
+        glm_vec2_muladds(push, G_FORMATION_SEPARATION_GAIN * dt, vel->linear);
     }
 }
 
-void g_enemy_update(float dt, g_actor_stack *stack,
-                    stable_index_handle player_handle) {
+void g_enemy_update(const g_ai_lod *lod, g_actor_stack *stack,
+                    stable_index_handle player_handle,
+                    const g_flow_field *flow) {
     if (!g_actor_stack_valid(stack, player_handle)) {
         printf("No player actor!");
         return;
@@ -500,62 +525,78 @@ void g_enemy_update(float dt, g_actor_stack *stack,
 
     g_transform *player_transform = &stack->transforms[player_handle.index];
 
-    stable_index_view *enemies = stack->enemy_view;
-    for (int i = 0; i < enemies->size; i++) {
-        size_t idx = enemies->indices[i];
-
-        g_velocity *vel = &stack->velocities[idx];
-        g_transform *transform = &stack->transforms[idx];
-
-        vel->angular =
-            wrapMinMax(
-                atan2f(player_transform->position[1] - transform->position[1],
-                       player_transform->position[0] - transform->position[0]) -
-                    transform->rotation,
-                -M_PI, M_PI) *
-            5.0f;
-
-        vel->linear[0] +=
-            (cosf(transform->rotation) * 10.0f - vel->linear[0]) * dt * 5.0f;
-        vel->linear[1] +=
-            (sinf(transform->rotation) * 10.0f - vel->linear[1]) * dt * 5.0f;
-    }
-}
+    const g_f4 zero = g_f4_set1(0.0f);
+    const g_f4 speed = g_f4_set1(10.0f);
 
-// --------------------------------- g_camera ---------------------------------
+    // Gather 4 due enemies at a time, padding the last batch with zeros
+    for (size_t i = 0; i < lod->enemy_count; i += 4) {
+        const size_t lanes = min(lod->enemy_count - i, (size_t)4);
 
-void g_camera_mouse(const sapp_event *event, g_camera *camera) {
-    if (event->type == SAPP_EVENTTYPE_MOUSE_MOVE) {
-        vec2 mouse_pos;
-        glm_vec2((vec2){event->mouse_x, event->mouse_y}, mouse_pos);
-        glm_vec2_copy(mouse_pos, camera->mouse_pos);
+        float dx[4] = {0}, dy[4] = {0}, rotation[4] = {0};
+        float vx[4] = {0}, vy[4] = {0}, dt[4] = {0};
+        float flow_heading[4] = {0}, has_flow[4] = {0};
 
-        vec2 norm_mouse_pos;
-        glm_vec2_div(mouse_pos, (vec2){sapp_widthf(), sapp_heightf()},
-                     norm_mouse_pos);
+        for (size_t k = 0; k < lanes; k++) {
+            const stable_index_t idx = lod->enemies[i + k];
+            const g_transform *transform = &stack->transforms[idx];
 
-        float aspect = sapp_widthf() / sapp_heightf();
+            dx[k] = player_transform->position[0] - transform->position[0];
+            dy[k] = player_transform->position[1] - transform->position[1];
+            rotation[k] = transform->rotation;
+            vx[k] = stack->velocities[idx].linear[0];
+            vy[k] = stack->velocities[idx].linear[1];
+            dt[k] = lod->dt[idx];
 
-        float w = camera->view_height * aspect;
-        float h = camera->view_height;
-
-        float hw = w * 0.5f;
-        float hh = h * 0.5f;
-
-        float mx = -hw + w * norm_mouse_pos[0];
-        float my = hh - h * norm_mouse_pos[1];
+            const uint8_t dir = g_flow_field_sample(flow, transform->position);
+            if (dir != G_FLOW_NONE) {
+                flow_heading[k] = g_flow_angles[dir];
+                has_flow[k] = 1.0f;
+            }
+        }
 
-        // TODO: Move world position logic into update().
-        glm_vec2((vec2){mx, my}, camera->mouse_world_pos);
+        // Along the flow field, or straight at the player where it has no
+        // direction
+        const g_f4 heading =
+            g_f4_select(g_f4_gt(g_f4_load(has_flow), zero),
+                        g_f4_load(flow_heading),
+                        g_f4_atan2(g_f4_load(dy), g_f4_load(dx)));
+
+        const g_f4 rot = g_f4_load(rotation);
+        const g_f4 angular = g_f4_mul(
+            g_f4_wrap_angle(g_f4_sub(heading, rot)), g_f4_set1(5.0f));
+
+        g_f4 fwd_y, fwd_x;
+        g_f4_sincos(rot, &fwd_y, &fwd_x);
+
+        const g_f4 rate = g_f4_mul(g_f4_load(dt), g_f4_set1(5.0f));
+        g_f4 lx = g_f4_load(vx);
+        g_f4 ly = g_f4_load(vy);
+        lx = g_f4_add(lx, g_f4_mul(g_f4_sub(g_f4_mul(fwd_x, speed), lx), rate));
+        ly = g_f4_add(ly, g_f4_mul(g_f4_sub(g_f4_mul(fwd_y, speed), ly), rate));
+
+        float out_angular[4];
+        g_f4_store(out_angular, angular);
+        g_f4_store(vx, lx);
+        g_f4_store(vy, ly);
+
+        for (size_t k = 0; k < lanes; k++) {
+            g_velocity *vel = &stack->velocities[lod->enemies[i + k]];
+
+            vel->angular = out_angular[k];
+            vel->linear[0] = vx[k];
+            vel->linear[1] = vy[k];
+        }
     }
 }
 
+// --------------------------------- g_camera ---------------------------------
+
 void g_camera_update(g_player *player, g_actor_stack *stack, float dt,
                      g_camera *camera) {
 
     if (!g_actor_stack_valid(stack, player->actor_handle)) {
         printf("No player actor!");
-        sapp_quit();
+        return;
     }
 
     size_t index = player->actor_handle.index;
@@ -576,3 +617,13 @@ void g_camera_proj(const g_camera *camera, const float aspect, mat4 proj) {
 
     glm_ortho(-hw, hw, -hh, hh, -10.0f, 10.0, proj);
 }
+
+void g_camera_rect(const g_camera *camera, const float aspect, vec2 rect[2]) {
+    const float hh = camera->view_height * 0.5f;
+    const float hw = (camera->view_height * aspect) * 0.5f;
+
+    rect[0][0] = camera->position[0] - hw;
+    rect[0][1] = camera->position[1] - hh;
+    rect[1][0] = camera->position[0] + hw;
+    rect[1][1] = camera->position[1] + hh;
+}
@@ -2,6 +2,7 @@
 #define COMMON_H
 
 #include "index.h"
+#include "shape.h"
 
 #include <cglm/cglm.h>
 
@@ -40,11 +41,54 @@ typedef struct {
     uint8_t r, g, b, a;
 } g_vertex;
 
-static inline float rand_float(float min, float max) {
-    float scale = rand() / (float)RAND_MAX;
+// Per-instance data of the instanced pipeline.
+typedef struct {
+    float x, y;
+    // Forward axis, the direction scaled by size
+    float fx, fy;
+    uint8_t r, g, b, a;
+} g_instance;
+
+static inline uint8_t g_color_channel(float c) {
+    return (uint8_t)(glm_clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// PCG32, seeded per world so runs can be reproduced.
+typedef struct {
+    uint64_t state;
+} g_rng;
+
+static inline uint32_t g_rng_next(g_rng *rng) {
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+    uint32_t rot = (uint32_t)(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+static inline void g_rng_seed(g_rng *rng, uint64_t seed) {
+    rng->state = seed + 1442695040888963407ULL;
+    g_rng_next(rng);
+}
+
+static inline float rand_float(g_rng *rng, float min, float max) {
+    float scale = (g_rng_next(rng) >> 8) * (1.0f / 16777216.0f);
     return min + scale * (max - min);
 }
 
+#define G_HASH_SEED 0xcbf29ce484222325ULL
+
+// FNV-1a, chain calls starting from G_HASH_SEED
+static inline uint64_t g_hash_bytes(uint64_t hash, const void *data,
+                                    size_t size) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 static inline float g_vec2_length(vec2 v) {
     return sqrtf(glm_pow2(v[0]) + glm_pow2(v[1]));
 }
@@ -81,16 +125,42 @@ typedef struct {
     struct sg_bindings *bindings;
     mat4 *transforms;
     size_t *sizes;
+    // World space bounds, used for culling.
+    vec2 (*aabbs)[2];
+
+    // CPU side vertices of every mesh, for the flow field and snapshots.
+    // Owned ones are copies freed with the mesh, borrowed ones belong to
+    // the caller.
+    const g_vertex **vertices;
+    bool *owned;
+    // Over every mesh
+    size_t vertex_count;
 
     size_t size;
     size_t capacity;
+
+    // Owns every per mesh array and the owned vertices.
+    g_allocator *allocator;
+    void *block;
 } g_static_meshes;
 
-g_static_meshes g_static_meshes_init(size_t capacity);
+// Returns false if out of memory.
+bool g_static_meshes_init(g_static_meshes *meshes, g_allocator *allocator,
+                          size_t capacity);
 
-// Returns the index to the static mesh
+// Copy vertices into a new mesh. Returns the index to the static mesh, or
+// SIZE_MAX once full.
 size_t g_static_meshes_add(g_static_meshes *meshes, mat4 transform,
-                           g_vertex *vertices, size_t num_vertices);
+                           const g_vertex *vertices, size_t num_vertices);
+
+// g_static_meshes_add without the CPU copy, vertices must stay valid until
+// the mesh is cleared. Meant for mapped packs.
+size_t g_static_meshes_add_borrowed(g_static_meshes *meshes, mat4 transform,
+                                    const g_vertex *vertices,
+                                    size_t num_vertices);
+
+// Remove every mesh, destroying their buffers.
+void g_static_meshes_clear(g_static_meshes *meshes);
 
 void g_static_meshes_delete(g_static_meshes *meshes);
 
@@ -102,7 +172,10 @@ enum g_actor_type : stable_index_mask_t {
     ACTOR_TYPE_ENEMY = 1 << 3,
 };
 
+// Overridable at build time, ctri_bench raises it for its larger scenarios
+#ifndef MAX_G_ACTORS
 #define MAX_G_ACTORS (size_t)512
+#endif
 
 typedef struct {
     stable_index actor_index;
@@ -111,13 +184,24 @@ typedef struct {
     stable_index_view *enemy_view;
     stable_index_view *ally_view;
 
-    vec4 colors[MAX_G_ACTORS];
-    g_transform transforms[MAX_G_ACTORS];
-    mat4 global_transforms[MAX_G_ACTORS];
-    g_velocity velocities[MAX_G_ACTORS];
-    float drag[MAX_G_ACTORS];
-    float mass[MAX_G_ACTORS];
-
+    // MAX_G_ACTORS each, in one block with every array on a cache line.
+    vec4 *colors;
+    g_transform *transforms;
+    mat4 *global_transforms;
+    g_velocity *velocities;
+    float *drag;
+    float *mass;
+    g_shape_id *shapes;
+    // Shapes at the current rotation, rebuilt by g_actor_stack_phys
+    g_shape_pose *poses;
+
+    g_allocator *allocator;
+    void *block;
+
+    // Counters, narrow phase pairs tested past the bounding circles and
+    // pairs found touching
+    uint64_t pairs_tested;
+    uint64_t contacts;
 } g_actor_stack;
 
 typedef struct {
@@ -126,16 +210,21 @@ typedef struct {
     g_velocity velocity;
     float drag;
     float mass;
+    g_shape_id shape;
     enum g_actor_type type;
 } g_actor_stack_create_ctx;
 
-void g_actor_stack_init(g_actor_stack *stack);
+// Returns false if out of memory. Registers the built in shapes.
+bool g_actor_stack_init(g_actor_stack *stack, g_allocator *allocator);
 
 stable_index_handle g_actor_stack_create(g_actor_stack *stack,
                                          g_actor_stack_create_ctx *ctx);
 
 void g_actor_stack_remove(g_actor_stack *stack, stable_index_handle handle);
 
+// Check the validity of a stable index handle
+bool g_actor_stack_valid(g_actor_stack *stack, stable_index_handle handle);
+
 void g_actor_stack_phys(float dt, g_actor_stack *stack);
 
 void g_actor_stack_transform(g_actor_stack *stack, float fixed_overstep);
@@ -147,13 +236,20 @@ typedef struct {
     bool right;
     bool up;
     bool down;
+    bool fire;
 
     vec2 direction;
 } g_input_map;
 
+// Recompute the normalized direction from the held keys.
+void g_input_map_direction(g_input_map *imap);
+
 typedef struct {
     stable_index_handle actor_handle;
     g_input_map input_map;
+
+    // Seconds until the player can fire again
+    float fire_cooldown;
 } g_player;
 
 typedef struct {
@@ -164,11 +260,25 @@ typedef struct {
     vec2 mouse_pos;
 } g_camera;
 
-void g_enemy_update(float dt, g_actor_stack *stack,
-                    stable_index_handle player_handle);
-
-void g_ally_update(float dt, g_actor_stack *stack,
-                   stable_index_handle player_handle);
+// g_ai_lod and g_flow_field decl
+struct g_ai_lod;
+struct g_flow_field;
+
+// Steer the enemies due in lod along the flow field, or straight at the
+// player where it has no direction.
+void g_enemy_update(const struct g_ai_lod *lod, g_actor_stack *stack,
+                    stable_index_handle player_handle,
+                    const struct g_flow_field *flow);
+
+// g_formation and g_actor_grid decl
+struct g_formation;
+struct g_actor_grid;
+
+// Steer the allies due in lod toward their formation slots around the
+// player, keeping them apart from their neighbours in grid.
+void g_ally_update(const struct g_ai_lod *lod, g_actor_stack *stack,
+                   stable_index_handle player_handle,
+                   struct g_formation *formation, struct g_actor_grid *grid);
 void g_camera_update(g_player *player, g_actor_stack *stack, float dt,
                      g_camera *camera);
 
@@ -181,5 +291,7 @@ void g_player_update(float dt, g_player *player, g_actor_stack *actors,
 void g_camera_mouse(const struct sapp_event *event, g_camera *camera);
 void g_camera_view(g_camera *camera, mat4 view);
 void g_camera_proj(const g_camera *camera, const float aspect, mat4 proj);
+// World space rectangle covered by the camera's projection.
+void g_camera_rect(const g_camera *camera, const float aspect, vec2 rect[2]);
 
 #endif
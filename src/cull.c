@@ -0,0 +1,104 @@
+#include "cull.h"
+#include "fastmath.h"
+#include "trace.h"
+
+#include <stdlib.h>
+
+void g_visible_set_init(g_visible_set *set, size_t static_capacity) {
+    set->actor_count = 0;
+
+    set->static_meshes = malloc(sizeof(size_t) * static_capacity);
+    set->static_count = 0;
+    set->static_capacity = static_capacity;
+}
+
+void g_visible_set_delete(g_visible_set *set) { free(set->static_meshes); }
+
+// Bounding circle of the actor's shape, the radius of its pose
+static inline float actor_radius(const g_actor_stack *stack,
+                                 stable_index_t idx) {
+    return g_shape_scaled_radius(g_shape_get(stack->shapes[idx]),
+                                 stack->transforms[idx].scale);
+}
+
+void g_cull_actors(const g_actor_stack *stack, vec2 rect[2],
+                   g_visible_set *set) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "cull_actors");
+
+    const stable_index_view *alive = stack->alive_view;
+
+    const float cx = (rect[0][0] + rect[1][0]) * 0.5f;
+    const float cy = (rect[0][1] + rect[1][1]) * 0.5f;
+    const float hw = (rect[1][0] - rect[0][0]) * 0.5f;
+    const float hh = (rect[1][1] - rect[0][1]) * 0.5f;
+
+    size_t count = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__) || defined(__wasm_simd128__)
+    const g_f4 vcx = g_f4_set1(cx);
+    const g_f4 vcy = g_f4_set1(cy);
+    const g_f4 vhw = g_f4_set1(hw);
+    const g_f4 vhh = g_f4_set1(hh);
+
+    for (; i + 4 <= alive->size; i += 4) {
+        const stable_index_t *idx = &alive->indices[i];
+
+        // Test against the interpolated transform, since that's what's drawn.
+        const g_f4 px = g_f4_setr(stack->global_transforms[idx[0]][3][0],
+                                  stack->global_transforms[idx[1]][3][0],
+                                  stack->global_transforms[idx[2]][3][0],
+                                  stack->global_transforms[idx[3]][3][0]);
+        const g_f4 py = g_f4_setr(stack->global_transforms[idx[0]][3][1],
+                                  stack->global_transforms[idx[1]][3][1],
+                                  stack->global_transforms[idx[2]][3][1],
+                                  stack->global_transforms[idx[3]][3][1]);
+        const g_f4 r = g_f4_setr(actor_radius(stack, idx[0]),
+                                 actor_radius(stack, idx[1]),
+                                 actor_radius(stack, idx[2]),
+                                 actor_radius(stack, idx[3]));
+
+        const g_f4 dx = g_f4_abs(g_f4_sub(px, vcx));
+        const g_f4 dy = g_f4_abs(g_f4_sub(py, vcy));
+
+        const g_f4 inside = g_f4_and(g_f4_le(dx, g_f4_add(vhw, r)),
+                                     g_f4_le(dy, g_f4_add(vhh, r)));
+
+        const int mask = g_f4_movemask(inside);
+
+        // Branchless compaction, count never exceeds alive->size.
+        for (int k = 0; k < 4; k++) {
+            set->actors[count] = idx[k];
+            count += (mask >> k) & 1;
+        }
+    }
+#endif
+
+    for (; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+
+        const float r = actor_radius(stack, idx);
+        const float dx = fabsf(stack->global_transforms[idx][3][0] - cx);
+        const float dy = fabsf(stack->global_transforms[idx][3][1] - cy);
+
+        set->actors[count] = idx;
+        count += dx <= hw + r && dy <= hh + r;
+    }
+
+    set->actor_count = count;
+
+    G_TRACE_END(G_TRACE_SYSTEM, "cull_actors");
+}
+
+void g_cull_static(const g_static_meshes *meshes, vec2 rect[2],
+                   g_visible_set *set) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < meshes->size && count < set->static_capacity; i++) {
+        if (glm_aabb2d_aabb(meshes->aabbs[i], rect)) {
+            set->static_meshes[count++] = i;
+        }
+    }
+
+    set->static_count = count;
+}
@@ -0,0 +1,30 @@
+// Camera visibility culling for actors and static meshes.
+#ifndef CULL_H
+#define CULL_H
+
+#include "common.h"
+
+// Compact list of everything the camera can currently see, rebuilt every
+// frame by g_cull.
+typedef struct {
+    stable_index_t actors[MAX_G_ACTORS];
+    size_t actor_count;
+
+    // Indices into g_static_meshes
+    size_t *static_meshes;
+    size_t static_count;
+    size_t static_capacity;
+} g_visible_set;
+
+void g_visible_set_init(g_visible_set *set, size_t static_capacity);
+void g_visible_set_delete(g_visible_set *set);
+
+// Select the actors whose (interpolated) bounds overlap rect.
+void g_cull_actors(const g_actor_stack *stack, vec2 rect[2],
+                   g_visible_set *set);
+
+// Select the static meshes whose world bounds overlap rect.
+void g_cull_static(const g_static_meshes *meshes, vec2 rect[2],
+                   g_visible_set *set);
+
+#endif
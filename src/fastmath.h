@@ -0,0 +1,442 @@
+// Four wide float math for the gameplay kernels: sincos, atan2, angle wrapping
+// and rsqrt, on wasm simd128, SSE2 or plain scalar lanes. Every function has a
+// scalar twin running the same polynomials, for single actors.
+//
+// Maximum errors, measured against double precision libm over random inputs:
+// - g_f4_sincos / g_sincosf: 9.5e-8 absolute for |x| <= 256, 1.6e-7 for
+//   |x| <= 8192.
+// - g_f4_atan2 / g_atan2f: 2.7e-7 absolute. atan2(0, 0) is 0.
+// - g_f4_wrap_angle / g_wrap_anglef: 1.2e-7 absolute modulo 2 pi for
+//   |x| <= 256. Results near +-pi can overshoot it by |x| * 1e-7.
+// - g_f4_rsqrt: 2.5e-7 relative on SSE2 (estimate and a Newton step), 1 ulp
+//   elsewhere and for g_rsqrtf.
+// The 4 wide functions other than rsqrt match their scalar twins bit for bit.
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// pi / 2 and 2 pi split for Cody-Waite reduction, the high parts have enough
+// trailing zero bits for k * hi to be exact
+#define G_FM_PIO2_HI 1.5703125f
+#define G_FM_PIO2_LO 4.83826794897e-4f
+#define G_FM_2PI_HI 6.28125f
+#define G_FM_2PI_LO 1.93530717959e-3f
+
+#define G_FM_PI 3.14159265359f
+#define G_FM_PIO2 1.57079632679f
+#define G_FM_PIO4 0.785398163397f
+#define G_FM_TAN_PIO8 0.414213562373f
+
+// Minimax polynomials over [-pi/4, pi/4], from Cephes' sinf, cosf and atanf.
+#define G_FM_SIN_C0 -1.9515295891e-4f
+#define G_FM_SIN_C1 8.3321608736e-3f
+#define G_FM_SIN_C2 -1.6666654611e-1f
+#define G_FM_COS_C0 2.443315711809948e-5f
+#define G_FM_COS_C1 -1.388731625493765e-3f
+#define G_FM_COS_C2 4.166664568298827e-2f
+#define G_FM_ATAN_C0 8.05374449538e-2f
+#define G_FM_ATAN_C1 -1.38776856032e-1f
+#define G_FM_ATAN_C2 1.99777106478e-1f
+#define G_FM_ATAN_C3 -3.33329491539e-1f
+
+// ---------------------------------- scalar ----------------------------------
+
+static inline float g_fm_sin_poly(float r, float r2) {
+    return r + r * r2 * (G_FM_SIN_C2 + r2 * (G_FM_SIN_C1 + r2 * G_FM_SIN_C0));
+}
+
+static inline float g_fm_cos_poly(float r2) {
+    return 1.0f - 0.5f * r2 +
+           r2 * r2 * (G_FM_COS_C2 + r2 * (G_FM_COS_C1 + r2 * G_FM_COS_C0));
+}
+
+static inline float g_fm_atan_poly(float a) {
+    const float z = a * a;
+    return a + a * z *
+                   (G_FM_ATAN_C3 +
+                    z * (G_FM_ATAN_C2 + z * (G_FM_ATAN_C1 + z * G_FM_ATAN_C0)));
+}
+
+static inline float g_fm_flip(float x, uint32_t sign) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits ^= sign;
+    memcpy(&x, &bits, sizeof(bits));
+    return x;
+}
+
+static inline void g_sincosf(float x, float *s, float *c) {
+    const int32_t q = (int32_t)rintf(x * (1.0f / G_FM_PIO2));
+    const float k = (float)q;
+    const float r = x - k * G_FM_PIO2_HI - k * G_FM_PIO2_LO;
+    const float r2 = r * r;
+
+    const float ps = g_fm_sin_poly(r, r2);
+    const float pc = g_fm_cos_poly(r2);
+
+    const bool swap = q & 1;
+    *s = g_fm_flip(swap ? pc : ps, (uint32_t)(q & 2) << 30);
+    *c = g_fm_flip(swap ? ps : pc, (uint32_t)((q + 1) & 2) << 30);
+}
+
+static inline float g_atan2f(float y, float x) {
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    const float mn = fminf(ax, ay);
+    const float mx = fmaxf(ax, ay);
+
+    float a = mx > 0.0f ? mn / mx : 0.0f;
+
+    // Fold [tan(pi/8), 1] onto [-tan(pi/8), 0] around pi/4
+    const bool fold = a > G_FM_TAN_PIO8;
+    a = fold ? (a - 1.0f) / (a + 1.0f) : a;
+
+    float r = g_fm_atan_poly(a) + (fold ? G_FM_PIO4 : 0.0f);
+    r = ay > ax ? G_FM_PIO2 - r : r;
+    r = x < 0.0f ? G_FM_PI - r : r;
+
+    uint32_t sign;
+    memcpy(&sign, &y, sizeof(sign));
+    return g_fm_flip(r, sign & 0x80000000u);
+}
+
+static inline float g_wrap_anglef(float x) {
+    const float k = rintf(x * (1.0f / (2.0f * G_FM_PI)));
+    return x - k * G_FM_2PI_HI - k * G_FM_2PI_LO;
+}
+
+static inline float g_rsqrtf(float x) { return 1.0f / sqrtf(x); }
+
+// --------------------------------- 4 wide ---------------------------------
+
+#if defined(__wasm_simd128__)
+
+typedef v128_t g_f4;
+typedef v128_t g_i4;
+
+static inline g_f4 g_f4_set1(float x) { return wasm_f32x4_splat(x); }
+static inline g_f4 g_f4_setr(float a, float b, float c, float d) {
+    return wasm_f32x4_make(a, b, c, d);
+}
+static inline g_f4 g_f4_load(const float *p) { return wasm_v128_load(p); }
+static inline void g_f4_store(float *p, g_f4 a) { wasm_v128_store(p, a); }
+static inline g_f4 g_f4_add(g_f4 a, g_f4 b) { return wasm_f32x4_add(a, b); }
+static inline g_f4 g_f4_sub(g_f4 a, g_f4 b) { return wasm_f32x4_sub(a, b); }
+static inline g_f4 g_f4_mul(g_f4 a, g_f4 b) { return wasm_f32x4_mul(a, b); }
+static inline g_f4 g_f4_div(g_f4 a, g_f4 b) { return wasm_f32x4_div(a, b); }
+static inline g_f4 g_f4_min(g_f4 a, g_f4 b) { return wasm_f32x4_pmin(a, b); }
+static inline g_f4 g_f4_max(g_f4 a, g_f4 b) { return wasm_f32x4_pmax(a, b); }
+static inline g_f4 g_f4_abs(g_f4 a) { return wasm_f32x4_abs(a); }
+static inline g_f4 g_f4_lt(g_f4 a, g_f4 b) { return wasm_f32x4_lt(a, b); }
+static inline g_f4 g_f4_gt(g_f4 a, g_f4 b) { return wasm_f32x4_gt(a, b); }
+static inline g_f4 g_f4_le(g_f4 a, g_f4 b) { return wasm_f32x4_le(a, b); }
+static inline g_f4 g_f4_xor(g_f4 a, g_f4 b) { return wasm_v128_xor(a, b); }
+static inline g_f4 g_f4_and(g_f4 a, g_f4 b) { return wasm_v128_and(a, b); }
+// mask ? a : b, per lane
+static inline g_f4 g_f4_select(g_f4 mask, g_f4 a, g_f4 b) {
+    return wasm_v128_bitselect(a, b, mask);
+}
+// Bit i set when lane i of mask is set
+static inline int g_f4_movemask(g_f4 mask) {
+    return (int)wasm_i32x4_bitmask(mask);
+}
+static inline g_f4 g_f4_rsqrt(g_f4 a) {
+    return wasm_f32x4_div(wasm_f32x4_splat(1.0f), wasm_f32x4_sqrt(a));
+}
+
+static inline g_i4 g_f4_round_i4(g_f4 a) {
+    return wasm_i32x4_trunc_sat_f32x4(wasm_f32x4_nearest(a));
+}
+static inline g_f4 g_i4_to_f4(g_i4 a) { return wasm_f32x4_convert_i32x4(a); }
+static inline g_i4 g_i4_set1(int32_t x) { return wasm_i32x4_splat(x); }
+static inline g_i4 g_i4_add(g_i4 a, g_i4 b) { return wasm_i32x4_add(a, b); }
+static inline g_i4 g_i4_and(g_i4 a, g_i4 b) { return wasm_v128_and(a, b); }
+static inline g_i4 g_i4_shl(g_i4 a, int n) { return wasm_i32x4_shl(a, n); }
+// All ones where equal, as a float mask
+static inline g_f4 g_i4_eq(g_i4 a, g_i4 b) { return wasm_i32x4_eq(a, b); }
+static inline g_f4 g_i4_as_f4(g_i4 a) { return a; }
+static inline g_f4 g_f4_round(g_f4 a) { return wasm_f32x4_nearest(a); }
+
+#elif defined(__SSE2__)
+
+typedef __m128 g_f4;
+typedef __m128i g_i4;
+
+static inline g_f4 g_f4_set1(float x) { return _mm_set1_ps(x); }
+static inline g_f4 g_f4_setr(float a, float b, float c, float d) {
+    return _mm_setr_ps(a, b, c, d);
+}
+static inline g_f4 g_f4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void g_f4_store(float *p, g_f4 a) { _mm_storeu_ps(p, a); }
+static inline g_f4 g_f4_add(g_f4 a, g_f4 b) { return _mm_add_ps(a, b); }
+static inline g_f4 g_f4_sub(g_f4 a, g_f4 b) { return _mm_sub_ps(a, b); }
+static inline g_f4 g_f4_mul(g_f4 a, g_f4 b) { return _mm_mul_ps(a, b); }
+static inline g_f4 g_f4_div(g_f4 a, g_f4 b) { return _mm_div_ps(a, b); }
+static inline g_f4 g_f4_min(g_f4 a, g_f4 b) { return _mm_min_ps(a, b); }
+static inline g_f4 g_f4_max(g_f4 a, g_f4 b) { return _mm_max_ps(a, b); }
+static inline g_f4 g_f4_abs(g_f4 a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+}
+static inline g_f4 g_f4_lt(g_f4 a, g_f4 b) { return _mm_cmplt_ps(a, b); }
+static inline g_f4 g_f4_gt(g_f4 a, g_f4 b) { return _mm_cmpgt_ps(a, b); }
+static inline g_f4 g_f4_le(g_f4 a, g_f4 b) { return _mm_cmple_ps(a, b); }
+static inline g_f4 g_f4_xor(g_f4 a, g_f4 b) { return _mm_xor_ps(a, b); }
+static inline g_f4 g_f4_and(g_f4 a, g_f4 b) { return _mm_and_ps(a, b); }
+// mask ? a : b, per lane
+static inline g_f4 g_f4_select(g_f4 mask, g_f4 a, g_f4 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+// Bit i set when lane i of mask is set
+static inline int g_f4_movemask(g_f4 mask) { return _mm_movemask_ps(mask); }
+// The estimate is good to 12 bits, one Newton step gets close to 23
+static inline g_f4 g_f4_rsqrt(g_f4 a) {
+    const __m128 e = _mm_rsqrt_ps(a);
+    const __m128 e2a = _mm_mul_ps(_mm_mul_ps(e, e), a);
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), e),
+                      _mm_sub_ps(_mm_set1_ps(3.0f), e2a));
+}
+
+// Rounds to nearest even, like rintf in the default rounding mode
+static inline g_i4 g_f4_round_i4(g_f4 a) { return _mm_cvtps_epi32(a); }
+static inline g_f4 g_i4_to_f4(g_i4 a) { return _mm_cvtepi32_ps(a); }
+static inline g_i4 g_i4_set1(int32_t x) { return _mm_set1_epi32(x); }
+static inline g_i4 g_i4_add(g_i4 a, g_i4 b) { return _mm_add_epi32(a, b); }
+static inline g_i4 g_i4_and(g_i4 a, g_i4 b) { return _mm_and_si128(a, b); }
+static inline g_i4 g_i4_shl(g_i4 a, int n) { return _mm_slli_epi32(a, n); }
+// All ones where equal, as a float mask
+static inline g_f4 g_i4_eq(g_i4 a, g_i4 b) {
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b));
+}
+static inline g_f4 g_i4_as_f4(g_i4 a) { return _mm_castsi128_ps(a); }
+// Exact for |a| < 2^31
+static inline g_f4 g_f4_round(g_f4 a) {
+    return _mm_cvtepi32_ps(_mm_cvtps_epi32(a));
+}
+
+#else
+
+typedef struct {
+    float v[4];
+} g_f4;
+
+typedef struct {
+    int32_t v[4];
+} g_i4;
+
+#define G_F4_MAP(expr)                                                         \
+    g_f4 r;                                                                    \
+    for (int i = 0; i < 4; i++) {                                              \
+        r.v[i] = (expr);                                                       \
+    }                                                                          \
+    return r
+
+static inline g_f4 g_f4_from_bits(const uint32_t bits[4]) {
+    g_f4 r;
+    memcpy(r.v, bits, sizeof(r.v));
+    return r;
+}
+
+static inline g_f4 g_f4_set1(float x) { G_F4_MAP(x); }
+static inline g_f4 g_f4_setr(float a, float b, float c, float d) {
+    return (g_f4){{a, b, c, d}};
+}
+static inline g_f4 g_f4_load(const float *p) { G_F4_MAP(p[i]); }
+static inline void g_f4_store(float *p, g_f4 a) {
+    memcpy(p, a.v, sizeof(a.v));
+}
+static inline g_f4 g_f4_add(g_f4 a, g_f4 b) { G_F4_MAP(a.v[i] + b.v[i]); }
+static inline g_f4 g_f4_sub(g_f4 a, g_f4 b) { G_F4_MAP(a.v[i] - b.v[i]); }
+static inline g_f4 g_f4_mul(g_f4 a, g_f4 b) { G_F4_MAP(a.v[i] * b.v[i]); }
+static inline g_f4 g_f4_div(g_f4 a, g_f4 b) { G_F4_MAP(a.v[i] / b.v[i]); }
+static inline g_f4 g_f4_min(g_f4 a, g_f4 b) {
+    G_F4_MAP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]);
+}
+static inline g_f4 g_f4_max(g_f4 a, g_f4 b) {
+    G_F4_MAP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]);
+}
+static inline g_f4 g_f4_abs(g_f4 a) { G_F4_MAP(fabsf(a.v[i])); }
+static inline g_f4 g_f4_rsqrt(g_f4 a) { G_F4_MAP(g_rsqrtf(a.v[i])); }
+static inline g_f4 g_f4_round(g_f4 a) { G_F4_MAP(rintf(a.v[i])); }
+
+static inline g_f4 g_f4_lt(g_f4 a, g_f4 b) {
+    uint32_t bits[4];
+    for (int i = 0; i < 4; i++) {
+        bits[i] = a.v[i] < b.v[i] ? 0xffffffffu : 0;
+    }
+    return g_f4_from_bits(bits);
+}
+static inline g_f4 g_f4_gt(g_f4 a, g_f4 b) { return g_f4_lt(b, a); }
+static inline g_f4 g_f4_le(g_f4 a, g_f4 b) {
+    uint32_t bits[4];
+    for (int i = 0; i < 4; i++) {
+        bits[i] = a.v[i] <= b.v[i] ? 0xffffffffu : 0;
+    }
+    return g_f4_from_bits(bits);
+}
+
+static inline g_f4 g_f4_xor(g_f4 a, g_f4 b) {
+    uint32_t x[4], y[4];
+    memcpy(x, a.v, sizeof(x));
+    memcpy(y, b.v, sizeof(y));
+    for (int i = 0; i < 4; i++) {
+        x[i] ^= y[i];
+    }
+    return g_f4_from_bits(x);
+}
+static inline g_f4 g_f4_and(g_f4 a, g_f4 b) {
+    uint32_t x[4], y[4];
+    memcpy(x, a.v, sizeof(x));
+    memcpy(y, b.v, sizeof(y));
+    for (int i = 0; i < 4; i++) {
+        x[i] &= y[i];
+    }
+    return g_f4_from_bits(x);
+}
+// mask ? a : b, per lane
+static inline g_f4 g_f4_select(g_f4 mask, g_f4 a, g_f4 b) {
+    uint32_t m[4], x[4], y[4];
+    memcpy(m, mask.v, sizeof(m));
+    memcpy(x, a.v, sizeof(x));
+    memcpy(y, b.v, sizeof(y));
+    for (int i = 0; i < 4; i++) {
+        x[i] = (x[i] & m[i]) | (y[i] & ~m[i]);
+    }
+    return g_f4_from_bits(x);
+}
+// Bit i set when lane i of mask is set
+static inline int g_f4_movemask(g_f4 mask) {
+    uint32_t m[4];
+    memcpy(m, mask.v, sizeof(m));
+    return (int)((m[0] >> 31) | (m[1] >> 31) << 1 | (m[2] >> 31) << 2 |
+                 (m[3] >> 31) << 3);
+}
+
+static inline g_i4 g_f4_round_i4(g_f4 a) {
+    g_i4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = (int32_t)rintf(a.v[i]);
+    }
+    return r;
+}
+static inline g_f4 g_i4_to_f4(g_i4 a) { G_F4_MAP((float)a.v[i]); }
+static inline g_i4 g_i4_set1(int32_t x) { return (g_i4){{x, x, x, x}}; }
+static inline g_i4 g_i4_add(g_i4 a, g_i4 b) {
+    for (int i = 0; i < 4; i++) {
+        a.v[i] += b.v[i];
+    }
+    return a;
+}
+static inline g_i4 g_i4_and(g_i4 a, g_i4 b) {
+    for (int i = 0; i < 4; i++) {
+        a.v[i] &= b.v[i];
+    }
+    return a;
+}
+static inline g_i4 g_i4_shl(g_i4 a, int n) {
+    for (int i = 0; i < 4; i++) {
+        a.v[i] = (int32_t)((uint32_t)a.v[i] << n);
+    }
+    return a;
+}
+// All ones where equal, as a float mask
+static inline g_f4 g_i4_eq(g_i4 a, g_i4 b) {
+    uint32_t bits[4];
+    for (int i = 0; i < 4; i++) {
+        bits[i] = a.v[i] == b.v[i] ? 0xffffffffu : 0;
+    }
+    return g_f4_from_bits(bits);
+}
+static inline g_f4 g_i4_as_f4(g_i4 a) {
+    g_f4 r;
+    memcpy(r.v, a.v, sizeof(r.v));
+    return r;
+}
+
+#undef G_F4_MAP
+
+#endif
+
+// Same operation order as g_sincosf, lanes match it exactly.
+static inline void g_f4_sincos(g_f4 x, g_f4 *s, g_f4 *c) {
+    const g_i4 q = g_f4_round_i4(g_f4_mul(x, g_f4_set1(1.0f / G_FM_PIO2)));
+    const g_f4 k = g_i4_to_f4(q);
+    const g_f4 r =
+        g_f4_sub(g_f4_sub(x, g_f4_mul(k, g_f4_set1(G_FM_PIO2_HI))),
+                 g_f4_mul(k, g_f4_set1(G_FM_PIO2_LO)));
+    const g_f4 r2 = g_f4_mul(r, r);
+
+    // r + r * r2 * (c2 + r2 * (c1 + r2 * c0))
+    g_f4 ps = g_f4_add(g_f4_set1(G_FM_SIN_C1),
+                       g_f4_mul(r2, g_f4_set1(G_FM_SIN_C0)));
+    ps = g_f4_add(g_f4_set1(G_FM_SIN_C2), g_f4_mul(r2, ps));
+    ps = g_f4_add(r, g_f4_mul(g_f4_mul(r, r2), ps));
+
+    // 1 - 0.5 * r2 + r2 * r2 * (c2 + r2 * (c1 + r2 * c0))
+    g_f4 pc = g_f4_add(g_f4_set1(G_FM_COS_C1),
+                       g_f4_mul(r2, g_f4_set1(G_FM_COS_C0)));
+    pc = g_f4_add(g_f4_set1(G_FM_COS_C2), g_f4_mul(r2, pc));
+    pc = g_f4_add(
+        g_f4_sub(g_f4_set1(1.0f), g_f4_mul(g_f4_set1(0.5f), r2)),
+        g_f4_mul(g_f4_mul(r2, r2), pc));
+
+    const g_i4 one = g_i4_set1(1);
+    const g_i4 two = g_i4_set1(2);
+    const g_f4 swap = g_i4_eq(g_i4_and(q, one), one);
+
+    const g_f4 sin_sign = g_i4_as_f4(g_i4_shl(g_i4_and(q, two), 30));
+    const g_f4 cos_sign =
+        g_i4_as_f4(g_i4_shl(g_i4_and(g_i4_add(q, one), two), 30));
+
+    *s = g_f4_xor(g_f4_select(swap, pc, ps), sin_sign);
+    *c = g_f4_xor(g_f4_select(swap, ps, pc), cos_sign);
+}
+
+// Same operation order as g_atan2f, lanes match it exactly.
+static inline g_f4 g_f4_atan2(g_f4 y, g_f4 x) {
+    const g_f4 zero = g_f4_set1(0.0f);
+    const g_f4 one = g_f4_set1(1.0f);
+
+    const g_f4 ax = g_f4_abs(x);
+    const g_f4 ay = g_f4_abs(y);
+    const g_f4 mn = g_f4_min(ax, ay);
+    const g_f4 mx = g_f4_max(ax, ay);
+
+    // Lanes with mx == 0 divide 0 / 0, then get masked out
+    g_f4 a = g_f4_and(g_f4_div(mn, mx), g_f4_gt(mx, zero));
+
+    const g_f4 fold = g_f4_gt(a, g_f4_set1(G_FM_TAN_PIO8));
+    a = g_f4_select(fold, g_f4_div(g_f4_sub(a, one), g_f4_add(a, one)), a);
+
+    const g_f4 z = g_f4_mul(a, a);
+    g_f4 p = g_f4_add(g_f4_set1(G_FM_ATAN_C1),
+                      g_f4_mul(z, g_f4_set1(G_FM_ATAN_C0)));
+    p = g_f4_add(g_f4_set1(G_FM_ATAN_C2), g_f4_mul(z, p));
+    p = g_f4_add(g_f4_set1(G_FM_ATAN_C3), g_f4_mul(z, p));
+    p = g_f4_add(a, g_f4_mul(g_f4_mul(a, z), p));
+
+    g_f4 r = g_f4_add(p, g_f4_and(fold, g_f4_set1(G_FM_PIO4)));
+    r = g_f4_select(g_f4_gt(ay, ax), g_f4_sub(g_f4_set1(G_FM_PIO2), r), r);
+    r = g_f4_select(g_f4_lt(x, zero), g_f4_sub(g_f4_set1(G_FM_PI), r), r);
+
+    return g_f4_xor(r, g_f4_and(y, g_f4_set1(-0.0f)));
+}
+
+// Same operation order as g_wrap_anglef, lanes match it exactly.
+static inline g_f4 g_f4_wrap_angle(g_f4 x) {
+    const g_f4 k =
+        g_f4_round(g_f4_mul(x, g_f4_set1(1.0f / (2.0f * G_FM_PI))));
+    return g_f4_sub(g_f4_sub(x, g_f4_mul(k, g_f4_set1(G_FM_2PI_HI))),
+                    g_f4_mul(k, g_f4_set1(G_FM_2PI_LO)));
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "flow.h"
+#include "trace.h"
+
+#include <string.h>
+
+// Counter clockwise from +x, straight directions on even indices
+const vec2 g_flow_directions[8] = {
+    {1.0f, 0.0f},   {GLM_SQRT1_2f, GLM_SQRT1_2f},
+    {0.0f, 1.0f},   {-GLM_SQRT1_2f, GLM_SQRT1_2f},
+    {-1.0f, 0.0f},  {-GLM_SQRT1_2f, -GLM_SQRT1_2f},
+    {0.0f, -1.0f},  {GLM_SQRT1_2f, -GLM_SQRT1_2f},
+};
+
+const float g_flow_angles[8] = {
+    0.0f,          GLM_PI_4f,         GLM_PI_2f,  3.0f * GLM_PI_4f,
+    GLM_PIf,       -3.0f * GLM_PI_4f, -GLM_PI_2f, -GLM_PI_4f,
+};
+
+static const int8_t g_flow_offsets[8][2] = {
+    {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1},
+};
+
+void g_flow_field_init(g_flow_field *field, float cell_size) {
+    field->cell_size = cell_size;
+    field->inv_cell_size = 1.0f / cell_size;
+    field->origin[0] = 0;
+    field->origin[1] = 0;
+    field->built = false;
+    field->builds = 0;
+    memset(field->direction, G_FLOW_NONE, sizeof(field->direction));
+}
+
+static inline float g_flow_edge(const vec2 a, const vec2 b, const vec2 p) {
+    return (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]);
+}
+
+// Block every cell whose center lies in the triangle, or that holds one of
+// its corners, so thin triangles still block something.
+static void g_flow_field_triangle(g_flow_field *field, vec2 t[3]) {
+    vec2 min, max;
+    glm_vec2_minv(t[0], t[1], min);
+    glm_vec2_minv(min, t[2], min);
+    glm_vec2_maxv(t[0], t[1], max);
+    glm_vec2_maxv(max, t[2], max);
+
+    const int32_t x0 = max((int32_t)floorf(min[0] * field->inv_cell_size) -
+                               field->origin[0],
+                           0);
+    const int32_t y0 = max((int32_t)floorf(min[1] * field->inv_cell_size) -
+                               field->origin[1],
+                           0);
+    const int32_t x1 = min((int32_t)floorf(max[0] * field->inv_cell_size) -
+                               field->origin[0],
+                           G_FLOW_SIZE - 1);
+    const int32_t y1 = min((int32_t)floorf(max[1] * field->inv_cell_size) -
+                               field->origin[1],
+                           G_FLOW_SIZE - 1);
+
+    const float area = g_flow_edge(t[0], t[1], t[2]);
+
+    for (int32_t y = y0; y <= y1; y++) {
+        for (int32_t x = x0; x <= x1; x++) {
+            const vec2 center = {
+                (field->origin[0] + x + 0.5f) * field->cell_size,
+                (field->origin[1] + y + 0.5f) * field->cell_size,
+            };
+
+            // Same sign as the whole triangle on every edge
+            const float w0 = g_flow_edge(t[1], t[2], center) * area;
+            const float w1 = g_flow_edge(t[2], t[0], center) * area;
+            const float w2 = g_flow_edge(t[0], t[1], center) * area;
+
+            if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+                field->blocked[y * G_FLOW_SIZE + x] = 1;
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const int32_t x = (int32_t)floorf(t[i][0] * field->inv_cell_size) -
+                          field->origin[0];
+        const int32_t y = (int32_t)floorf(t[i][1] * field->inv_cell_size) -
+                          field->origin[1];
+
+        if ((uint32_t)x < G_FLOW_SIZE && (uint32_t)y < G_FLOW_SIZE) {
+            field->blocked[y * G_FLOW_SIZE + x] = 1;
+        }
+    }
+}
+
+static void g_flow_field_rasterize(g_flow_field *field,
+                                   const g_static_meshes *meshes) {
+    memset(field->blocked, 0, sizeof(field->blocked));
+
+    vec2 window[2] = {
+        {field->origin[0] * field->cell_size,
+         field->origin[1] * field->cell_size},
+        {(field->origin[0] + G_FLOW_SIZE) * field->cell_size,
+         (field->origin[1] + G_FLOW_SIZE) * field->cell_size},
+    };
+
+    for (size_t m = 0; m < meshes->size; m++) {
+        // Generated levels come in many batches, most out of the window
+        if (!glm_aabb2d_aabb(meshes->aabbs[m], window)) {
+            continue;
+        }
+
+        const g_vertex *vertices = meshes->vertices[m];
+
+        for (size_t i = 0; i + 2 < meshes->sizes[m]; i += 3) {
+            vec2 t[3];
+
+            for (int j = 0; j < 3; j++) {
+                vec4 p = {vertices[i + j].x, vertices[i + j].y, 0.0f, 1.0f};
+                glm_mat4_mulv(meshes->transforms[m], p, p);
+                t[j][0] = p[0];
+                t[j][1] = p[1];
+            }
+
+            g_flow_field_triangle(field, t);
+        }
+    }
+}
+
+// Whether a step from cell (x, y) in direction d stays in the window, lands
+// on a free cell and doesn't cut a blocked corner.
+static inline bool g_flow_field_step(const g_flow_field *field, int32_t x,
+                                     int32_t y, int d) {
+    const int32_t nx = x + g_flow_offsets[d][0];
+    const int32_t ny = y + g_flow_offsets[d][1];
+
+    if ((uint32_t)nx >= G_FLOW_SIZE || (uint32_t)ny >= G_FLOW_SIZE ||
+        field->blocked[ny * G_FLOW_SIZE + nx]) {
+        return false;
+    }
+
+    return (d & 1) == 0 || (!field->blocked[y * G_FLOW_SIZE + nx] &&
+                            !field->blocked[ny * G_FLOW_SIZE + x]);
+}
+
+void g_flow_field_build(g_flow_field *field, const g_static_meshes *meshes,
+                        const vec2 target) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "flow_field_build");
+
+    const int32_t tx = (int32_t)floorf(target[0] * field->inv_cell_size);
+    const int32_t ty = (int32_t)floorf(target[1] * field->inv_cell_size);
+    field->origin[0] = tx - G_FLOW_SIZE / 2;
+    field->origin[1] = ty - G_FLOW_SIZE / 2;
+
+    g_flow_field_rasterize(field, meshes);
+
+    memset(field->distance, 0xff, sizeof(field->distance));
+    memset(field->direction, G_FLOW_NONE, sizeof(field->direction));
+
+    // Dial's algorithm, edges cost 2 or 3 so four buckets cover every
+    // pending distance
+    size_t bucket_size[4] = {0};
+    const uint16_t start = (G_FLOW_SIZE / 2) * G_FLOW_SIZE + G_FLOW_SIZE / 2;
+
+    field->distance[start] = 0;
+    field->buckets[0][bucket_size[0]++] = start;
+    size_t pending = 1;
+
+    for (uint32_t d = 0; pending > 0; d++) {
+        uint16_t *bucket = field->buckets[d & 3];
+        size_t *size = &bucket_size[d & 3];
+
+        while (*size > 0) {
+            const uint16_t cell = bucket[--*size];
+            pending--;
+
+            // Improved since it was queued
+            if (field->distance[cell] != d) {
+                continue;
+            }
+
+            const int32_t x = cell % G_FLOW_SIZE;
+            const int32_t y = cell / G_FLOW_SIZE;
+
+            for (int dir = 0; dir < 8; dir++) {
+                if (!g_flow_field_step(field, x, y, dir)) {
+                    continue;
+                }
+
+                const uint16_t next =
+                    (y + g_flow_offsets[dir][1]) * G_FLOW_SIZE + x +
+                    g_flow_offsets[dir][0];
+                const uint32_t distance = d + 2 + (dir & 1);
+
+                // Point back along the step, toward the target
+                if (distance < field->distance[next]) {
+                    field->distance[next] = distance;
+                    field->direction[next] = (dir + 4) & 7;
+                    field->buckets[distance & 3]
+                                  [bucket_size[distance & 3]++] = next;
+                    pending++;
+                }
+            }
+        }
+    }
+
+    field->built = true;
+    field->builds++;
+
+    G_TRACE_END(G_TRACE_SYSTEM, "flow_field_build");
+}
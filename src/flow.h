@@ -0,0 +1,65 @@
+// Shared flow field toward the player, rebuilt every few ticks by a search over
+// a navigation grid rasterized from the static meshes. Enemies only sample it.
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "common.h"
+
+// Cells per side, a power of two. The field is a window centered on the
+// target when built.
+#define G_FLOW_SIZE 128
+#define G_FLOW_CELLS (G_FLOW_SIZE * G_FLOW_SIZE)
+// Fixed ticks between rebuilds
+#define G_FLOW_INTERVAL 8
+
+// No direction: blocked, unreachable, or the target's own cell
+#define G_FLOW_NONE 0xff
+
+// Unit vector and angle of direction d, counter clockwise from +x.
+extern const vec2 g_flow_directions[8];
+extern const float g_flow_angles[8];
+
+typedef struct g_flow_field {
+    float cell_size;
+    float inv_cell_size;
+
+    // Cell coordinates of the window's first cell
+    int32_t origin[2];
+    bool built;
+
+    // Per cell, row major
+    uint8_t blocked[G_FLOW_CELLS];
+    uint8_t direction[G_FLOW_CELLS];
+
+    // Scratch for the search, octile distances (2 straight, 3 diagonal) and
+    // one bucket per distance modulo 4
+    uint16_t distance[G_FLOW_CELLS];
+    uint16_t buckets[4][G_FLOW_CELLS];
+
+    // Counters
+    uint64_t builds;
+} g_flow_field;
+
+void g_flow_field_init(g_flow_field *field, float cell_size);
+
+// Recenter on target, rasterize the static meshes and rebuild the directions.
+void g_flow_field_build(g_flow_field *field, const g_static_meshes *meshes,
+                        const vec2 target);
+
+// Direction of the cell containing position, G_FLOW_NONE outside the window.
+static inline uint8_t g_flow_field_sample(const g_flow_field *field,
+                                          const vec2 position) {
+    const int32_t x =
+        (int32_t)floorf(position[0] * field->inv_cell_size) - field->origin[0];
+    const int32_t y =
+        (int32_t)floorf(position[1] * field->inv_cell_size) - field->origin[1];
+
+    if (!field->built || (uint32_t)x >= G_FLOW_SIZE ||
+        (uint32_t)y >= G_FLOW_SIZE) {
+        return G_FLOW_NONE;
+    }
+
+    return field->direction[y * G_FLOW_SIZE + x];
+}
+
+#endif
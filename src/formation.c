@@ -0,0 +1,75 @@
+#include "formation.h"
+
+#include <string.h>
+
+void g_formation_init(g_formation *formation) {
+    formation->member_count = 0;
+    formation->offset_count = UINT32_MAX;
+    formation->layouts = 0;
+    memset(formation->slots, 0xff, sizeof(formation->slots));
+}
+
+// Fill the rings from the inside out, the outermost one spreads whatever is
+// left evenly.
+static void g_formation_layout(g_formation *formation) {
+    const uint32_t count = formation->member_count;
+
+    uint32_t slot = 0;
+    for (float r = G_FORMATION_INNER_RADIUS; slot < count;
+         r += G_FORMATION_SPACING) {
+        uint32_t n = (uint32_t)(2.0f * GLM_PIf * r / G_FORMATION_SPACING);
+        n = min(max(n, 1u), count - slot);
+
+        const float step = 2.0f * GLM_PIf / n;
+        for (uint32_t k = 0; k < n; k++) {
+            formation->offsets[slot][0] = r * cosf(k * step);
+            formation->offsets[slot][1] = r * sinf(k * step);
+            slot++;
+        }
+    }
+
+    formation->offset_count = count;
+    formation->layouts++;
+}
+
+void g_formation_assign(g_formation *formation, g_actor_stack *stack) {
+    const stable_index_mask_t *masks = stack->actor_index.masks;
+
+    for (uint32_t s = 0; s < formation->member_count;) {
+        const stable_index_handle member = formation->members[s];
+
+        if (g_actor_stack_valid(stack, member) &&
+            stable_index_mask_contains(masks[member.index], ACTOR_TYPE_ALLY)) {
+            s++;
+            continue;
+        }
+
+        formation->slots[member.index] = G_FORMATION_NONE;
+
+        // The last member moves in, everyone else keeps their slot
+        const uint32_t last = --formation->member_count;
+        if (s != last) {
+            formation->members[s] = formation->members[last];
+            formation->slots[formation->members[s].index] = s;
+        }
+    }
+
+    const stable_index_view *allies = stack->ally_view;
+    for (size_t i = 0; i < allies->size; i++) {
+        const stable_index_t idx = allies->indices[i];
+
+        if (formation->slots[idx] != G_FORMATION_NONE) {
+            continue;
+        }
+
+        formation->slots[idx] = formation->member_count;
+        formation->members[formation->member_count++] = (stable_index_handle){
+            .index = idx,
+            .generation = stack->actor_index.generations[idx],
+        };
+    }
+
+    if (formation->member_count != formation->offset_count) {
+        g_formation_layout(formation);
+    }
+}
@@ -0,0 +1,45 @@
+// Ally formation around the player. Slots are laid out in rings once per ally
+// count change and allies keep their slot for as long as they live.
+#ifndef FORMATION_H
+#define FORMATION_H
+
+#include "common.h"
+
+// Radius of the innermost ring, and the distance between rings and between
+// neighbouring slots on a ring
+#define G_FORMATION_INNER_RADIUS 1.5f
+#define G_FORMATION_SPACING 1.0f
+
+// Allies steer away from actors closer than this, instead of leaving it to
+// the collision solver
+#define G_FORMATION_SEPARATION 0.75f
+#define G_FORMATION_SEPARATION_GAIN 40.0f
+// Neighbours considered per ally
+#define G_FORMATION_NEIGHBOURS 32
+
+// Slot of an actor index without one
+#define G_FORMATION_NONE UINT32_MAX
+
+typedef struct g_formation {
+    // Allies by slot
+    stable_index_handle members[MAX_G_ACTORS];
+    uint32_t member_count;
+    // Slot by actor index, G_FORMATION_NONE for non members
+    uint32_t slots[MAX_G_ACTORS];
+
+    // Slot offsets from the player, laid out for offset_count members
+    vec2 offsets[MAX_G_ACTORS];
+    uint32_t offset_count;
+
+    // Counters
+    uint64_t layouts;
+} g_formation;
+
+void g_formation_init(g_formation *formation);
+
+// Drop the members that died or stopped being allies, handing their slots to
+// the last members, then append the new allies. Lays the slots out again if
+// the member count changed.
+void g_formation_assign(g_formation *formation, g_actor_stack *stack);
+
+#endif
@@ -0,0 +1,237 @@
+// Windowless simulation driver, steps the world at the fixed tick rate on
+// sokol_gfx's dummy backend and reports the tick rate.
+#define SOKOL_IMPL
+#include <sokol/sokol_gfx.h>
+#include <sokol/sokol_log.h>
+#include <sokol/sokol_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "snapshot.h"
+#include "trace.h"
+#include "world.h"
+
+static g_world world;
+
+static g_replay replay;
+
+static g_rewind history;
+
+static void usage(const char *name) {
+    printf("usage: %s [--ticks N] [--fire] [--seed N] [--record PATH | "
+           "--replay PATH] [--load PATH] [--save PATH] [--rewind N] "
+           "[--trace PATH] [--pack PATH [--level NAME]] "
+           "[--arena SEED [--arena-radius R]]\n",
+           name);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t ticks = 64 * 60;
+    uint64_t seed = (uint64_t)time(NULL);
+    bool fire = false;
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    const char *load_path = NULL;
+    const char *save_path = NULL;
+    uint64_t rewind_ticks = 0;
+    const char *trace_path = NULL;
+    const char *pack_path = NULL;
+    const char *level_name = "default";
+    g_pack pack = {0};
+    bool arena = false;
+    g_level_params arena_params;
+    g_level_params_defaults(&arena_params, 0);
+    g_level_cache levels = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--fire") == 0) {
+            fire = true;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load_path = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (strcmp(argv[i], "--rewind") == 0 && i + 1 < argc) {
+            rewind_ticks = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+            pack_path = argv[++i];
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            level_name = argv[++i];
+        } else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc) {
+            arena = true;
+            arena_params.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--arena-radius") == 0 && i + 1 < argc) {
+            arena_params.radius = strtof(argv[++i], NULL);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (replay_path != NULL) {
+        if (!g_replay_load(&replay, replay_path)) {
+            return 1;
+        }
+        seed = replay.seed;
+        ticks = replay.size;
+
+        // Play in the level it was recorded in
+        arena = replay.level.radius > 0.0f;
+        arena_params = replay.level;
+    } else if (record_path != NULL) {
+        if (!g_replay_record(&replay, record_path, seed,
+                             arena ? &arena_params : NULL)) {
+            return 1;
+        }
+    }
+
+    sg_setup(&(sg_desc){
+        .buffer_pool_size = G_WORLD_BUFFER_POOL_SIZE,
+        .logger.func = slog_func,
+    });
+    stm_setup();
+
+    if (trace_path != NULL &&
+        !g_trace_init(trace_path, G_TRACE_DETAIL, 1)) {
+        return 1;
+    }
+    g_trace_thread_name("main thread");
+
+    if (!g_world_init(&world, &g_heap_allocator, seed)) {
+        return 1;
+    }
+
+    if (pack_path != NULL &&
+        (!g_pack_open(&pack, pack_path) ||
+         !g_world_load_level(&world, &pack, level_name))) {
+        return 1;
+    }
+
+    if (arena) {
+        const uint64_t generate_start = stm_now();
+
+        if (!g_level_cache_init(&levels, &g_heap_allocator)) {
+            return 1;
+        }
+
+        const g_level *level = g_level_cache_acquire(&levels, &arena_params);
+        if (level == NULL || !g_world_load_generated(&world, level)) {
+            return 1;
+        }
+
+        printf("arena: %zu triangles, %zu batches, %u walls in %.3f ms\n",
+               level->vertex_count / 3, level->batch_count,
+               level->walls.segment_count,
+               stm_ms(stm_since(generate_start)));
+    }
+
+    if (load_path != NULL && !g_world_snapshot_load(&world, load_path)) {
+        return 1;
+    }
+
+    world.player.input_map.fire = fire;
+
+    if (rewind_ticks > 0) {
+        if (!g_rewind_init(&history, &world, 64 << 20, rewind_ticks + 1)) {
+            return 1;
+        }
+        world.rewind = &history;
+    }
+
+    if (replay_path != NULL || record_path != NULL) {
+        world.replay = &replay;
+    }
+
+    const uint64_t start = stm_now();
+
+    for (uint64_t t = 0; t < ticks; t++) {
+        g_trace_frame();
+        g_world_update(g_fixed_dt, &world);
+
+        if (!g_actor_stack_valid(&world.actors, world.player.actor_handle)) {
+            printf("No player actor, stopping at tick %llu\n",
+                   (unsigned long long)t);
+            ticks = t + 1;
+            break;
+        }
+    }
+
+    const double seconds = stm_sec(stm_since(start));
+
+    printf("seed: %llu\n", (unsigned long long)world.seed);
+    printf("ticks: %llu\n", (unsigned long long)ticks);
+    printf("alive actors: %u\n", world.actors.alive_view->size);
+    printf("elapsed: %.3f s\n", seconds);
+    printf("ticks/s: %.1f\n", ticks / seconds);
+    printf("ns/tick: %.1f\n", seconds * 1e9 / ticks);
+    printf("hash: %016llx\n", (unsigned long long)g_world_hash(&world));
+    printf("ticks dropped: %llu\n",
+           (unsigned long long)world.scheduler.ticks_dropped);
+    printf("ai updates: %llu\n", (unsigned long long)world.ai_lod.updates);
+    printf("ai updates merged: %llu\n",
+           (unsigned long long)world.ai_lod.merged);
+
+    int ret = 0;
+
+    // Resimulating the last ticks has to land on the same state
+    if (world.rewind != NULL) {
+        const uint64_t hash = g_world_hash(&world);
+        const uint64_t rewind_start = stm_now();
+
+        if (!g_world_resimulate(&world, world.tick - rewind_ticks)) {
+            printf("rewind: tick %llu isn't kept\n",
+                   (unsigned long long)(world.tick - rewind_ticks));
+            ret = 2;
+        } else if (g_world_hash(&world) != hash) {
+            printf("rewind: diverged\n");
+            ret = 2;
+        } else {
+            printf("rewind: identical, %.3f ms for %llu ticks\n",
+                   stm_ms(stm_since(rewind_start)),
+                   (unsigned long long)rewind_ticks);
+        }
+
+        printf("rewind history: %llu keyframes, %llu deltas, %.1f KiB/tick\n",
+               (unsigned long long)history.keyframes,
+               (unsigned long long)history.deltas,
+               history.bytes_encoded / 1024.0 /
+                   (history.keyframes + history.deltas));
+
+        g_rewind_delete(&history);
+    }
+
+    if (save_path != NULL && !g_world_snapshot_save(&world, save_path)) {
+        ret = 1;
+    }
+
+    if (replay_path != NULL) {
+        if (replay.divergence == SIZE_MAX) {
+            printf("replay: identical\n");
+        } else {
+            printf("replay: diverged at tick %zu\n", replay.divergence);
+            ret = 2;
+        }
+    }
+
+    g_replay_close(&replay);
+
+    g_world_delete(&world);
+    g_pack_close(&pack);
+    g_level_cache_delete(&levels);
+    g_trace_shutdown();
+    sg_shutdown();
+
+    return ret;
+}
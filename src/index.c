@@ -34,17 +34,46 @@ void _stable_index_print(stable_index *stack) {
     printf("\n");
 }
 
-void stable_index_init(stable_index *index, size_t capacity,
-                       size_t view_capacity) {
-    index->capacity = capacity;
-    index->view_capacity = view_capacity;
+static size_t stable_index_arrays(stable_index *index,
+                                  g_alloc_soa_array *arrays) {
+    arrays[0] = (g_alloc_soa_array){(void **)&index->available,
+                                    sizeof(stable_index_t)};
+    arrays[1] = (g_alloc_soa_array){(void **)&index->generations,
+                                    sizeof(stable_index_t)};
+    arrays[2] = (g_alloc_soa_array){(void **)&index->masks,
+                                    sizeof(stable_index_mask_t)};
+    return 3;
+}
+
+static size_t stable_index_view_arrays(stable_index *index,
+                                       g_alloc_soa_array *arrays) {
+    arrays[0] = (g_alloc_soa_array){(void **)&index->views,
+                                    sizeof(stable_index_view)};
+    arrays[1] = (g_alloc_soa_array){(void **)&index->view_keys,
+                                    sizeof(stable_index_view_key)};
+    return 2;
+}
+
+bool stable_index_init(stable_index *index, g_allocator *allocator,
+                       size_t capacity, size_t view_capacity) {
+    *index = (stable_index){
+        .capacity = capacity,
+        .view_capacity = view_capacity,
+        .allocator = allocator,
+    };
 
-    index->available = malloc(sizeof(stable_index_t) * capacity);
-    index->generations = malloc(sizeof(stable_index_t) * capacity);
-    index->masks = malloc(sizeof(stable_index_mask_t) * capacity);
+    g_alloc_soa_array arrays[3];
 
-    index->views = malloc(sizeof(stable_index_view) * view_capacity);
-    index->view_keys = malloc(sizeof(stable_index_view) * view_capacity);
+    index->block = g_alloc_soa(allocator, G_ALLOC_TAG_INDEX, capacity, arrays,
+                               stable_index_arrays(index, arrays));
+    index->view_block =
+        g_alloc_soa(allocator, G_ALLOC_TAG_INDEX, view_capacity, arrays,
+                    stable_index_view_arrays(index, arrays));
+
+    if (index->block == NULL || index->view_block == NULL) {
+        stable_index_delete(index);
+        return false;
+    }
 
     // Reversed order for easy yoinks
     for (size_t i = 0; i < capacity; i++) {
@@ -60,6 +89,8 @@ void stable_index_init(stable_index *index, size_t capacity,
     printf("\ng_stable_index_init\n");
     _stable_index_print(index);
 #endif
+
+    return true;
 }
 
 stable_index_view *stable_index_add_view(stable_index *index,
@@ -69,6 +100,13 @@ stable_index_view *stable_index_add_view(stable_index *index,
         return nullptr;
     }
 
+    stable_index_t *indices =
+        g_alloc(index->allocator, G_ALLOC_TAG_INDEX,
+                sizeof(stable_index_t) * index->capacity, G_ALLOC_SOA_ALIGN);
+    if (indices == NULL) {
+        return nullptr;
+    }
+
     stable_index_view *view = &index->views[index->view_size];
 
     index->view_keys[index->view_size] = (stable_index_view_key){
@@ -77,7 +115,7 @@ stable_index_view *stable_index_add_view(stable_index *index,
     };
 
     view->mask = mask;
-    view->indices = malloc(sizeof(stable_index_t) * index->capacity);
+    view->indices = indices;
 
     view->size = 0;
     view->capacity = index->capacity;
@@ -162,8 +200,44 @@ void stable_index_view_update(stable_index_view *view,
     view->size++;
 }
 
+// Whether idx is in the available list, kept in descending order.
+static bool stable_index_is_free(const stable_index *index,
+                                 stable_index_t idx) {
+    size_t lo = 0;
+    size_t hi = index->availiable_size;
+
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (index->available[mid] == idx) {
+            return true;
+        }
+
+        if (index->available[mid] > idx) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return false;
+}
+
+// A free index keeps its generation, so a handle to it still matches
+static bool stable_index_is_live(const stable_index *index,
+                                 stable_index_handle handle) {
+    return handle.index < index->capacity &&
+           handle.generation == index->generations[handle.index] &&
+           !stable_index_is_free(index, handle.index);
+}
+
 // Remove a living actor
-void stable_index_remove(stable_index_handle handle, stable_index *stack) {
+bool stable_index_remove(stable_index_handle handle, stable_index *stack) {
+    if (!stable_index_is_live(stack, handle)) {
+        printf("Removing a stale handle { i: %u, g: %u }!\n", handle.index,
+               handle.generation);
+        return false;
+    }
+
     int32_t i = stack->availiable_size - 1;
 
     // Shift elements that are smaller than value
@@ -177,22 +251,52 @@ void stable_index_remove(stable_index_handle handle, stable_index *stack) {
     stack->availiable_size++;
 
     for (int j = 0; j < stack->view_size; j++) {
-        if (stable_index_mask_contains(stack->views[j].mask, stack->masks[i])) {
+        if (stable_index_mask_contains(stack->masks[handle.index],
+                                       stack->views[j].mask)) {
             stable_index_view_remove(&stack->views[j], handle.index);
         }
     }
+    stack->masks[handle.index] = 0;
 
 #ifdef DEBUG_STABLE_INDEX
     printf("\ng_stable_index_remove\n");
     _stable_index_print(stack);
 #endif
+
+    return true;
+}
+
+bool stable_index_set_mask(stable_index *index, stable_index_handle handle,
+                           stable_index_mask_t mask) {
+    if (!stable_index_is_live(index, handle)) {
+        printf("Masking a stale handle { i: %u, g: %u }!\n", handle.index,
+               handle.generation);
+        return false;
+    }
+
+    const stable_index_mask_t old = index->masks[handle.index];
+    index->masks[handle.index] = mask;
+
+    // Only the views the element enters or leaves change
+    for (size_t j = 0; j < index->view_size; j++) {
+        const bool was = stable_index_mask_contains(old, index->views[j].mask);
+        const bool is = stable_index_mask_contains(mask, index->views[j].mask);
+
+        if (was && !is) {
+            stable_index_view_remove(&index->views[j], handle.index);
+        } else if (!was && is) {
+            stable_index_view_add(&index->views[j], handle.index);
+        }
+    }
+
+    return true;
 }
 
 void stable_index_view_remove(stable_index_view *view,
                               const stable_index_t idx) {
     int32_t i = 0;
 
-    while (view->indices[i] != idx && i < view->size) {
+    while (i < view->size && view->indices[i] != idx) {
         i++;
     }
 
@@ -210,13 +314,23 @@ void stable_index_view_remove(stable_index_view *view,
 
 void stable_index_delete(stable_index *index) {
     for (int i = 0; i < index->view_size; i++) {
-        free(index->views[i].indices);
+        g_free(index->allocator, G_ALLOC_TAG_INDEX, index->views[i].indices,
+               sizeof(stable_index_t) * index->views[i].capacity,
+               G_ALLOC_SOA_ALIGN);
     }
 
-    free(index->available);
-    free(index->generations);
-    free(index->masks);
+    g_alloc_soa_array arrays[3];
 
-    free(index->view_keys);
-    free(index->views);
+    g_free(index->allocator, G_ALLOC_TAG_INDEX, index->block,
+           g_alloc_soa_size(index->capacity, arrays,
+                            stable_index_arrays(index, arrays)),
+           G_ALLOC_SOA_ALIGN);
+    g_free(index->allocator, G_ALLOC_TAG_INDEX, index->view_block,
+           g_alloc_soa_size(index->view_capacity, arrays,
+                            stable_index_view_arrays(index, arrays)),
+           G_ALLOC_SOA_ALIGN);
+
+    index->block = NULL;
+    index->view_block = NULL;
+    index->view_size = 0;
 }
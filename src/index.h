@@ -4,6 +4,8 @@
 
 #include <stddef.h>
 
+#include "alloc.h"
+
 typedef unsigned int stable_index_t;
 typedef unsigned short stable_index_mask_t;
 
@@ -50,14 +52,21 @@ typedef struct {
 
     size_t view_size;
     size_t view_capacity;
+
+    // Owns available, generations and masks, then views and view_keys, as
+    // two SoA blocks. View indices are allocated separately.
+    g_allocator *allocator;
+    void *block;
+    void *view_block;
 } stable_index;
 
 // Check the remaining capacity
 size_t stable_index_remaining_cap(stable_index *index);
 
-// Populate a new stable index with default values
-void stable_index_init(stable_index *index, size_t capacity,
-                       size_t view_capacity);
+// Populate a new stable index with default values, allocating from
+// allocator. Returns false if out of memory.
+bool stable_index_init(stable_index *index, g_allocator *allocator,
+                       size_t capacity, size_t view_capacity);
 
 // Add a new view to an index, derived from a given mask.
 stable_index_view *stable_index_add_view(stable_index *index,
@@ -90,8 +99,14 @@ static inline bool stable_index_mask_contains(stable_index_mask_t a,
 void stable_index_view_add(stable_index_view *view, const stable_index_t idx);
 
 // Free an 'alive' index handle, incrementing the generation and moving the
-// id into the 'available' list.
-void stable_index_remove(stable_index_handle handle, stable_index *stack);
+// id into the 'available' list. Stale handles and indices that are already
+// free are ignored, returning false.
+bool stable_index_remove(stable_index_handle handle, stable_index *stack);
+
+// Change the mask of an 'alive' index handle, moving it in and out of views
+// accordingly. Stale handles and free indices are ignored, returning false.
+bool stable_index_set_mask(stable_index *index, stable_index_handle handle,
+                           stable_index_mask_t mask);
 
 // Remove an element from an index.
 // Use stable_index_mask_contains to check if the element belongs to the
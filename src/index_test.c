@@ -0,0 +1,416 @@
+// Differential test and microbenchmark for the stable index. Randomized
+// create, remove and mask sequences run against a plain reference model that
+// is compared with the index after every step, then every operation is timed
+// at capacities from 512 to 1M.
+#define SOKOL_TIME_IMPL
+#include <sokol/sokol_time.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "index.h"
+
+#define G_INDEX_TEST_VIEWS 5
+
+// Views kept by the test, the same shape as the actor stack's: everything,
+// single bits and a bit combination.
+static const stable_index_mask_t g_index_test_view_masks[G_INDEX_TEST_VIEWS] =
+    {0, 1, 2, 4, 1 | 8};
+
+// Masks draw from the low 4 bits, so every view sees entries come and go
+#define G_INDEX_TEST_MASK_BITS 0xf
+
+static uint64_t g_index_rng_state;
+
+// splitmix64, independent from the game's g_rng so index.c is all this
+// links against
+static uint64_t g_index_rng(void) {
+    uint64_t z = (g_index_rng_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Reference model, the obvious O(capacity) implementation of the contract
+typedef struct {
+    size_t capacity;
+    bool *alive;
+    stable_index_t *generations;
+    stable_index_mask_t *masks;
+    size_t alive_size;
+
+    // Alive handles in no particular order, for picking random ones
+    stable_index_handle *handles;
+    size_t *handle_slots;
+} g_index_model;
+
+static void g_index_model_init(g_index_model *model, size_t capacity) {
+    model->capacity = capacity;
+    model->alive = calloc(capacity, sizeof(bool));
+    model->generations = calloc(capacity, sizeof(stable_index_t));
+    model->masks = calloc(capacity, sizeof(stable_index_mask_t));
+    model->alive_size = 0;
+    model->handles = malloc(sizeof(stable_index_handle) * capacity);
+    model->handle_slots = malloc(sizeof(size_t) * capacity);
+}
+
+static void g_index_model_delete(g_index_model *model) {
+    free(model->alive);
+    free(model->generations);
+    free(model->masks);
+    free(model->handles);
+    free(model->handle_slots);
+}
+
+// The lowest free index is always handed out first
+static stable_index_handle g_index_model_create(g_index_model *model,
+                                                stable_index_mask_t mask) {
+    stable_index_t idx = 0;
+    while (model->alive[idx]) {
+        idx++;
+    }
+
+    model->alive[idx] = true;
+    model->masks[idx] = mask;
+
+    const stable_index_handle handle = {
+        .index = idx,
+        .generation = model->generations[idx],
+    };
+    model->handle_slots[idx] = model->alive_size;
+    model->handles[model->alive_size++] = handle;
+
+    return handle;
+}
+
+static void g_index_model_remove(g_index_model *model,
+                                 stable_index_handle handle) {
+    const size_t slot = model->handle_slots[handle.index];
+    const stable_index_handle last = model->handles[--model->alive_size];
+
+    model->handles[slot] = last;
+    model->handle_slots[last.index] = slot;
+
+    model->alive[handle.index] = false;
+    model->masks[handle.index] = 0;
+    model->generations[handle.index]++;
+}
+
+static void g_index_init_views(stable_index *index) {
+    for (int v = 0; v < G_INDEX_TEST_VIEWS; v++) {
+        stable_index_add_view(index, g_index_test_view_masks[v]);
+    }
+}
+
+// Compare everything observable, returns false and reports the first
+// difference.
+static bool g_index_check(stable_index *index, const g_index_model *model,
+                          uint64_t step) {
+    if (stable_index_remaining_cap(index) !=
+        model->capacity - model->alive_size) {
+        printf("step %llu: remaining capacity %zu, expected %zu\n",
+               (unsigned long long)step, stable_index_remaining_cap(index),
+               model->capacity - model->alive_size);
+        return false;
+    }
+
+    for (size_t i = 0; i < model->capacity; i++) {
+        if (index->generations[i] != model->generations[i] ||
+            index->masks[i] != model->masks[i]) {
+            printf("step %llu: index %zu has generation %u mask %u, "
+                   "expected %u and %u\n",
+                   (unsigned long long)step, i, index->generations[i],
+                   index->masks[i], model->generations[i], model->masks[i]);
+            return false;
+        }
+    }
+
+    for (int v = 0; v < G_INDEX_TEST_VIEWS; v++) {
+        const stable_index_mask_t mask = g_index_test_view_masks[v];
+        const stable_index_view *view = stable_index_get_view(index, mask);
+
+        if (view == NULL) {
+            printf("step %llu: view %u is missing\n",
+                   (unsigned long long)step, mask);
+            return false;
+        }
+
+        // Views hold exactly the matching alive indices, ascending
+        stable_index_t k = 0;
+        for (size_t i = 0; i < model->capacity; i++) {
+            if (!model->alive[i] ||
+                !stable_index_mask_contains(model->masks[i], mask)) {
+                continue;
+            }
+
+            if (k >= view->size || view->indices[k] != i) {
+                printf("step %llu: view %u is missing index %zu\n",
+                       (unsigned long long)step, mask, i);
+                return false;
+            }
+            k++;
+        }
+
+        if (k != view->size) {
+            printf("step %llu: view %u has %u indices, expected %u\n",
+                   (unsigned long long)step, mask, view->size, k);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool g_index_check_handle(stable_index_handle got,
+                                 stable_index_handle expected,
+                                 uint64_t step) {
+    if (got.index != expected.index || got.generation != expected.generation) {
+        printf("step %llu: created { i: %u, g: %u }, expected "
+               "{ i: %u, g: %u }\n",
+               (unsigned long long)step, got.index, got.generation,
+               expected.index, expected.generation);
+        return false;
+    }
+
+    return true;
+}
+
+// One randomized sequence. The create/remove balance drifts over time so
+// the index runs both nearly empty and completely full.
+static bool g_index_test_run(size_t capacity, uint64_t steps) {
+    stable_index index;
+    if (!stable_index_init(&index, &g_heap_allocator, capacity,
+                           G_INDEX_TEST_VIEWS)) {
+        return false;
+    }
+    g_index_init_views(&index);
+
+    g_index_model model;
+    g_index_model_init(&model, capacity);
+
+    // Last removed handle
+    stable_index_handle stale = {.index = 0, .generation = 0};
+    bool has_stale = false;
+
+    bool ok = g_index_check(&index, &model, 0);
+    for (uint64_t step = 1; ok && step <= steps; step++) {
+        const uint32_t create_bias = (step / 256) % 2 ? 70 : 30;
+        const uint32_t roll = g_index_rng() % 100;
+
+        if (roll < 10 && model.alive_size > 0) {
+            const stable_index_handle handle =
+                model.handles[g_index_rng() % model.alive_size];
+            const stable_index_mask_t mask =
+                g_index_rng() & G_INDEX_TEST_MASK_BITS;
+
+            ok = stable_index_set_mask(&index, handle, mask);
+            model.masks[handle.index] = mask;
+        } else if (roll < 10 + create_bias &&
+                   model.alive_size < model.capacity) {
+            const stable_index_mask_t mask =
+                g_index_rng() & G_INDEX_TEST_MASK_BITS;
+
+            ok = g_index_check_handle(stable_index_create_mask(&index, mask),
+                                      g_index_model_create(&model, mask),
+                                      step);
+        } else if (model.alive_size > 0) {
+            stale = model.handles[g_index_rng() % model.alive_size];
+            has_stale = true;
+
+            ok = stable_index_remove(stale, &index);
+            g_index_model_remove(&model, stale);
+        }
+
+        ok = ok && g_index_check(&index, &model, step);
+    }
+
+    // Removing a handle again must be a no-op, even once its index is reused
+    if (ok && has_stale) {
+        ok = !stable_index_remove(stale, &index) &&
+             g_index_check(&index, &model, steps + 1);
+    }
+
+    // Free indices keep their generation, a handle matching it still isn't
+    // alive and mustn't be freed twice
+    if (ok && index.availiable_size > 0) {
+        const stable_index_t free_index = index.available[0];
+        const stable_index_handle unused = {
+            .index = free_index,
+            .generation = index.generations[free_index],
+        };
+
+        ok = !stable_index_remove(unused, &index) &&
+             !stable_index_set_mask(&index, unused, G_INDEX_TEST_MASK_BITS) &&
+             g_index_check(&index, &model, steps + 2);
+    }
+
+    stable_index_delete(&index);
+    g_index_model_delete(&model);
+
+    return ok;
+}
+
+typedef struct {
+    uint64_t ops;
+    uint64_t ticks;
+} g_index_timing;
+
+static double g_index_ops_per_sec(g_index_timing timing) {
+    return timing.ticks > 0 ? timing.ops / stm_sec(timing.ticks) : 0.0;
+}
+
+// Time each operation at one capacity. The index is filled to half capacity,
+// then churned with random removes and creates, re-masked and drained.
+static void g_index_bench_run(FILE *out, bool first, size_t capacity,
+                              double seconds) {
+    stable_index index;
+    if (!stable_index_init(&index, &g_heap_allocator, capacity,
+                           G_INDEX_TEST_VIEWS)) {
+        return;
+    }
+    g_index_init_views(&index);
+
+    stable_index_handle *handles =
+        malloc(sizeof(stable_index_handle) * capacity);
+    size_t size = 0;
+
+    g_index_timing fill = {0}, churn = {0}, mask = {0}, drain = {0};
+
+    uint64_t start = stm_now();
+    while (size < capacity / 2) {
+        handles[size++] = stable_index_create_mask(
+            &index, g_index_rng() & G_INDEX_TEST_MASK_BITS);
+        fill.ops++;
+    }
+    fill.ticks = stm_since(start);
+
+    // Remove + create pairs, checking the clock every 64 pairs
+    start = stm_now();
+    do {
+        for (int i = 0; i < 64; i++) {
+            const size_t slot = g_index_rng() % size;
+
+            stable_index_remove(handles[slot], &index);
+            handles[slot] = stable_index_create_mask(
+                &index, g_index_rng() & G_INDEX_TEST_MASK_BITS);
+        }
+        churn.ops += 128;
+    } while (stm_sec(stm_since(start)) < seconds);
+    churn.ticks = stm_since(start);
+
+    start = stm_now();
+    do {
+        for (int i = 0; i < 64; i++) {
+            stable_index_set_mask(&index, handles[g_index_rng() % size],
+                                  g_index_rng() & G_INDEX_TEST_MASK_BITS);
+        }
+        mask.ops += 64;
+    } while (stm_sec(stm_since(start)) < seconds);
+    mask.ticks = stm_since(start);
+
+    // Random order, so views shift from everywhere
+    for (size_t i = size; i > 1; i--) {
+        const size_t j = g_index_rng() % i;
+        const stable_index_handle t = handles[i - 1];
+        handles[i - 1] = handles[j];
+        handles[j] = t;
+    }
+
+    start = stm_now();
+    while (size > 0 && stm_sec(stm_since(start)) < seconds) {
+        stable_index_remove(handles[--size], &index);
+        drain.ops++;
+    }
+    drain.ticks = stm_since(start);
+
+    fprintf(out,
+            "%s  {\"capacity\": %zu, \"ops_per_sec\": {\"create\": %.0f, "
+            "\"churn\": %.0f, \"set_mask\": %.0f, \"remove\": %.0f}}",
+            first ? "" : ",\n", capacity, g_index_ops_per_sec(fill),
+            g_index_ops_per_sec(churn), g_index_ops_per_sec(mask),
+            g_index_ops_per_sec(drain));
+    fflush(out);
+
+    free(handles);
+    stable_index_delete(&index);
+}
+
+static void usage(const char *name) {
+    printf("usage: %s [--test | --bench] [--steps N] [--seconds S] "
+           "[--seed N] [--out PATH]\n",
+           name);
+}
+
+int main(int argc, char *argv[]) {
+    bool test = true;
+    bool bench = true;
+    uint64_t steps = 20000;
+    double seconds = 0.25;
+    uint64_t seed = 1;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--test") == 0) {
+            bench = false;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            test = false;
+        } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            steps = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    g_index_rng_state = seed;
+    stm_setup();
+
+    if (test) {
+        // Small capacities fill up and empty out many times over
+        static const size_t capacities[] = {1, 7, 64, 512};
+
+        for (size_t c = 0; c < sizeof(capacities) / sizeof(*capacities);
+             c++) {
+            if (!g_index_test_run(capacities[c], steps)) {
+                printf("stable_index: FAILED at capacity %zu, seed %llu\n",
+                       capacities[c], (unsigned long long)seed);
+                return 1;
+            }
+        }
+
+        printf("stable_index: %llu steps at 4 capacities passed\n",
+               (unsigned long long)steps);
+    }
+
+    if (bench) {
+        FILE *out = stdout;
+        if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+            printf("Couldn't open %s!\n", out_path);
+            return 1;
+        }
+
+        static const size_t capacities[] = {512,    4096,   32768,
+                                            262144, 1 << 20};
+
+        fprintf(out, "{\"results\": [\n");
+        for (size_t c = 0; c < sizeof(capacities) / sizeof(*capacities);
+             c++) {
+            g_index_bench_run(out, c == 0, capacities[c], seconds);
+        }
+        fprintf(out, "\n]}\n");
+
+        if (out != stdout) {
+            fclose(out);
+        }
+    }
+
+    return 0;
+}
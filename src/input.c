@@ -0,0 +1,65 @@
+// sokol_app event handling, only linked into the windowed build.
+#include "common.h"
+
+#include <sokol/sokol_app.h>
+
+void g_player_input_map(const sapp_event *event, g_input_map *imap) {
+    bool update_dir = false;
+    if (event->type == SAPP_EVENTTYPE_UNFOCUSED) {
+        imap->left = false;
+        imap->right = false;
+        imap->up = false;
+        imap->down = false;
+        imap->fire = false;
+
+        update_dir = true;
+    } else if (event->type == SAPP_EVENTTYPE_KEY_DOWN ||
+               event->type == SAPP_EVENTTYPE_KEY_UP) {
+        bool val = event->type == SAPP_EVENTTYPE_KEY_DOWN;
+
+        if (event->key_code == SAPP_KEYCODE_A) {
+            imap->left = val;
+        } else if (event->key_code == SAPP_KEYCODE_D) {
+            imap->right = val;
+        } else if (event->key_code == SAPP_KEYCODE_W) {
+            imap->up = val;
+        } else if (event->key_code == SAPP_KEYCODE_S) {
+            imap->down = val;
+        }
+        update_dir = true;
+    } else if ((event->type == SAPP_EVENTTYPE_MOUSE_DOWN ||
+                event->type == SAPP_EVENTTYPE_MOUSE_UP) &&
+               event->mouse_button == SAPP_MOUSEBUTTON_LEFT) {
+        imap->fire = event->type == SAPP_EVENTTYPE_MOUSE_DOWN;
+    }
+
+    if (update_dir) {
+        g_input_map_direction(imap);
+    }
+}
+
+void g_camera_mouse(const sapp_event *event, g_camera *camera) {
+    if (event->type == SAPP_EVENTTYPE_MOUSE_MOVE) {
+        vec2 mouse_pos;
+        glm_vec2((vec2){event->mouse_x, event->mouse_y}, mouse_pos);
+        glm_vec2_copy(mouse_pos, camera->mouse_pos);
+
+        vec2 norm_mouse_pos;
+        glm_vec2_div(mouse_pos, (vec2){sapp_widthf(), sapp_heightf()},
+                     norm_mouse_pos);
+
+        float aspect = sapp_widthf() / sapp_heightf();
+
+        float w = camera->view_height * aspect;
+        float h = camera->view_height;
+
+        float hw = w * 0.5f;
+        float hh = h * 0.5f;
+
+        float mx = -hw + w * norm_mouse_pos[0];
+        float my = hh - h * norm_mouse_pos[1];
+
+        // TODO: Move world position logic into update().
+        glm_vec2((vec2){mx, my}, camera->mouse_world_pos);
+    }
+}
@@ -0,0 +1,597 @@
+#include "level.h"
+#include "polygon.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Obstacle cells per render batch side, unless that's too many batches
+#define G_LEVEL_CHUNK_CELLS 8
+// Points of an obstacle outline at most
+#define G_LEVEL_MAX_SIDES 1024
+
+// Kept clear around the origin, where the player starts
+static const float g_level_spawn_radius = 8.0f;
+static const float g_level_wall_width = 2.0f;
+
+void g_level_params_defaults(g_level_params *params, uint64_t seed) {
+    *params = (g_level_params){
+        .seed = seed,
+        .radius = 64.0f,
+        .cell_size = 6.0f,
+        .fill = 0.6f,
+        .hole_chance = 0.25f,
+        .sides = 12,
+        .wall_sides = 128,
+    };
+}
+
+static bool g_level_reserve(g_level *level, size_t count) {
+    if (level->vertex_count + count <= level->vertex_capacity) {
+        return true;
+    }
+
+    const size_t capacity =
+        max(level->vertex_capacity * 2, level->vertex_count + count);
+    g_vertex *moved =
+        g_realloc(level->allocator, G_ALLOC_TAG_MESHES, level->vertices,
+                  sizeof(g_vertex) * level->vertex_capacity,
+                  sizeof(g_vertex) * capacity, alignof(g_vertex));
+    if (moved == NULL) {
+        return false;
+    }
+
+    level->vertices = moved;
+    level->vertex_capacity = capacity;
+    return true;
+}
+
+static bool g_level_reserve_segments(g_level *level, size_t count) {
+    g_level_walls *walls = &level->walls;
+    if (walls->segment_count + count <= walls->segment_capacity) {
+        return true;
+    }
+
+    const size_t capacity =
+        max((size_t)walls->segment_capacity * 2, walls->segment_count + count);
+    vec4 *moved = g_realloc(level->allocator, G_ALLOC_TAG_MESHES,
+                            walls->segments,
+                            sizeof(vec4) * walls->segment_capacity,
+                            sizeof(vec4) * capacity, alignof(vec4));
+    if (moved == NULL) {
+        return false;
+    }
+
+    walls->segments = moved;
+    walls->segment_capacity = (uint32_t)capacity;
+    return true;
+}
+
+static bool g_level_push_batch(g_level *level, size_t first) {
+    if (level->vertex_count == first) {
+        return true;
+    }
+
+    if (level->batch_count == level->batch_capacity) {
+        const size_t capacity = max(level->batch_capacity * 2, (size_t)16);
+        g_level_batch *moved =
+            g_realloc(level->allocator, G_ALLOC_TAG_MESHES, level->batches,
+                      sizeof(g_level_batch) * level->batch_capacity,
+                      sizeof(g_level_batch) * capacity,
+                      alignof(g_level_batch));
+        if (moved == NULL) {
+            return false;
+        }
+
+        level->batches = moved;
+        level->batch_capacity = capacity;
+    }
+
+    level->batches[level->batch_count++] = (g_level_batch){
+        .first = (uint32_t)first,
+        .count = (uint32_t)(level->vertex_count - first),
+    };
+    return true;
+}
+
+// Triangulate the rings into the current batch and keep their edges as
+// walls.
+static bool g_level_polygon(g_level *level, g_arena *scratch,
+                            const vec2 *points, const uint32_t *ring_ends,
+                            size_t ring_count, const uint8_t color[4]) {
+    const size_t mark = g_arena_mark(scratch);
+    const uint32_t point_count = ring_ends[ring_count - 1];
+
+    uint32_t *indices = g_arena_push_array(
+        scratch, uint32_t,
+        g_polygon_max_triangles(point_count, ring_count) * 3);
+    size_t triangle_count;
+
+    if (indices == NULL ||
+        !g_polygon_triangulate(points, ring_ends, ring_count, scratch,
+                               indices, &triangle_count) ||
+        !g_level_reserve(level, triangle_count * 3) ||
+        !g_level_reserve_segments(level, point_count)) {
+        g_arena_rewind(scratch, mark);
+        return false;
+    }
+
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        level->vertices[level->vertex_count++] = (g_vertex){
+            points[indices[i]][0], points[indices[i]][1],
+            color[0], color[1], color[2], color[3],
+        };
+    }
+
+    g_level_walls *walls = &level->walls;
+    for (uint32_t r = 0, start = 0; r < ring_count; start = ring_ends[r++]) {
+        for (uint32_t i = start; i < ring_ends[r]; i++) {
+            const uint32_t j = i + 1 < ring_ends[r] ? i + 1 : start;
+            glm_vec4_copy((vec4){points[i][0], points[i][1], points[j][0],
+                                 points[j][1]},
+                          walls->segments[walls->segment_count++]);
+        }
+    }
+
+    g_arena_rewind(scratch, mark);
+    return true;
+}
+
+// Star shaped outline around center, with a hole inside some of them.
+static bool g_level_obstacle(g_level *level, g_arena *scratch, g_rng *rng,
+                             const vec2 center, float radius,
+                             uint32_t sides, bool hole) {
+    const uint32_t hole_sides = hole ? max(sides / 2, 3u) : 0;
+    const size_t mark = g_arena_mark(scratch);
+    vec2 *points = g_arena_push_array(scratch, vec2, sides + hole_sides);
+    if (points == NULL) {
+        return false;
+    }
+
+    // Angles stay increasing, so the outline is simple
+    const float step = 2.0f * GLM_PIf / sides;
+    for (uint32_t k = 0; k < sides; k++) {
+        const float angle = step * (k + rand_float(rng, -0.3f, 0.3f));
+        const float r = radius * rand_float(rng, 0.7f, 1.0f);
+        points[k][0] = center[0] + cosf(angle) * r;
+        points[k][1] = center[1] + sinf(angle) * r;
+    }
+
+    // Inside the outline's edges for 6 or more sides
+    for (uint32_t k = 0; k < hole_sides; k++) {
+        const float angle = 2.0f * GLM_PIf * k / hole_sides;
+        const float r = radius * 0.35f * rand_float(rng, 0.8f, 1.0f);
+        points[sides + k][0] = center[0] + cosf(angle) * r;
+        points[sides + k][1] = center[1] + sinf(angle) * r;
+    }
+
+    const uint8_t shade = (uint8_t)(108 + g_rng_next(rng) % 40);
+    const uint32_t ring_ends[2] = {sides, sides + hole_sides};
+
+    const bool ok = g_level_polygon(level, scratch, points, ring_ends,
+                                    hole ? 2 : 1,
+                                    (uint8_t[4]){shade, shade, shade, 255});
+    g_arena_rewind(scratch, mark);
+    return ok;
+}
+
+static bool g_level_wall(g_level *level, g_arena *scratch) {
+    const g_level_params *params = &level->params;
+    const uint32_t sides = params->wall_sides;
+
+    const size_t mark = g_arena_mark(scratch);
+    vec2 *points = g_arena_push_array(scratch, vec2, sides * 2);
+    if (points == NULL) {
+        return false;
+    }
+
+    const float outer = params->radius + g_level_wall_width;
+    for (uint32_t k = 0; k < sides; k++) {
+        const float angle = 2.0f * GLM_PIf * k / sides;
+        points[k][0] = cosf(angle) * outer;
+        points[k][1] = sinf(angle) * outer;
+        points[sides + k][0] = cosf(angle) * params->radius;
+        points[sides + k][1] = sinf(angle) * params->radius;
+    }
+
+    const bool ok =
+        g_level_polygon(level, scratch, points, (uint32_t[2]){sides, sides * 2},
+                        2, (uint8_t[4]){64, 64, 72, 255});
+    g_arena_rewind(scratch, mark);
+    return ok;
+}
+
+// Bucket every segment in each cell its bounds overlap.
+static bool g_level_walls_build(g_level *level) {
+    g_level_walls *walls = &level->walls;
+    const float extent = level->params.radius + g_level_wall_width;
+
+    walls->cell_size = level->params.cell_size;
+    walls->inv_cell_size = 1.0f / walls->cell_size;
+    walls->origin[0] = -extent;
+    walls->origin[1] = -extent;
+    walls->size = (uint32_t)ceilf(2.0f * extent * walls->inv_cell_size);
+
+    const size_t cells = (size_t)walls->size * walls->size;
+    walls->cell_start = g_alloc(level->allocator, G_ALLOC_TAG_MESHES,
+                                sizeof(uint32_t) * (cells + 1),
+                                alignof(uint32_t));
+    if (walls->cell_start == NULL) {
+        return false;
+    }
+    memset(walls->cell_start, 0, sizeof(uint32_t) * (cells + 1));
+
+    // Counted one cell ahead, the prefix sum leaves every cell's start
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t s = 0; s < walls->segment_count; s++) {
+            const float *segment = walls->segments[s];
+            const int32_t x0 = max(
+                (int32_t)floorf((fminf(segment[0], segment[2]) -
+                                 walls->origin[0]) * walls->inv_cell_size),
+                0);
+            const int32_t y0 = max(
+                (int32_t)floorf((fminf(segment[1], segment[3]) -
+                                 walls->origin[1]) * walls->inv_cell_size),
+                0);
+            const int32_t x1 = min(
+                (int32_t)floorf((fmaxf(segment[0], segment[2]) -
+                                 walls->origin[0]) * walls->inv_cell_size),
+                (int32_t)walls->size - 1);
+            const int32_t y1 = min(
+                (int32_t)floorf((fmaxf(segment[1], segment[3]) -
+                                 walls->origin[1]) * walls->inv_cell_size),
+                (int32_t)walls->size - 1);
+
+            for (int32_t y = y0; y <= y1; y++) {
+                for (int32_t x = x0; x <= x1; x++) {
+                    const size_t c = (size_t)y * walls->size + x;
+
+                    if (pass == 0) {
+                        walls->cell_start[c + 1]++;
+                    } else {
+                        walls->cell_segments[walls->cell_start[c]++] = s;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (size_t c = 0; c < cells; c++) {
+                walls->cell_start[c + 1] += walls->cell_start[c];
+            }
+
+            walls->cell_segment_count = walls->cell_start[cells];
+            walls->cell_segments = g_alloc(
+                level->allocator, G_ALLOC_TAG_MESHES,
+                sizeof(uint32_t) * walls->cell_segment_count,
+                alignof(uint32_t));
+            if (walls->cell_segments == NULL) {
+                return false;
+            }
+        }
+    }
+
+    // Filling moved every start to the next cell's
+    for (size_t c = cells; c > 0; c--) {
+        walls->cell_start[c] = walls->cell_start[c - 1];
+    }
+    walls->cell_start[0] = 0;
+
+    return true;
+}
+
+static bool g_level_build(g_level *level, g_arena *scratch) {
+    const g_level_params *params = &level->params;
+    const float cell_size = params->cell_size;
+    const uint32_t sides =
+        min(max(params->sides, 3u), (uint32_t)G_LEVEL_MAX_SIDES);
+
+    const uint32_t cells =
+        (uint32_t)ceilf(2.0f * params->radius / cell_size);
+    const uint32_t chunks = min(
+        max((cells + G_LEVEL_CHUNK_CELLS - 1) / G_LEVEL_CHUNK_CELLS, 1u),
+        (uint32_t)G_LEVEL_MAX_CHUNKS);
+    const uint32_t chunk_cells = (cells + chunks - 1) / chunks;
+
+    const uint64_t seed_hash =
+        g_hash_bytes(G_HASH_SEED, &params->seed, sizeof(params->seed));
+
+    // Cells in chunk order, so every chunk's triangles are contiguous
+    for (uint32_t cy = 0; cy < chunks; cy++) {
+        for (uint32_t cx = 0; cx < chunks; cx++) {
+            const size_t first = level->vertex_count;
+
+            for (uint32_t y = cy * chunk_cells;
+                 y < min((cy + 1) * chunk_cells, cells); y++) {
+                for (uint32_t x = cx * chunk_cells;
+                     x < min((cx + 1) * chunk_cells, cells); x++) {
+                    // Seeded per cell, independent of the visiting order
+                    g_rng rng;
+                    g_rng_seed(&rng, g_hash_bytes(seed_hash,
+                                                  (uint32_t[2]){x, y},
+                                                  sizeof(uint32_t[2])));
+
+                    if (rand_float(&rng, 0.0f, 1.0f) >= params->fill) {
+                        continue;
+                    }
+
+                    const float jitter = cell_size * 0.15f;
+                    vec2 center = {
+                        -params->radius + (x + 0.5f) * cell_size +
+                            rand_float(&rng, -jitter, jitter),
+                        -params->radius + (y + 0.5f) * cell_size +
+                            rand_float(&rng, -jitter, jitter),
+                    };
+                    const float radius =
+                        cell_size * rand_float(&rng, 0.2f, 0.35f);
+                    const float distance = g_vec2_length(center);
+
+                    if (distance - radius < g_level_spawn_radius ||
+                        distance + radius > params->radius) {
+                        continue;
+                    }
+
+                    const bool hole = sides >= 6 &&
+                                      rand_float(&rng, 0.0f, 1.0f) <
+                                          params->hole_chance;
+                    if (!g_level_obstacle(level, scratch, &rng, center,
+                                          radius, sides, hole)) {
+                        return false;
+                    }
+                }
+            }
+
+            if (!g_level_push_batch(level, first)) {
+                return false;
+            }
+        }
+    }
+
+    const size_t first = level->vertex_count;
+    return (params->wall_sides < 3 || g_level_wall(level, scratch)) &&
+           g_level_push_batch(level, first) && g_level_walls_build(level);
+}
+
+bool g_level_generate(g_level *level, g_allocator *allocator,
+                      const g_level_params *params) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "level_generate");
+
+    *level = (g_level){
+        .params = *params,
+        .allocator = allocator,
+    };
+
+    g_arena *scratch = g_scratch();
+    if (scratch == NULL || !g_level_build(level, scratch)) {
+        printf("Couldn't generate level %llu!\n",
+               (unsigned long long)params->seed);
+        g_level_delete(level);
+        G_TRACE_END(G_TRACE_SYSTEM, "level_generate");
+        return false;
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "level_generate");
+    return true;
+}
+
+void g_level_delete(g_level *level) {
+    g_level_walls *walls = &level->walls;
+
+    g_free(level->allocator, G_ALLOC_TAG_MESHES, level->vertices,
+           sizeof(g_vertex) * level->vertex_capacity, alignof(g_vertex));
+    g_free(level->allocator, G_ALLOC_TAG_MESHES, level->batches,
+           sizeof(g_level_batch) * level->batch_capacity,
+           alignof(g_level_batch));
+    g_free(level->allocator, G_ALLOC_TAG_MESHES, walls->segments,
+           sizeof(vec4) * walls->segment_capacity, alignof(vec4));
+    g_free(level->allocator, G_ALLOC_TAG_MESHES, walls->cell_start,
+           sizeof(uint32_t) * ((size_t)walls->size * walls->size + 1),
+           alignof(uint32_t));
+    g_free(level->allocator, G_ALLOC_TAG_MESHES, walls->cell_segments,
+           sizeof(uint32_t) * walls->cell_segment_count, alignof(uint32_t));
+
+    *level = (g_level){0};
+}
+
+static inline float g_level_cross(float ax, float ay, float bx, float by) {
+    return ax * by - ay * bx;
+}
+
+bool g_level_walls_raycast(const g_level_walls *walls, const vec2 p,
+                           const vec2 d, float *t) {
+    const float inv = walls->inv_cell_size;
+    const int32_t x0 = max(
+        (int32_t)floorf((fminf(p[0], p[0] + d[0]) - walls->origin[0]) * inv),
+        0);
+    const int32_t y0 = max(
+        (int32_t)floorf((fminf(p[1], p[1] + d[1]) - walls->origin[1]) * inv),
+        0);
+    const int32_t x1 = min(
+        (int32_t)floorf((fmaxf(p[0], p[0] + d[0]) - walls->origin[0]) * inv),
+        (int32_t)walls->size - 1);
+    const int32_t y1 = min(
+        (int32_t)floorf((fmaxf(p[1], p[1] + d[1]) - walls->origin[1]) * inv),
+        (int32_t)walls->size - 1);
+
+    float best = 1.0f;
+    bool hit = false;
+
+    // Steps are short next to cells, a segment in two cells is tested twice
+    for (int32_t y = y0; y <= y1; y++) {
+        for (int32_t x = x0; x <= x1; x++) {
+            const size_t c = (size_t)y * walls->size + x;
+
+            for (uint32_t i = walls->cell_start[c];
+                 i < walls->cell_start[c + 1]; i++) {
+                const float *s = walls->segments[walls->cell_segments[i]];
+                const float ex = s[2] - s[0];
+                const float ey = s[3] - s[1];
+
+                const float denom = g_level_cross(d[0], d[1], ex, ey);
+                if (denom == 0.0f) {
+                    continue;
+                }
+
+                const float wx = s[0] - p[0];
+                const float wy = s[1] - p[1];
+                const float ts = g_level_cross(wx, wy, ex, ey) / denom;
+                const float u = g_level_cross(wx, wy, d[0], d[1]) / denom;
+
+                if (ts >= 0.0f && ts < best && u >= 0.0f && u <= 1.0f) {
+                    best = ts;
+                    hit = true;
+                }
+            }
+        }
+    }
+
+    *t = best;
+    return hit;
+}
+
+bool g_level_walls_push(const g_level_walls *walls, const vec2 center,
+                        float radius, vec2 push) {
+    const float inv = walls->inv_cell_size;
+    const int32_t x0 = max(
+        (int32_t)floorf((center[0] - radius - walls->origin[0]) * inv), 0);
+    const int32_t y0 = max(
+        (int32_t)floorf((center[1] - radius - walls->origin[1]) * inv), 0);
+    const int32_t x1 =
+        min((int32_t)floorf((center[0] + radius - walls->origin[0]) * inv),
+            (int32_t)walls->size - 1);
+    const int32_t y1 =
+        min((int32_t)floorf((center[1] + radius - walls->origin[1]) * inv),
+            (int32_t)walls->size - 1);
+
+    float cx = center[0];
+    float cy = center[1];
+    bool hit = false;
+
+    // A segment in two cells is seen twice, the second time it's resolved
+    for (int32_t y = y0; y <= y1; y++) {
+        for (int32_t x = x0; x <= x1; x++) {
+            const size_t c = (size_t)y * walls->size + x;
+
+            for (uint32_t i = walls->cell_start[c];
+                 i < walls->cell_start[c + 1]; i++) {
+                const float *s = walls->segments[walls->cell_segments[i]];
+                const float ex = s[2] - s[0];
+                const float ey = s[3] - s[1];
+                const float length2 = ex * ex + ey * ey;
+
+                // Closest point of the segment
+                const float u =
+                    length2 > 0.0f
+                        ? glm_clamp(((cx - s[0]) * ex + (cy - s[1]) * ey) /
+                                        length2,
+                                    0.0f, 1.0f)
+                        : 0.0f;
+                float nx = cx - (s[0] + u * ex);
+                float ny = cy - (s[1] + u * ey);
+                const float distance2 = nx * nx + ny * ny;
+
+                if (distance2 >= radius * radius) {
+                    continue;
+                }
+
+                float distance = sqrtf(distance2);
+                if (distance == 0.0f) {
+                    // Centered on the wall, leave by its left side
+                    if (length2 == 0.0f) {
+                        continue;
+                    }
+                    nx = -ey / sqrtf(length2);
+                    ny = ex / sqrtf(length2);
+                } else {
+                    nx /= distance;
+                    ny /= distance;
+                }
+
+                cx += nx * (radius - distance);
+                cy += ny * (radius - distance);
+                hit = true;
+            }
+        }
+    }
+
+    push[0] = cx - center[0];
+    push[1] = cy - center[1];
+    return hit;
+}
+
+bool g_level_cache_init(g_level_cache *cache, g_allocator *allocator) {
+    *cache = (g_level_cache){.allocator = allocator};
+
+    return g_pool_init(&cache->pool, allocator, G_ALLOC_TAG_MESHES,
+                       sizeof(g_level_cache_entry), G_LEVEL_CACHE_SIZE);
+}
+
+void g_level_cache_delete(g_level_cache *cache) {
+    for (size_t i = 0; i < cache->count; i++) {
+        g_level_delete(&cache->entries[i]->level);
+    }
+
+    cache->count = 0;
+    g_pool_delete(&cache->pool);
+}
+
+const g_level *g_level_cache_acquire(g_level_cache *cache,
+                                     const g_level_params *params) {
+    const uint64_t key = g_hash_bytes(G_HASH_SEED, params, sizeof(*params));
+    cache->clock++;
+
+    for (size_t i = 0; i < cache->count; i++) {
+        g_level_cache_entry *entry = cache->entries[i];
+
+        if (entry->key == key &&
+            memcmp(&entry->level.params, params, sizeof(*params)) == 0) {
+            entry->references++;
+            entry->used = cache->clock;
+            cache->hits++;
+            return &entry->level;
+        }
+    }
+
+    cache->misses++;
+
+    if (cache->count == G_LEVEL_CACHE_SIZE) {
+        size_t lru = SIZE_MAX;
+        for (size_t i = 0; i < cache->count; i++) {
+            if (cache->entries[i]->references == 0 &&
+                (lru == SIZE_MAX ||
+                 cache->entries[i]->used < cache->entries[lru]->used)) {
+                lru = i;
+            }
+        }
+
+        if (lru == SIZE_MAX) {
+            printf("Every cached level is held!\n");
+            return NULL;
+        }
+
+        g_level_delete(&cache->entries[lru]->level);
+        g_pool_free(&cache->pool, cache->entries[lru]);
+        cache->entries[lru] = cache->entries[--cache->count];
+    }
+
+    g_level_cache_entry *entry = g_pool_alloc(&cache->pool);
+    if (!g_level_generate(&entry->level, cache->allocator, params)) {
+        g_pool_free(&cache->pool, entry);
+        return NULL;
+    }
+
+    entry->key = key;
+    entry->references = 1;
+    entry->used = cache->clock;
+    cache->entries[cache->count++] = entry;
+
+    return &entry->level;
+}
+
+void g_level_cache_release(g_level_cache *cache, const g_level *level) {
+    (void)cache;
+
+    // The level is the entry's first member
+    g_level_cache_entry *entry = (g_level_cache_entry *)level;
+    entry->references--;
+}
@@ -0,0 +1,127 @@
+// Procedural arenas: a ring of wall around polygon obstacles, triangulated
+// into render batches plus wall segments for collision. Generated levels
+// are cached by their parameters.
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "arena.h"
+#include "common.h"
+
+// Render batches per side of the arena at most, each one static mesh
+#define G_LEVEL_MAX_CHUNKS 24
+// Generated levels kept around
+#define G_LEVEL_CACHE_SIZE 8
+// Depth of every batch, like the default level
+#define G_LEVEL_DEPTH -8.0f
+
+// Everything a level derives from. No padding, so equal parameters compare
+// equal byte for byte.
+typedef struct {
+    uint64_t seed;
+    // Walls enclose a circle of this radius around the origin
+    float radius;
+    // Obstacles sit on a jittered grid of square cells
+    float cell_size;
+    // Chance of a cell holding an obstacle, and of an obstacle having a hole
+    float fill;
+    float hole_chance;
+    // Points of every obstacle outline, at least 3
+    uint32_t sides;
+    // Points of each of the wall's circles
+    uint32_t wall_sides;
+} g_level_params;
+
+// A small arena of a few thousand triangles.
+void g_level_params_defaults(g_level_params *params, uint64_t seed);
+
+// World space triangle list range of one static mesh.
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+} g_level_batch;
+
+// Every polygon edge, bucketed in a uniform grid over the level.
+typedef struct {
+    vec2 origin;
+    float cell_size;
+    float inv_cell_size;
+    // Cells per side
+    uint32_t size;
+
+    // Segment a to b as {ax, ay, bx, by}
+    vec4 *segments;
+    uint32_t segment_count;
+    uint32_t segment_capacity;
+
+    // Segments of cell c are cell_segments[cell_start[c]..cell_start[c + 1]]
+    uint32_t *cell_start;
+    uint32_t *cell_segments;
+    uint32_t cell_segment_count;
+} g_level_walls;
+
+typedef struct {
+    g_level_params params;
+
+    g_vertex *vertices;
+    size_t vertex_count;
+    size_t vertex_capacity;
+
+    g_level_batch *batches;
+    size_t batch_count;
+    size_t batch_capacity;
+
+    g_level_walls walls;
+
+    g_allocator *allocator;
+} g_level;
+
+// Returns false if out of memory, leaving nothing to delete.
+bool g_level_generate(g_level *level, g_allocator *allocator,
+                      const g_level_params *params);
+void g_level_delete(g_level *level);
+
+// First wall hit by the segment from p to p + d, as a fraction of d.
+bool g_level_walls_raycast(const g_level_walls *walls, const vec2 p,
+                           const vec2 d, float *t);
+
+// Move a circle out of every wall it overlaps, one wall after the other.
+// Writes the total displacement to push, false if it touched none. Actors
+// are pushed as their bounding circle, not their exact shape.
+bool g_level_walls_push(const g_level_walls *walls, const vec2 center,
+                        float radius, vec2 push);
+
+typedef struct {
+    g_level level;
+    uint64_t key;
+    // Users holding the level, which is never evicted while held
+    uint32_t references;
+    uint64_t used;
+} g_level_cache_entry;
+
+// The last G_LEVEL_CACHE_SIZE levels asked for, least recently used ones
+// make room for new ones.
+typedef struct {
+    g_pool pool;
+    g_level_cache_entry *entries[G_LEVEL_CACHE_SIZE];
+    size_t count;
+    uint64_t clock;
+
+    g_allocator *allocator;
+
+    // Counters
+    uint64_t hits;
+    uint64_t misses;
+} g_level_cache;
+
+// Returns false if out of memory.
+bool g_level_cache_init(g_level_cache *cache, g_allocator *allocator);
+// Frees every level, held or not.
+void g_level_cache_delete(g_level_cache *cache);
+
+// The level of params, generated unless cached. Stays valid until released,
+// NULL if out of memory or every cached level is held.
+const g_level *g_level_cache_acquire(g_level_cache *cache,
+                                     const g_level_params *params);
+void g_level_cache_release(g_level_cache *cache, const g_level *level);
+
+#endif
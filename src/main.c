@@ -10,32 +10,115 @@
 #include <sokol/sokol_log.h>
 #include <sokol/sokol_time.h>
 
-#include <minitrace/minitrace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "common.h"
+#include "cull.h"
+#include "render.h"
 #include "shaders.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "trace.h"
 #include "world.h"
 
+#ifndef __EMSCRIPTEN__
+#include "net.h"
+#endif
+
+// Instances of every projectile and particle, and the draw commands
+#define G_FRAME_ARENA_SIZE ((size_t)4 << 20)
+
 static struct {
     sg_pipeline pipeline;
+    sg_pipeline instanced_pipeline;
     sg_bindings triangle_bind;
+    sg_bindings projectile_bind;
+    sg_bindings particle_bind;
     sg_pass_action pass_action;
 
+    // Reset at the top of frame(), holds instances and draw commands
+    g_arena frame_arena;
+    size_t projectile_count;
+    size_t particle_count;
+
+    // Vertex range of every shape in triangle_bind's buffer. Shapes
+    // registered after it was made are drawn as the triangle.
+    uint32_t shape_first[G_SHAPE_MAX];
+    uint32_t shape_count[G_SHAPE_MAX];
+
+    g_render render;
+    uint8_t main_pipeline_id;
+    uint8_t instanced_pipeline_id;
+
+    // --pack, shaders and the default level, baked ones without it
+    const char *pack_path;
+    g_pack pack;
+    // --arena, F6 and F7 step through the generated levels of other seeds
+    bool arena;
+    uint64_t arena_seed;
+    g_level_cache levels;
+    const g_level *level;
+
+    // --record / --replay
+    const char *record_path;
+    const char *replay_path;
+    // --trace / --trace-level / --trace-sample
+    const char *trace_path;
+    enum g_trace_level trace_level;
+    uint32_t trace_sample;
+    g_replay replay;
+    // Last seconds of fixed ticks, Backspace steps back through them
+    g_rewind rewind;
+
+#ifndef __EMSCRIPTEN__
+    // --connect, mirrors a server's world instead of simulating one
+    char connect_host[64];
+    uint16_t connect_port;
+    bool online;
+    g_net_client client;
+#endif
+
     g_world world;
+    g_visible_set visible;
+
+    // Always recorded, F3 shows the overlay and F2 dumps it
+    g_telemetry telemetry;
+    bool show_overlay;
+    sg_bindings overlay_bind;
+    g_vertex overlay_vertices[G_TELEMETRY_OVERLAY_VERTICES];
+    size_t overlay_count;
 
     uint64_t time;
 } state;
 
+// Whether the world mirrors a server's.
+static inline bool g_online(void) {
+#ifndef __EMSCRIPTEN__
+    return state.online;
+#else
+    return false;
+#endif
+}
+
+// Source of a shader from the pack, or the one baked into shaders.h.
+const char *g_shader_source(const char *name, const unsigned char *baked) {
+    const char *source = g_pack_shader(&state.pack, name);
+    return source != NULL ? source : (const char *)baked;
+}
+
 void create_main_pipeline() {
     sg_shader shader = sg_make_shader(&(sg_shader_desc){
         .vertex_func =
             (sg_shader_function){
-                .source = (const char *)shader_vert,
+                .source = g_shader_source("vert", shader_vert),
                 .entry = "main",
             },
         .fragment_func =
             (sg_shader_function){
-                .source = (const char *)shader_frag,
+                .source = g_shader_source("frag", shader_frag),
                 .entry = "main",
             },
 
@@ -113,40 +196,266 @@ void create_main_pipeline() {
     });
 }
 
+// Pipeline for per-instance positioned and oriented triangles.
+void create_instanced_pipeline() {
+    sg_shader shader = sg_make_shader(&(sg_shader_desc){
+        .vertex_func =
+            (sg_shader_function){
+                .source = g_shader_source("instanced_vert",
+                                          shader_instanced_vert),
+                .entry = "main",
+            },
+        .fragment_func =
+            (sg_shader_function){
+                .source = g_shader_source("frag", shader_frag),
+                .entry = "main",
+            },
+
+        .uniform_blocks =
+            {
+                [0] =
+                    {
+                        .size = sizeof(mat4),
+                        .stage = SG_SHADERSTAGE_VERTEX,
+
+                        .glsl_uniforms =
+                            {
+                                [0] =
+                                    {
+                                        .type = SG_UNIFORMTYPE_MAT4,
+                                        .glsl_name = "uVP",
+                                    },
+                            },
+                    },
+                [1] =
+                    {
+                        .size = sizeof(vec4),
+                        .stage = SG_SHADERSTAGE_VERTEX,
+
+                        .glsl_uniforms =
+                            {
+                                [0] =
+                                    {
+                                        .type = SG_UNIFORMTYPE_FLOAT4,
+                                        .glsl_name = "uColor",
+                                    },
+                            },
+                    },
+            },
+
+        .attrs =
+            {
+                [0] = {.glsl_name = "aPosition"},
+                [1] = {.glsl_name = "aColor"},
+                [2] = {.glsl_name = "aInstance"},
+                [3] = {.glsl_name = "aInstanceColor"},
+            },
+    });
+
+    state.instanced_pipeline = sg_make_pipeline(&(sg_pipeline_desc){
+        .face_winding = SG_FACEWINDING_CCW,
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLES,
+        .shader = shader,
+        .depth =
+            {
+                .write_enabled = true,
+                .compare = SG_COMPAREFUNC_LESS_EQUAL,
+            },
+        .layout =
+            {
+                .buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE,
+                .attrs =
+                    {
+                        [0] = {.format = SG_VERTEXFORMAT_FLOAT2,
+                               .buffer_index = 0},
+                        [1] = {.format = SG_VERTEXFORMAT_UBYTE4N,
+                               .buffer_index = 0},
+                        [2] = {.format = SG_VERTEXFORMAT_FLOAT4,
+                               .buffer_index = 1},
+                        [3] = {.format = SG_VERTEXFORMAT_UBYTE4N,
+                               .buffer_index = 1},
+                    },
+            },
+        .cull_mode = SG_CULLMODE_BACK,
+    });
+}
+
 // Triangle with a diameter of ~1.
+// Every registered shape, one after another. The triangle comes first, its
+// 3 vertices are what projectiles and particles draw instanced.
 void create_triangle_binding() {
-    // const float vertices[] = {0.5f,   0.0f,    0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-    //                           -0.25f, 0.433f,  0.0f, 1.0f, 1.0f, 1.0f, 1.0f,
-    //                           -0.25f, -0.433f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f};
-
-    const g_vertex vertices[] = {
-        {0.5f, 0.0f, 255, 255, 255, 255},
-        {-0.25f, 0.433f, 255, 255, 255, 255},
-        {-0.25f, -0.433f, 255, 255, 255, 255},
-    };
+    g_vertex vertices[G_SHAPE_MAX * G_SHAPE_MAX_TRIANGLE_POINTS];
+    uint32_t count = 0;
+
+    for (size_t s = 0; s < G_SHAPE_MAX; s++) {
+        state.shape_first[s] = 0;
+        state.shape_count[s] = 3;
+
+        if (s >= g_shapes.count) {
+            continue;
+        }
+
+        vec2 points[G_SHAPE_MAX_TRIANGLE_POINTS];
+        const uint32_t n = g_shape_triangulate(g_shape_get(s), points);
+
+        state.shape_first[s] = count;
+        state.shape_count[s] = n;
+        for (uint32_t i = 0; i < n; i++) {
+            vertices[count++] =
+                (g_vertex){points[i][0], points[i][1], 255, 255, 255, 255};
+        }
+    }
 
     state.triangle_bind.vertex_buffers[0] = sg_make_buffer(&(sg_buffer_desc){
-        .data = SG_RANGE(vertices),
+        .data = {.ptr = vertices, .size = sizeof(g_vertex) * count},
     });
 }
 
-void init(void) {
-    MTR_META_PROCESS_NAME("ctest");
-    MTR_META_THREAD_NAME("main thread");
+void create_projectile_binding() {
+    state.projectile_bind.vertex_buffers[0] =
+        state.triangle_bind.vertex_buffers[0];
+    state.projectile_bind.vertex_buffers[1] = sg_make_buffer(&(sg_buffer_desc){
+        .usage = {.vertex_buffer = true, .stream_update = true},
+        .size = sizeof(g_instance) * MAX_G_PROJECTILES,
+    });
+}
 
-    srand(time(NULL));
+void create_particle_binding() {
+    state.particle_bind.vertex_buffers[0] =
+        state.triangle_bind.vertex_buffers[0];
+    state.particle_bind.vertex_buffers[1] = sg_make_buffer(&(sg_buffer_desc){
+        .usage = {.vertex_buffer = true, .stream_update = true},
+        .size = sizeof(g_instance) * MAX_G_PARTICLES,
+    });
+}
+
+// Telemetry bars, drawn in clip space over everything else.
+void create_overlay_binding() {
+    state.overlay_bind.vertex_buffers[0] = sg_make_buffer(&(sg_buffer_desc){
+        .usage = {.vertex_buffer = true, .stream_update = true},
+        .size = sizeof(state.overlay_vertices),
+    });
+}
+
+// Show the generated level of params. Rewinding across the switch would
+// replay ticks against the wrong walls, so the history starts over.
+bool g_load_level(const g_level_params *params) {
+    const g_level *level = g_level_cache_acquire(&state.levels, params);
+    if (level == NULL) {
+        return false;
+    }
+
+    // Whatever was added borrows from the new level, keep it either way
+    const bool ok = g_world_load_generated(&state.world, level);
+    if (state.level != NULL) {
+        g_level_cache_release(&state.levels, state.level);
+    }
+    state.level = level;
+    state.arena_seed = params->seed;
+
+    if (state.world.rewind != NULL) {
+        g_rewind_delete(&state.rewind);
+        if (!g_rewind_init(&state.rewind, &state.world, 32 << 20, 4 * 64)) {
+            state.world.rewind = NULL;
+        }
+    }
+
+    return ok;
+}
+
+bool g_load_arena(uint64_t seed) {
+    g_level_params params;
+    g_level_params_defaults(&params, seed);
+    return g_load_level(&params);
+}
+
+void init(void) {
     sg_setup(&(sg_desc){
         .environment = sglue_environment(),
+        .buffer_pool_size = G_WORLD_BUFFER_POOL_SIZE,
         .logger.func = slog_func,
     });
 
     stm_setup();
+
+    if (state.trace_path != NULL) {
+        g_trace_init(state.trace_path, state.trace_level, state.trace_sample);
+    }
+    g_trace_thread_name("main thread");
     state.time = 0;
 
-    g_world_init(&state.world);
+    uint64_t seed = (uint64_t)time(NULL);
+
+    g_level_params arena_params;
+    g_level_params_defaults(&arena_params, state.arena_seed);
+
+    if (state.replay_path != NULL &&
+        g_replay_load(&state.replay, state.replay_path)) {
+        seed = state.replay.seed;
+
+        // Play in the level it was recorded in
+        state.arena = state.replay.level.radius > 0.0f;
+        arena_params = state.replay.level;
+    } else if (state.record_path != NULL) {
+        g_replay_record(&state.replay, state.record_path, seed,
+                        state.arena ? &arena_params : NULL);
+    }
+
+    // Nothing to draw without them, frame runs even after sapp_quit
+    if (!g_world_init(&state.world, &g_heap_allocator, seed) ||
+        !g_arena_init(&state.frame_arena, &g_heap_allocator,
+                      G_ALLOC_TAG_FRAME, G_FRAME_ARENA_SIZE)) {
+        exit(1);
+    }
+
+    // Replaces the level g_world_init builds in code
+    if (state.pack_path != NULL && g_pack_open(&state.pack, state.pack_path)) {
+        g_world_load_level(&state.world, &state.pack, "default");
+    }
+
+    if (state.arena && (!g_level_cache_init(&state.levels, &g_heap_allocator) ||
+                        !g_load_level(&arena_params))) {
+        state.arena = false;
+    }
+
+#ifndef __EMSCRIPTEN__
+    if (state.connect_host[0] != '\0') {
+        state.online = g_net_client_init(&state.client, state.connect_host,
+                                         state.connect_port);
+    }
+#endif
+
+    if (state.replay.ticks != NULL || state.replay.file != NULL) {
+        state.world.replay = &state.replay;
+    } else if (!g_online() &&
+               g_rewind_init(&state.rewind, &state.world, 32 << 20, 4 * 64)) {
+        state.world.rewind = &state.rewind;
+    }
+    g_visible_set_init(&state.visible, state.world.static_meshes.capacity);
+    g_telemetry_init(&state.telemetry);
 
     create_triangle_binding();
+    create_projectile_binding();
+    create_particle_binding();
+    create_overlay_binding();
     create_main_pipeline();
+    create_instanced_pipeline();
+
+    g_render_init(&state.render, 4096);
+    state.main_pipeline_id =
+        g_render_add_pipeline(&state.render, &(g_render_pipeline){
+                                                 .pipeline = state.pipeline.id,
+                                                 .vp_slot = 1,
+                                                 .model_slot = 0,
+                                                 .color_slot = 2,
+                                             });
+    state.instanced_pipeline_id = g_render_add_pipeline(
+        &state.render, &(g_render_pipeline){
+                           .pipeline = state.instanced_pipeline.id,
+                           .vp_slot = 0,
+                           .model_slot = -1,
+                           .color_slot = 1,
+                       });
 
     state.pass_action = (sg_pass_action){
         .colors[0] =
@@ -160,42 +469,245 @@ void init(void) {
 void event(const sapp_event *event) {
     g_player_input_map(event, &state.world.player.input_map);
     g_camera_mouse(event, &state.world.camera);
+
+    if (event->type == SAPP_EVENTTYPE_KEY_DOWN && !event->key_repeat) {
+        if (event->key_code == SAPP_KEYCODE_F3) {
+            state.show_overlay = !state.show_overlay;
+            if (!state.show_overlay) {
+                sapp_set_window_title("Triangle");
+            }
+        } else if (event->key_code == SAPP_KEYCODE_F2) {
+            g_telemetry_dump_csv(&state.telemetry, "telemetry.csv");
+            g_telemetry_dump_json(&state.telemetry, "telemetry.json");
+        }
+    }
+
+    // Quick save, load and rewind, only while simulating without a replay
+    if (event->type == SAPP_EVENTTYPE_KEY_DOWN && !event->key_repeat &&
+        state.world.rewind != NULL) {
+        if (event->key_code == SAPP_KEYCODE_F5) {
+            g_world_snapshot_save(&state.world, "snapshot.ctri");
+        } else if (event->key_code == SAPP_KEYCODE_F9) {
+            g_world_snapshot_load(&state.world, "snapshot.ctri");
+        } else if (event->key_code == SAPP_KEYCODE_F6 && state.arena) {
+            g_load_arena(state.arena_seed + 1);
+        } else if (event->key_code == SAPP_KEYCODE_F7 && state.arena) {
+            g_load_arena(state.arena_seed - 1);
+        } else if (event->key_code == SAPP_KEYCODE_BACKSPACE) {
+            uint64_t oldest, newest;
+            if (g_rewind_range(&state.rewind, &oldest, &newest)) {
+                const uint64_t second = (uint64_t)(1.0f / g_fixed_dt);
+                g_world_rewind(&state.world,
+                               newest > oldest + second ? newest - second
+                                                        : oldest);
+            }
+        }
+    }
 }
 
+static const vec4 g_white = GLM_VEC4_ONE_INIT;
+
 void g_draw_actors() {
-    sg_apply_bindings(&state.triangle_bind);
+    const uint16_t bindings =
+        g_render_bindings(&state.render, &state.triangle_bind);
+    if (bindings == G_RENDER_NO_BINDINGS) {
+        return;
+    }
+
+    for (size_t i = 0; i < state.visible.actor_count; i++) {
+        uint32_t actor_idx = state.visible.actors[i];
+        const g_shape_id shape = state.world.actors.shapes[actor_idx];
+
+        g_render_push(
+            &state.render,
+            &(g_draw_cmd){
+                .key = g_render_key(
+                    state.main_pipeline_id, bindings,
+                    g_render_depth(state.world.actors.transforms[actor_idx].z)),
+                .model = &state.world.actors.global_transforms[actor_idx],
+                .color = &state.world.actors.colors[actor_idx],
+                .base_element = state.shape_first[shape],
+                .num_elements = state.shape_count[shape],
+                .num_instances = 1,
+            });
+    }
+}
+
+void g_draw_static() {
+    g_static_meshes *meshes = &state.world.static_meshes;
+
+    for (size_t v = 0; v < state.visible.static_count; v++) {
+        size_t i = state.visible.static_meshes[v];
+
+        const uint16_t bindings =
+            g_render_bindings(&state.render, &meshes->bindings[i]);
+        if (bindings == G_RENDER_NO_BINDINGS) {
+            continue;
+        }
+
+        g_render_push(&state.render,
+                      &(g_draw_cmd){
+                          .key = g_render_key(
+                              state.main_pipeline_id, bindings,
+                              g_render_depth(meshes->transforms[i][3][2])),
+                          .model = &meshes->transforms[i],
+                          .color = &g_white,
+                          .num_elements = meshes->sizes[i],
+                          .num_instances = 1,
+                      });
+    }
+}
 
-    stable_index_view *alive = state.world.actors.alive_view;
-    for (size_t i = 0; i < alive->size; i++) {
-        uint32_t actor_idx = alive->indices[i];
+// Stream instance data, must happen before the pass begins.
+void g_upload_instances() {
+    g_instance *projectile_instances = g_arena_push_array(
+        &state.frame_arena, g_instance, MAX_G_PROJECTILES);
+    state.projectile_count =
+        projectile_instances == NULL
+            ? 0
+            : g_projectiles_instances(&state.world.projectiles,
+                                      state.world.physics_tick, 0.3f,
+                                      (vec4){1.0f, 0.6f, 0.0f, 1.0f},
+                                      projectile_instances);
+
+    if (state.projectile_count > 0) {
+        sg_update_buffer(
+            state.projectile_bind.vertex_buffers[1],
+            &(sg_range){
+                .ptr = projectile_instances,
+                .size = sizeof(g_instance) * state.projectile_count,
+            });
+    }
 
-        mat4 *actor_global_transform =
-            &state.world.actors.global_transforms[actor_idx];
-        vec4 *actor_color = &state.world.actors.colors[actor_idx];
+    g_instance *particle_instances =
+        g_arena_push_array(&state.frame_arena, g_instance, MAX_G_PARTICLES);
+    state.particle_count =
+        particle_instances == NULL
+            ? 0
+            : g_particles_instances(&state.world.particles,
+                                    particle_instances);
+
+    if (state.particle_count > 0) {
+        sg_update_buffer(state.particle_bind.vertex_buffers[1],
+                         &(sg_range){
+                             .ptr = particle_instances,
+                             .size = sizeof(g_instance) * state.particle_count,
+                         });
+    }
+}
 
-        sg_apply_uniforms(0, &SG_RANGE(*actor_global_transform));
+void g_draw_instances(const sg_bindings *bindings, size_t count) {
+    if (count == 0) {
+        return;
+    }
 
-        sg_apply_uniforms(2, &SG_RANGE(*actor_color));
-        sg_draw(0, 3, 1);
+    const uint16_t id = g_render_bindings(&state.render, bindings);
+    if (id == G_RENDER_NO_BINDINGS) {
+        return;
     }
+
+    g_render_push(&state.render,
+                  &(g_draw_cmd){
+                      .key = g_render_key(state.instanced_pipeline_id, id,
+                                          g_render_depth(0.0f)),
+                      .color = &g_white,
+                      .num_elements = 3,
+                      .num_instances = count,
+                  });
 }
 
-void g_draw_static() {
-    sg_apply_uniforms(2, &SG_RANGE(GLM_VEC4_ONE));
+// Rebuild the overlay bars and put the headline numbers in the title, there
+// is no text rendering. Must happen before the pass begins.
+void g_upload_overlay() {
+    state.overlay_count = 0;
+    if (!state.show_overlay) {
+        return;
+    }
+
+    const g_telemetry *telemetry = &state.telemetry;
+    state.overlay_count = g_telemetry_overlay(
+        telemetry, state.overlay_vertices, G_TELEMETRY_OVERLAY_VERTICES);
 
-    for (size_t i = 0; i < state.world.static_meshes.size; i++) {
-        sg_apply_bindings(&state.world.static_meshes.bindings[i]);
-        sg_apply_uniforms(0,
-                          &SG_RANGE(state.world.static_meshes.transforms[i]));
-        sg_draw(0, state.world.static_meshes.sizes[i], 1);
+    if (state.overlay_count > 0) {
+        sg_update_buffer(state.overlay_bind.vertex_buffers[0],
+                         &(sg_range){
+                             .ptr = state.overlay_vertices,
+                             .size = sizeof(g_vertex) * state.overlay_count,
+                         });
     }
+
+    // Twice a second is plenty for a title
+    if (telemetry->frames % 32 == 0) {
+        g_telemetry_stats frame, physics, draw, pairs;
+        g_telemetry_summarize(telemetry, G_TELEMETRY_FRAME, &frame);
+        g_telemetry_summarize(telemetry, G_TELEMETRY_PHYSICS, &physics);
+        g_telemetry_summarize(telemetry, G_TELEMETRY_DRAW, &draw);
+        g_telemetry_summarize(telemetry, G_TELEMETRY_PAIRS_TESTED, &pairs);
+
+        char title[192];
+        snprintf(title, sizeof(title),
+                 "Triangle | frame %.2f/%.2f/%.2f ms | physics %.2f/%.2f "
+                 "ms | draw %.2f/%.2f ms | %u alive, %.0f pairs",
+                 frame.p50, frame.p95, frame.p99, physics.p50, physics.p99,
+                 draw.p50, draw.p99, state.world.actors.alive_view->size,
+                 pairs.p50);
+        sapp_set_window_title(title);
+    }
+}
+
+void g_draw_overlay() {
+    if (state.overlay_count == 0) {
+        return;
+    }
+
+    // In front of everything, the depth test still applies
+    mat4 model = GLM_MAT4_IDENTITY_INIT;
+    model[3][2] = -1.0f;
+    mat4 vp = GLM_MAT4_IDENTITY_INIT;
+
+    sg_apply_pipeline(state.pipeline);
+    sg_apply_bindings(&state.overlay_bind);
+    sg_apply_uniforms(0, &SG_RANGE(model));
+    sg_apply_uniforms(1, &SG_RANGE(vp));
+    sg_apply_uniforms(2, &SG_RANGE(g_white));
+    sg_draw(0, state.overlay_count, 1);
 }
 
 void frame(void) {
-    MTR_BEGIN("frame", "frame");
+    g_trace_frame();
+    G_TRACE_BEGIN(G_TRACE_FRAME, "frame");
+    g_arena_reset(&state.frame_arena);
     float dt = stm_sec(stm_laptime(&state.time));
 
-    g_world_update(dt, &state.world);
+    g_telemetry *telemetry = &state.telemetry;
+    g_telemetry_add(telemetry, G_TELEMETRY_FRAME, dt * 1000.0f);
+    uint64_t lap = stm_now();
+
+#ifndef __EMSCRIPTEN__
+    if (g_online()) {
+        g_net_client_update(&state.client, dt, stm_sec(stm_now()),
+                            &state.world.player.input_map, &state.world.camera);
+        g_net_client_apply(&state.client, &state.world);
+
+        if (g_actor_stack_valid(&state.world.actors,
+                                state.world.player.actor_handle)) {
+            g_camera_update(&state.world.player, &state.world.actors, dt,
+                            &state.world.camera);
+        }
+    } else
+#endif
+    {
+        g_world_update(dt, &state.world);
+
+        if (!g_actor_stack_valid(&state.world.actors,
+                                 state.world.player.actor_handle)) {
+            sapp_quit();
+        }
+    }
+
+    g_telemetry_add(telemetry, G_TELEMETRY_WORLD_UPDATE,
+                    stm_ms(stm_laptime(&lap)));
+    g_telemetry_sample_world(telemetry, &state.world);
 
     mat4 view = GLM_MAT4_IDENTITY_INIT;
     g_camera_view(&state.world.camera, view);
@@ -207,36 +719,105 @@ void frame(void) {
     mat4 vp;
     glm_mat4_mul(projection, view, vp);
 
+    vec2 view_rect[2];
+    g_camera_rect(&state.world.camera, aspect, view_rect);
+    g_cull_static(&state.world.static_meshes, view_rect, &state.visible);
+    g_cull_actors(&state.world.actors, view_rect, &state.visible);
+
+    g_upload_instances();
+    g_upload_overlay();
+
+    g_render_begin(&state.render, &state.frame_arena);
+    g_draw_static();
+    g_draw_actors();
+    g_draw_instances(&state.particle_bind, state.particle_count);
+    g_draw_instances(&state.projectile_bind, state.projectile_count);
+
     sg_begin_pass(&(sg_pass){
         .action = state.pass_action,
         .swapchain = sglue_swapchain(),
     });
 
-    sg_apply_pipeline(state.pipeline);
-    sg_apply_uniforms(1, &SG_RANGE(vp));
-
-    g_draw_static();
-    g_draw_actors();
+    g_render_submit(&state.render, vp);
+    g_draw_overlay();
 
     sg_end_pass();
     sg_commit();
-    MTR_END("frame", "frame");
+
+    g_telemetry_add(telemetry, G_TELEMETRY_DRAW, stm_ms(stm_laptime(&lap)));
+    g_telemetry_add(telemetry, G_TELEMETRY_DRAW_CALLS,
+                    state.render.draw_calls);
+    g_telemetry_commit(telemetry);
+    G_TRACE_END(G_TRACE_FRAME, "frame");
 }
 
 void cleanup(void) {
+    // Static meshes borrow their vertices from the pack
     g_world_delete(&state.world);
+    g_pack_close(&state.pack);
+    g_level_cache_delete(&state.levels);
+    g_visible_set_delete(&state.visible);
+    g_arena_delete(&state.frame_arena);
+    g_replay_close(&state.replay);
+    g_rewind_delete(&state.rewind);
+#ifndef __EMSCRIPTEN__
+    if (g_online()) {
+        g_net_client_delete(&state.client);
+    }
+#endif
     sg_destroy_pipeline(state.pipeline);
+    sg_destroy_pipeline(state.instanced_pipeline);
 
     sg_shutdown();
 
-    mtr_flush();
-    mtr_shutdown();
+    g_trace_shutdown();
 }
 
 sapp_desc sokol_main(int argc, char *argv[]) {
-    mtr_init("trace.json");
-    (void)argc;
-    (void)argv;
+    // Debug builds trace everything by default, anything else on request
+#ifdef G_TRACE_DEFAULT_PATH
+    state.trace_path = G_TRACE_DEFAULT_PATH;
+#endif
+    state.trace_level = G_TRACE_DETAIL;
+    state.trace_sample = 1;
+#ifdef G_PACK_DEFAULT_PATH
+    state.pack_path = G_PACK_DEFAULT_PATH;
+#endif
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--pack") == 0) {
+            state.pack_path = argv[++i];
+        } else if (strcmp(argv[i], "--arena") == 0) {
+            state.arena = true;
+            state.arena_seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0) {
+            state.record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            state.replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            state.trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace-level") == 0) {
+            state.trace_level = (uint8_t)min(strtoul(argv[++i], NULL, 10),
+                                             (unsigned long)G_TRACE_DETAIL);
+        } else if (strcmp(argv[i], "--trace-sample") == 0) {
+            // Record one frame out of every N
+            state.trace_sample = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+#ifndef __EMSCRIPTEN__
+        else if (strcmp(argv[i], "--connect") == 0) {
+            // HOST[:PORT]
+            snprintf(state.connect_host, sizeof(state.connect_host), "%s",
+                     argv[++i]);
+            char *port = strchr(state.connect_host, ':');
+
+            state.connect_port = G_NET_DEFAULT_PORT;
+            if (port != NULL) {
+                *port = '\0';
+                state.connect_port = (uint16_t)strtoul(port + 1, NULL, 10);
+            }
+        }
+#endif
+    }
     return (sapp_desc){
         .init_cb = init,
         .event_cb = event,
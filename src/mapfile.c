@@ -0,0 +1,82 @@
+#include "mapfile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define G_MAPPED_FILE_MMAP
+#endif
+
+bool g_mapped_file_open(g_mapped_file *file, const char *path) {
+    *file = (g_mapped_file){0};
+
+#ifdef G_MAPPED_FILE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Couldn't open %s!\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Couldn't read %s!\n", path);
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        printf("Couldn't map %s!\n", path);
+        return false;
+    }
+
+    file->data = data;
+    file->size = st.st_size;
+    file->mapped = true;
+#else
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = size > 0 ? malloc(size) : NULL;
+    if (data == NULL || fread(data, size, 1, f) != 1) {
+        printf("Couldn't read %s!\n", path);
+        free(data);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    file->data = data;
+    file->size = size;
+#endif
+
+    return true;
+}
+
+void g_mapped_file_close(g_mapped_file *file) {
+    if (file->data == NULL) {
+        return;
+    }
+
+#ifdef G_MAPPED_FILE_MMAP
+    munmap((void *)file->data, file->size);
+#else
+    free((void *)file->data);
+#endif
+
+    file->data = NULL;
+    file->size = 0;
+}
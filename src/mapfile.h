@@ -0,0 +1,19 @@
+// Read-only view of a whole file, mmap'ed where available and read into
+// memory elsewhere.
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    bool mapped;
+} g_mapped_file;
+
+// Reports and returns false if the file can't be opened or is empty.
+bool g_mapped_file_open(g_mapped_file *file, const char *path);
+void g_mapped_file_close(g_mapped_file *file);
+
+#endif
@@ -0,0 +1,950 @@
+#include "net.h"
+#include "trace.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Packet layout (native endianness), every packet starts with the uint32
+// protocol id and a uint8 g_net_packet_type:
+// HELLO    -
+// WELCOME  uint32 actor index, uint32 actor generation, uint32 send interval
+// INPUT    uint32 ack, uint8 input bits, float mouse_world_pos[2],
+//          float camera_position[2]
+// SNAPSHOT uint32 sequence, uint32 baseline (0 for none), uint64 tick,
+//          uint32 checksum, uint16 record count, records
+// BYE      -
+//
+// Records are sorted by index: varint index gap, uint8 flags, then
+// NEW      varint generation, svarint x, y, uint16 rotation, int16 z,
+//          uint16 scale x, y, uint8 color[4]
+// REMOVE   -
+// else     svarint delta of each flagged field
+// Actors the record list doesn't mention are unchanged from the baseline.
+enum g_net_record_flags : uint8_t {
+    G_NET_RECORD_NEW = 1 << 0,
+    G_NET_RECORD_REMOVE = 1 << 1,
+    G_NET_RECORD_X = 1 << 2,
+    G_NET_RECORD_Y = 1 << 3,
+    G_NET_RECORD_ROTATION = 1 << 4,
+};
+
+#define G_NET_MAX_RECORD 40
+
+// ------------------------------- serialization -------------------------------
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} g_net_writer;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t cursor;
+    bool error;
+} g_net_reader;
+
+static inline void g_net_write(g_net_writer *w, const void *data,
+                               size_t size) {
+    memcpy(w->data + w->size, data, size);
+    w->size += size;
+}
+
+static inline void g_net_write_u8(g_net_writer *w, uint8_t v) {
+    w->data[w->size++] = v;
+}
+
+static inline void g_net_write_varint(g_net_writer *w, uint32_t v) {
+    while (v >= 0x80) {
+        w->data[w->size++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    w->data[w->size++] = (uint8_t)v;
+}
+
+// Zigzag, small magnitudes of either sign stay small
+static inline void g_net_write_svarint(g_net_writer *w, int32_t v) {
+    g_net_write_varint(w, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+static inline void g_net_read(g_net_reader *r, void *data, size_t size) {
+    if (r->cursor + size > r->size) {
+        r->error = true;
+        memset(data, 0, size);
+        return;
+    }
+
+    memcpy(data, r->data + r->cursor, size);
+    r->cursor += size;
+}
+
+static inline uint8_t g_net_read_u8(g_net_reader *r) {
+    uint8_t v;
+    g_net_read(r, &v, sizeof(v));
+    return v;
+}
+
+static inline uint32_t g_net_read_varint(g_net_reader *r) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t b = g_net_read_u8(r);
+        v |= (uint32_t)(b & 0x7f) << shift;
+
+        if ((b & 0x80) == 0 || r->error) {
+            return v;
+        }
+    }
+
+    r->error = true;
+    return v;
+}
+
+static inline int32_t g_net_read_svarint(g_net_reader *r) {
+    const uint32_t v = g_net_read_varint(r);
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static void g_net_write_header(g_net_writer *w, g_net_packet_type type) {
+    const uint32_t protocol = G_NET_PROTOCOL;
+    g_net_write(w, &protocol, sizeof(protocol));
+    g_net_write_u8(w, type);
+}
+
+// Returns the packet type, or -1 for foreign packets.
+static int g_net_read_header(g_net_reader *r) {
+    uint32_t protocol;
+    g_net_read(r, &protocol, sizeof(protocol));
+    const uint8_t type = g_net_read_u8(r);
+
+    if (r->error || protocol != G_NET_PROTOCOL) {
+        return -1;
+    }
+    return type;
+}
+
+static uint32_t g_net_checksum(const g_net_snapshot *snapshot) {
+    const uint64_t hash =
+        g_hash_bytes(G_HASH_SEED, snapshot->entities,
+                     sizeof(g_net_entity) * snapshot->count);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static void g_net_quantize(const g_actor_stack *stack, stable_index_t idx,
+                           g_net_entity *out) {
+    const g_transform *transform = &stack->transforms[idx];
+
+    out->handle = (stable_index_handle){
+        .index = idx,
+        .generation = stack->actor_index.generations[idx],
+    };
+    out->x = (int32_t)lroundf(transform->position[0] * G_NET_POSITION_SCALE);
+    out->y = (int32_t)lroundf(transform->position[1] * G_NET_POSITION_SCALE);
+    // Wraps to the full turn
+    out->rotation =
+        (uint16_t)(int32_t)lroundf(transform->rotation * (32768.0f / GLM_PIf));
+    out->z = (int16_t)lroundf(transform->z * 256.0f);
+    out->scale_x = (uint16_t)lroundf(transform->scale[0] * G_NET_SCALE_SCALE);
+    out->scale_y = (uint16_t)lroundf(transform->scale[1] * G_NET_SCALE_SCALE);
+
+    for (int i = 0; i < 4; i++) {
+        out->color[i] = g_color_channel(stack->colors[idx][i]);
+    }
+}
+
+static bool g_net_nonblocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static inline bool g_net_same_address(const struct sockaddr_in *a,
+                                      const struct sockaddr_in *b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr &&
+           a->sin_port == b->sin_port;
+}
+
+// ---------------------------------- server ----------------------------------
+
+bool g_net_server_init(g_net_server *server, uint16_t port) {
+    *server = (g_net_server){
+        .socket = socket(AF_INET, SOCK_DGRAM, 0),
+        .send_interval = 2,
+        .view_radius = 24.0f,
+    };
+
+    if (server->socket < 0) {
+        printf("Couldn't create the server socket!\n");
+        return false;
+    }
+
+    // Inputs of every client may arrive between two ticks
+    const int buffer = 1 << 20;
+    setsockopt(server->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    setsockopt(server->socket, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    if (bind(server->socket, (struct sockaddr *)&address, sizeof(address)) !=
+            0 ||
+        !g_net_nonblocking(server->socket)) {
+        printf("Couldn't bind the server to port %u!\n", port);
+        close(server->socket);
+        server->socket = -1;
+        return false;
+    }
+
+    server->clients = calloc(G_NET_MAX_CLIENTS, sizeof(g_net_client_slot));
+    if (server->clients == NULL) {
+        printf("Couldn't allocate the server's clients!\n");
+        close(server->socket);
+        server->socket = -1;
+        return false;
+    }
+
+    return true;
+}
+
+static g_net_client_slot *g_net_server_find(g_net_server *server,
+                                            const struct sockaddr_in *from) {
+    for (size_t i = 0; i < G_NET_MAX_CLIENTS; i++) {
+        g_net_client_slot *slot = &server->clients[i];
+        if (slot->active && g_net_same_address(&slot->address, from)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+static void g_net_server_welcome(g_net_server *server,
+                                 const g_net_client_slot *slot) {
+    uint8_t packet[32];
+    g_net_writer w = {.data = packet};
+
+    g_net_write_header(&w, G_NET_WELCOME);
+    g_net_write(&w, &slot->player.actor_handle.index, sizeof(uint32_t));
+    g_net_write(&w, &slot->player.actor_handle.generation, sizeof(uint32_t));
+    g_net_write(&w, &server->send_interval, sizeof(uint32_t));
+
+    sendto(server->socket, packet, w.size, 0,
+           (const struct sockaddr *)&slot->address, sizeof(slot->address));
+}
+
+static g_net_client_slot *g_net_server_join(g_net_server *server,
+                                            g_world *world,
+                                            const struct sockaddr_in *from) {
+    if (server->client_count == G_NET_MAX_CLIENTS ||
+        stable_index_remaining_cap(&world->actors.actor_index) == 0) {
+        printf("Reached client capacity!\n");
+        return NULL;
+    }
+
+    g_net_client_slot *slot = server->clients;
+    while (slot->active) {
+        slot++;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->active = true;
+    slot->address = *from;
+
+    slot->player.actor_handle = g_actor_stack_create(
+        &world->actors,
+        &(g_actor_stack_create_ctx){
+            .color = {0.2f, 0.2f, 0.2f, 1.0f},
+            .type = ACTOR_TYPE_PLAYER | ACTOR_TYPE_ALIVE,
+            .transform.position = {rand_float(&world->rng, -4.0f, 4.0f),
+                                   rand_float(&world->rng, -4.0f, 4.0f)},
+            .transform.scale = GLM_VEC2_ONE_INIT,
+            .drag = 3.0f,
+            .mass = 1.0f,
+        });
+    slot->camera.view_height = world->camera.view_height;
+
+    server->client_count++;
+    return slot;
+}
+
+static void g_net_server_leave(g_net_server *server, g_world *world,
+                               g_net_client_slot *slot) {
+    if (g_actor_stack_valid(&world->actors, slot->player.actor_handle)) {
+        g_actor_stack_remove(&world->actors, slot->player.actor_handle);
+    }
+
+    slot->active = false;
+    server->client_count--;
+}
+
+static void g_net_server_input(g_net_client_slot *slot, g_net_reader *r) {
+    uint32_t ack;
+    g_net_read(r, &ack, sizeof(ack));
+    const uint8_t input = g_net_read_u8(r);
+
+    vec2 mouse_world_pos, camera_position;
+    g_net_read(r, mouse_world_pos, sizeof(vec2));
+    g_net_read(r, camera_position, sizeof(vec2));
+
+    if (r->error) {
+        return;
+    }
+
+    // Only ever move the baseline forward, to a snapshot that was sent
+    if (ack <= slot->sequence && ack > slot->ack) {
+        slot->ack = ack;
+    }
+
+    g_replay_unpack_input(input, &slot->player.input_map);
+    glm_vec2_copy(mouse_world_pos, slot->camera.mouse_world_pos);
+    glm_vec2_copy(camera_position, slot->camera.position);
+}
+
+void g_net_server_receive(g_net_server *server, g_world *world, double now) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "server_receive");
+
+    uint8_t packet[G_NET_MAX_PACKET];
+    struct sockaddr_in from;
+    socklen_t from_size = sizeof(from);
+
+    ssize_t size;
+    while ((size = recvfrom(server->socket, packet, sizeof(packet), 0,
+                            (struct sockaddr *)&from, &from_size)) >= 0) {
+        g_net_reader r = {.data = packet, .size = (size_t)size};
+        const int type = g_net_read_header(&r);
+
+        server->packets_received++;
+
+        g_net_client_slot *slot = g_net_server_find(server, &from);
+
+        if (type == G_NET_HELLO) {
+            // Repeated hellos mean the welcome got lost
+            if (slot == NULL) {
+                slot = g_net_server_join(server, world, &from);
+            }
+            if (slot != NULL) {
+                slot->last_heard = now;
+                g_net_server_welcome(server, slot);
+            }
+        } else if (slot != NULL && type == G_NET_INPUT) {
+            slot->last_heard = now;
+            g_net_server_input(slot, &r);
+        } else if (slot != NULL && type == G_NET_BYE) {
+            g_net_server_leave(server, world, slot);
+        }
+
+        from_size = sizeof(from);
+    }
+
+    for (size_t i = 0; i < G_NET_MAX_CLIENTS; i++) {
+        g_net_client_slot *slot = &server->clients[i];
+        if (slot->active && now - slot->last_heard > G_NET_TIMEOUT) {
+            g_net_server_leave(server, world, slot);
+        }
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "server_receive");
+}
+
+void g_net_server_players(g_net_server *server, g_world *world, float dt) {
+    for (size_t i = 0; i < G_NET_MAX_CLIENTS; i++) {
+        g_net_client_slot *slot = &server->clients[i];
+
+        if (slot->active &&
+            g_actor_stack_valid(&world->actors, slot->player.actor_handle)) {
+            g_player_update(dt, &slot->player, &world->actors, &slot->camera);
+        }
+    }
+}
+
+// Quantize every alive actor once per send, shared by all clients.
+static void g_net_server_quantize(g_net_server *server,
+                                  const g_actor_stack *stack) {
+    memset(server->alive, 0, sizeof(server->alive));
+
+    const stable_index_view *alive = stack->alive_view;
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+
+        g_net_quantize(stack, idx, &server->quantized[idx]);
+        server->alive[idx] = true;
+    }
+}
+
+// Actors around the client's camera, in index order. Scanning the quantized
+// table beats a grid query, the view spans hundreds of cells and the result
+// comes out sorted.
+static void g_net_server_relevant(const g_net_server *server,
+                                  const g_net_client_slot *slot,
+                                  g_net_snapshot *out) {
+    const int64_t r = lroundf(server->view_radius * G_NET_POSITION_SCALE);
+    const int64_t cx =
+        lroundf(slot->camera.position[0] * G_NET_POSITION_SCALE);
+    const int64_t cy =
+        lroundf(slot->camera.position[1] * G_NET_POSITION_SCALE);
+
+    // Always send the client its own actor, keeping a slot for it
+    const stable_index_t own = slot->player.actor_handle.index;
+    const bool has_own = server->alive[own];
+
+    out->count = 0;
+    for (stable_index_t idx = 0; idx < MAX_G_ACTORS; idx++) {
+        if (!server->alive[idx]) {
+            continue;
+        }
+
+        const g_net_entity *e = &server->quantized[idx];
+        const bool inside = llabs(e->x - cx) <= r && llabs(e->y - cy) <= r;
+        const size_t cap = G_NET_MAX_ENTITIES - (has_own && idx < own);
+
+        if ((inside && out->count < cap) || idx == own) {
+            out->entities[out->count++] = *e;
+        }
+    }
+}
+
+// Delta encode current against baseline into w, filling sent with what the
+// client will reconstruct. Records that don't fit are left for a later
+// snapshot, keeping the baseline's version.
+static void g_net_encode(const g_net_snapshot *current,
+                         const g_net_snapshot *baseline, g_net_writer *w,
+                         g_net_snapshot *sent) {
+    uint16_t records = 0;
+    const size_t records_at = w->size - sizeof(uint16_t);
+
+    stable_index_t previous = 0;
+    size_t i = 0, j = 0;
+    sent->count = 0;
+
+    while (i < current->count || j < baseline->count) {
+        const g_net_entity *c = i < current->count ? &current->entities[i]
+                                                   : NULL;
+        const g_net_entity *b = j < baseline->count ? &baseline->entities[j]
+                                                    : NULL;
+
+        uint8_t flags = 0;
+        const g_net_entity *kept = NULL;
+
+        if (c != NULL && (b == NULL || c->handle.index < b->handle.index)) {
+            flags = G_NET_RECORD_NEW;
+            i++;
+        } else if (c == NULL || b->handle.index < c->handle.index) {
+            flags = G_NET_RECORD_REMOVE;
+            kept = b;
+            c = b;
+            j++;
+        } else if (c->handle.generation != b->handle.generation) {
+            flags = G_NET_RECORD_NEW;
+            kept = b;
+            i++;
+            j++;
+        } else {
+            flags = G_NET_RECORD_X * (c->x != b->x) |
+                    G_NET_RECORD_Y * (c->y != b->y) |
+                    G_NET_RECORD_ROTATION * (c->rotation != b->rotation);
+            kept = b;
+            i++;
+            j++;
+        }
+
+        // Unvisited baseline entities may still need a slot each
+        const bool room =
+            kept != NULL ||
+            sent->count + (baseline->count - j) < G_NET_MAX_ENTITIES;
+        const bool fits =
+            room && w->size + G_NET_MAX_RECORD <= G_NET_MAX_PACKET;
+
+        if (flags == 0 || !fits) {
+            if (kept != NULL) {
+                sent->entities[sent->count++] = *kept;
+            }
+            continue;
+        }
+
+        g_net_write_varint(w, c->handle.index - previous);
+        g_net_write_u8(w, flags);
+        previous = c->handle.index;
+        records++;
+
+        if (flags == G_NET_RECORD_NEW) {
+            g_net_write_varint(w, c->handle.generation);
+            g_net_write_svarint(w, c->x);
+            g_net_write_svarint(w, c->y);
+            g_net_write(w, &c->rotation, sizeof(c->rotation));
+            g_net_write(w, &c->z, sizeof(c->z));
+            g_net_write(w, &c->scale_x, sizeof(c->scale_x));
+            g_net_write(w, &c->scale_y, sizeof(c->scale_y));
+            g_net_write(w, c->color, sizeof(c->color));
+        } else if (flags != G_NET_RECORD_REMOVE) {
+            if (flags & G_NET_RECORD_X) {
+                g_net_write_svarint(w, c->x - kept->x);
+            }
+            if (flags & G_NET_RECORD_Y) {
+                g_net_write_svarint(w, c->y - kept->y);
+            }
+            if (flags & G_NET_RECORD_ROTATION) {
+                g_net_write_svarint(w, (int16_t)(c->rotation - kept->rotation));
+            }
+        }
+
+        if (flags != G_NET_RECORD_REMOVE) {
+            sent->entities[sent->count++] = *c;
+        }
+    }
+
+    memcpy(w->data + records_at, &records, sizeof(records));
+}
+
+void g_net_server_send(g_net_server *server, g_world *world) {
+    if (world->tick % server->send_interval != 0 ||
+        server->client_count == 0) {
+        return;
+    }
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "server_send");
+
+    static g_net_snapshot current;
+    static const g_net_snapshot empty;
+
+    g_net_server_quantize(server, &world->actors);
+
+    for (size_t s = 0; s < G_NET_MAX_CLIENTS; s++) {
+        g_net_client_slot *slot = &server->clients[s];
+        if (!slot->active) {
+            continue;
+        }
+
+        g_net_server_relevant(server, slot, &current);
+
+        // Fall back to a full snapshot once the baseline aged out
+        const g_net_snapshot *baseline = &empty;
+        uint32_t baseline_sequence = 0;
+        const g_net_snapshot *acked = &slot->sent[slot->ack % G_NET_HISTORY];
+
+        if (slot->ack != 0 && acked->sequence == slot->ack &&
+            slot->sequence + 1 - slot->ack < G_NET_HISTORY) {
+            baseline = acked;
+            baseline_sequence = slot->ack;
+        }
+
+        const uint32_t sequence = ++slot->sequence;
+        g_net_snapshot *sent = &slot->sent[sequence % G_NET_HISTORY];
+
+        uint8_t packet[G_NET_MAX_PACKET];
+        g_net_writer w = {.data = packet};
+
+        g_net_write_header(&w, G_NET_SNAPSHOT);
+        g_net_write(&w, &sequence, sizeof(sequence));
+        g_net_write(&w, &baseline_sequence, sizeof(baseline_sequence));
+        g_net_write(&w, &world->tick, sizeof(world->tick));
+        const size_t checksum_at = w.size;
+        w.size += sizeof(uint32_t) + sizeof(uint16_t);
+
+        g_net_encode(&current, baseline, &w, sent);
+
+        sent->sequence = sequence;
+        sent->tick = world->tick;
+        sent->checksum = g_net_checksum(sent);
+        memcpy(packet + checksum_at, &sent->checksum, sizeof(uint32_t));
+
+        sendto(server->socket, packet, w.size, 0,
+               (const struct sockaddr *)&slot->address, sizeof(slot->address));
+
+        server->snapshots_sent++;
+        server->bytes_sent += w.size;
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "server_send");
+}
+
+void g_net_server_delete(g_net_server *server) {
+    if (server->socket >= 0) {
+        close(server->socket);
+    }
+    free(server->clients);
+    *server = (g_net_server){.socket = -1};
+}
+
+// ---------------------------------- client ----------------------------------
+
+bool g_net_client_init(g_net_client *client, const char *host, uint16_t port) {
+    memset(client, 0, sizeof(*client));
+    client->last_hello = -1.0;
+
+    client->server = (struct sockaddr_in){
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+    };
+
+    client->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client->socket < 0 ||
+        inet_pton(AF_INET, host, &client->server.sin_addr) != 1 ||
+        connect(client->socket, (struct sockaddr *)&client->server,
+                sizeof(client->server)) != 0 ||
+        !g_net_nonblocking(client->socket)) {
+        printf("Couldn't connect to %s:%u!\n", host, port);
+        if (client->socket >= 0) {
+            close(client->socket);
+        }
+        client->socket = -1;
+        return false;
+    }
+
+    return true;
+}
+
+// Rebuild a snapshot from its baseline and records, false if malformed.
+static bool g_net_decode(g_net_reader *r, const g_net_snapshot *baseline,
+                         g_net_snapshot *out) {
+    uint16_t records;
+    g_net_read(r, &records, sizeof(records));
+
+    stable_index_t index = 0;
+    size_t j = 0;
+    out->count = 0;
+
+    for (uint16_t n = 0; n < records && !r->error; n++) {
+        index += g_net_read_varint(r);
+        const uint8_t flags = g_net_read_u8(r);
+
+        // Unmentioned baseline entities carry over
+        while (j < baseline->count &&
+               baseline->entities[j].handle.index < index) {
+            if (out->count == G_NET_MAX_ENTITIES) {
+                return false;
+            }
+            out->entities[out->count++] = baseline->entities[j++];
+        }
+
+        const g_net_entity *b = j < baseline->count &&
+                                        baseline->entities[j].handle.index ==
+                                            index
+                                    ? &baseline->entities[j++]
+                                    : NULL;
+
+        if (flags == G_NET_RECORD_REMOVE) {
+            continue;
+        }
+
+        if (out->count == G_NET_MAX_ENTITIES) {
+            return false;
+        }
+        g_net_entity *e = &out->entities[out->count++];
+
+        if (flags == G_NET_RECORD_NEW) {
+            e->handle.index = index;
+            e->handle.generation = g_net_read_varint(r);
+            e->x = g_net_read_svarint(r);
+            e->y = g_net_read_svarint(r);
+            g_net_read(r, &e->rotation, sizeof(e->rotation));
+            g_net_read(r, &e->z, sizeof(e->z));
+            g_net_read(r, &e->scale_x, sizeof(e->scale_x));
+            g_net_read(r, &e->scale_y, sizeof(e->scale_y));
+            g_net_read(r, e->color, sizeof(e->color));
+            continue;
+        }
+
+        if (b == NULL) {
+            return false;
+        }
+
+        *e = *b;
+        if (flags & G_NET_RECORD_X) {
+            e->x += g_net_read_svarint(r);
+        }
+        if (flags & G_NET_RECORD_Y) {
+            e->y += g_net_read_svarint(r);
+        }
+        if (flags & G_NET_RECORD_ROTATION) {
+            e->rotation += (uint16_t)g_net_read_svarint(r);
+        }
+    }
+
+    while (j < baseline->count && out->count < G_NET_MAX_ENTITIES) {
+        out->entities[out->count++] = baseline->entities[j++];
+    }
+
+    return !r->error && j == baseline->count;
+}
+
+static void g_net_client_snapshot(g_net_client *client, g_net_reader *r) {
+    static const g_net_snapshot empty;
+    static g_net_snapshot decoded;
+
+    uint32_t sequence, baseline_sequence;
+    g_net_read(r, &sequence, sizeof(sequence));
+    g_net_read(r, &baseline_sequence, sizeof(baseline_sequence));
+    g_net_read(r, &decoded.tick, sizeof(decoded.tick));
+    g_net_read(r, &decoded.checksum, sizeof(decoded.checksum));
+
+    // Late, or against a baseline that's no longer around
+    const g_net_snapshot *baseline =
+        &client->received[baseline_sequence % G_NET_HISTORY];
+
+    if (r->error || sequence <= client->latest ||
+        (baseline_sequence != 0 &&
+         (baseline->sequence != baseline_sequence ||
+          sequence - baseline_sequence >= G_NET_HISTORY))) {
+        client->snapshots_dropped++;
+        return;
+    }
+
+    if (baseline_sequence == 0) {
+        baseline = &empty;
+    }
+
+    if (!g_net_decode(r, baseline, &decoded)) {
+        client->snapshots_dropped++;
+        return;
+    }
+
+    if (g_net_checksum(&decoded) != decoded.checksum) {
+        client->checksum_errors++;
+        return;
+    }
+
+    decoded.sequence = sequence;
+    client->received[sequence % G_NET_HISTORY] = decoded;
+    client->latest = sequence;
+    client->snapshots_received++;
+}
+
+static void g_net_client_send(g_net_client *client, const g_input_map *input,
+                              const g_camera *camera) {
+    uint8_t packet[32];
+    g_net_writer w = {.data = packet};
+
+    g_net_write_header(&w, G_NET_INPUT);
+    g_net_write(&w, &client->latest, sizeof(client->latest));
+    g_net_write_u8(&w, g_replay_pack_input(input));
+    g_net_write(&w, camera->mouse_world_pos, sizeof(vec2));
+    g_net_write(&w, camera->position, sizeof(vec2));
+
+    send(client->socket, packet, w.size, 0);
+}
+
+void g_net_client_update(g_net_client *client, float dt, double now,
+                         const g_input_map *input, const g_camera *camera) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "client_update");
+
+    uint8_t packet[G_NET_MAX_PACKET];
+    ssize_t size;
+
+    while ((size = recv(client->socket, packet, sizeof(packet), 0)) >= 0) {
+        g_net_reader r = {.data = packet, .size = (size_t)size};
+        const int type = g_net_read_header(&r);
+
+        if (type == G_NET_WELCOME) {
+            uint32_t send_interval;
+            g_net_read(&r, &client->actor.index, sizeof(uint32_t));
+            g_net_read(&r, &client->actor.generation, sizeof(uint32_t));
+            g_net_read(&r, &send_interval, sizeof(send_interval));
+
+            client->connected = !r.error;
+            // Two snapshots behind rides out one lost packet
+            client->interp_delay = 2.0 * send_interval;
+        } else if (type == G_NET_SNAPSHOT && client->connected) {
+            g_net_client_snapshot(client, &r);
+        }
+    }
+
+    if (!client->connected) {
+        if (now - client->last_hello > 0.5) {
+            uint8_t hello[8];
+            g_net_writer w = {.data = hello};
+            g_net_write_header(&w, G_NET_HELLO);
+
+            send(client->socket, hello, w.size, 0);
+            client->last_hello = now;
+        }
+
+        G_TRACE_END(G_TRACE_SYSTEM, "client_update");
+        return;
+    }
+
+    g_net_client_send(client, input, camera);
+
+    // Trail the newest snapshot, easing toward the delay and snapping back
+    // only if far off
+    if (client->latest != 0) {
+        const double latest =
+            (double)client->received[client->latest % G_NET_HISTORY].tick;
+        const double target = latest - client->interp_delay;
+
+        client->render_tick += dt / g_fixed_dt;
+
+        const double error = target - client->render_tick;
+        if (fabs(error) > client->interp_delay * 2.0) {
+            client->render_tick = target;
+        } else {
+            client->render_tick += error * 0.05;
+        }
+        client->render_tick = min(client->render_tick, latest);
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "client_update");
+}
+
+// Received snapshots around render_tick, b is NULL past the newest.
+static bool g_net_client_bracket(const g_net_client *client,
+                                 const g_net_snapshot **a,
+                                 const g_net_snapshot **b) {
+    *a = NULL;
+    *b = NULL;
+
+    for (uint32_t i = 0; i < G_NET_HISTORY && i < client->latest; i++) {
+        const uint32_t sequence = client->latest - i;
+        const g_net_snapshot *s = &client->received[sequence % G_NET_HISTORY];
+
+        if (s->sequence != sequence) {
+            continue;
+        }
+
+        if ((double)s->tick <= client->render_tick) {
+            if (*a == NULL || s->tick > (*a)->tick) {
+                *a = s;
+            }
+        } else if (*b == NULL || s->tick < (*b)->tick) {
+            *b = s;
+        }
+    }
+
+    // Before the oldest kept snapshot, hold it
+    if (*a == NULL) {
+        *a = *b;
+        *b = NULL;
+    }
+
+    return *a != NULL;
+}
+
+void g_net_client_apply(g_net_client *client, g_world *world) {
+    const g_net_snapshot *a, *b;
+    if (!g_net_client_bracket(client, &a, &b)) {
+        return;
+    }
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "client_apply");
+
+    const float t =
+        b == NULL ? 0.0f
+                  : (float)((client->render_tick - a->tick) /
+                            (double)(b->tick - a->tick));
+    const g_net_snapshot *shown = b != NULL ? b : a;
+
+    g_actor_stack *actors = &world->actors;
+    bool keep[MAX_G_ACTORS] = {0};
+    size_t j = 0;
+
+    for (size_t i = 0; i < shown->count; i++) {
+        const g_net_entity *e = &shown->entities[i];
+        const stable_index_t remote = e->handle.index;
+
+        if (remote >= MAX_G_ACTORS) {
+            continue;
+        }
+
+        // The same actor in the older snapshot, to interpolate from
+        while (b != NULL && j < a->count &&
+               a->entities[j].handle.index < remote) {
+            j++;
+        }
+        const g_net_entity *from =
+            b != NULL && j < a->count &&
+                    a->entities[j].handle.index == remote &&
+                    a->entities[j].handle.generation == e->handle.generation
+                ? &a->entities[j]
+                : e;
+
+        const bool stale =
+            !client->mapped[remote] ||
+            client->remote[remote].generation != e->handle.generation ||
+            !g_actor_stack_valid(actors, client->local[remote]);
+
+        if (stale) {
+            if (client->mapped[remote] &&
+                g_actor_stack_valid(actors, client->local[remote])) {
+                g_actor_stack_remove(actors, client->local[remote]);
+            }
+
+            if (stable_index_remaining_cap(&actors->actor_index) == 0) {
+                client->mapped[remote] = false;
+                continue;
+            }
+
+            client->local[remote] = g_actor_stack_create(
+                actors,
+                &(g_actor_stack_create_ctx){
+                    .color = {e->color[0] / 255.0f, e->color[1] / 255.0f,
+                              e->color[2] / 255.0f, e->color[3] / 255.0f},
+                    .type = ACTOR_TYPE_ALIVE,
+                    .transform.z = e->z / 256.0f,
+                    .transform.scale = {e->scale_x / G_NET_SCALE_SCALE,
+                                        e->scale_y / G_NET_SCALE_SCALE},
+                });
+            client->remote[remote] = e->handle;
+            client->mapped[remote] = true;
+        }
+
+        const stable_index_t local = client->local[remote].index;
+        g_transform *transform = &actors->transforms[local];
+
+        const float x = glm_lerp(from->x, e->x, t) / G_NET_POSITION_SCALE;
+        const float y = glm_lerp(from->y, e->y, t) / G_NET_POSITION_SCALE;
+        // Shortest way around
+        const int16_t turn = (int16_t)(e->rotation - from->rotation);
+        const float rotation =
+            (from->rotation + turn * t) * (GLM_PIf / 32768.0f);
+
+        transform->position[0] = x;
+        transform->position[1] = y;
+        transform->rotation = rotation;
+        keep[local] = true;
+    }
+
+    // Drop whatever the server no longer sends, and any local only actor
+    const stable_index_view *alive = actors->alive_view;
+    for (size_t i = alive->size; i-- > 0;) {
+        const stable_index_t idx = alive->indices[i];
+
+        if (!keep[idx]) {
+            g_actor_stack_remove(
+                actors, (stable_index_handle){
+                            idx, actors->actor_index.generations[idx]});
+        }
+    }
+
+    for (size_t i = 0; i < MAX_G_ACTORS; i++) {
+        client->mapped[i] =
+            client->mapped[i] && g_actor_stack_valid(actors, client->local[i]);
+    }
+
+    const stable_index_t own = client->actor.index;
+    if (own < MAX_G_ACTORS && client->mapped[own] &&
+        client->remote[own].generation == client->actor.generation) {
+        world->player.actor_handle = client->local[own];
+    }
+
+    g_actor_stack_transform(actors, 0.0f);
+
+    G_TRACE_END(G_TRACE_SYSTEM, "client_apply");
+}
+
+void g_net_client_delete(g_net_client *client) {
+    if (client->socket < 0) {
+        return;
+    }
+
+    uint8_t bye[8];
+    g_net_writer w = {.data = bye};
+    g_net_write_header(&w, G_NET_BYE);
+    send(client->socket, bye, w.size, 0);
+
+    close(client->socket);
+    client->socket = -1;
+}
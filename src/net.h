@@ -0,0 +1,145 @@
+// Authoritative state replication over UDP. The server sends every client
+// quantized, delta compressed snapshots of the actors around it, clients
+// reconstruct and interpolate them.
+#ifndef NET_H
+#define NET_H
+
+#include "world.h"
+
+#include <netinet/in.h>
+
+#define G_NET_PROTOCOL 0x4e525443u // "CTRN"
+#define G_NET_DEFAULT_PORT 27960
+// Keeps snapshots within a single unfragmented datagram
+#define G_NET_MAX_PACKET 1200
+#define G_NET_MAX_CLIENTS 512
+// Actors per snapshot, around the client's camera
+#define G_NET_MAX_ENTITIES 256
+// Snapshots kept per client for delta baselines, a power of two
+#define G_NET_HISTORY 16
+// Quantization steps per world unit
+#define G_NET_POSITION_SCALE 64.0f
+#define G_NET_SCALE_SCALE 256.0f
+// Clients silent for this long are dropped
+#define G_NET_TIMEOUT 5.0
+
+// Sent as the byte after the protocol id
+typedef enum {
+    G_NET_HELLO,
+    G_NET_WELCOME,
+    G_NET_INPUT,
+    G_NET_SNAPSHOT,
+    G_NET_BYE,
+} g_net_packet_type;
+
+// One actor as replicated, keyed by its server side stable index handle.
+typedef struct {
+    stable_index_handle handle;
+    int32_t x, y;
+    // Full turn in 65536 steps
+    uint16_t rotation;
+    int16_t z;
+    uint16_t scale_x, scale_y;
+    uint8_t color[4];
+} g_net_entity;
+
+// Sorted by handle index.
+typedef struct {
+    uint32_t sequence;
+    uint64_t tick;
+    uint32_t checksum;
+    uint32_t count;
+    g_net_entity entities[G_NET_MAX_ENTITIES];
+} g_net_snapshot;
+
+typedef struct {
+    bool active;
+    struct sockaddr_in address;
+    double last_heard;
+
+    // Joined actor, driven by the client's input like the local player
+    g_player player;
+    g_camera camera;
+
+    // Newest snapshot the client confirmed, the next delta's baseline
+    uint32_t ack;
+    uint32_t sequence;
+    g_net_snapshot sent[G_NET_HISTORY];
+} g_net_client_slot;
+
+typedef struct {
+    int socket;
+    // Send a snapshot every this many ticks
+    uint32_t send_interval;
+    // Half extent of the square of actors sent to each client
+    float view_radius;
+
+    g_net_client_slot *clients;
+    size_t client_count;
+
+    // Every alive actor, quantized once per send
+    g_net_entity quantized[MAX_G_ACTORS];
+    bool alive[MAX_G_ACTORS];
+
+    // Counters
+    uint64_t snapshots_sent;
+    uint64_t bytes_sent;
+    uint64_t packets_received;
+} g_net_server;
+
+bool g_net_server_init(g_net_server *server, uint16_t port);
+
+// Handle pending joins, inputs and leaves. Run before g_world_update.
+void g_net_server_receive(g_net_server *server, g_world *world, double now);
+
+// Drive the joined actors for one fixed tick.
+void g_net_server_players(g_net_server *server, g_world *world, float dt);
+
+// Send every client a snapshot against its newest acknowledged one, if the
+// world's tick is due. Run after g_world_update.
+void g_net_server_send(g_net_server *server, g_world *world);
+
+void g_net_server_delete(g_net_server *server);
+
+typedef struct {
+    int socket;
+    struct sockaddr_in server;
+
+    bool connected;
+    stable_index_handle actor;
+    double last_hello;
+
+    // Reconstructed snapshots, by sequence
+    g_net_snapshot received[G_NET_HISTORY];
+    uint32_t latest;
+
+    // Interpolated tick, trailing the latest snapshot by interp_delay
+    double render_tick;
+    double interp_delay;
+
+    // Server index to local actor, for g_net_client_apply
+    bool mapped[MAX_G_ACTORS];
+    stable_index_handle remote[MAX_G_ACTORS];
+    stable_index_handle local[MAX_G_ACTORS];
+
+    // Counters
+    uint64_t snapshots_received;
+    uint64_t snapshots_dropped;
+    // Reconstructions that didn't match the server's checksum
+    uint64_t checksum_errors;
+} g_net_client;
+
+// Connect to host:port, host being a dotted IPv4 address.
+bool g_net_client_init(g_net_client *client, const char *host, uint16_t port);
+
+// Receive snapshots, send input and advance the interpolation by dt.
+void g_net_client_update(g_net_client *client, float dt, double now,
+                         const g_input_map *input, const g_camera *camera);
+
+// Mirror the interpolated actors into world's actor stack, pointing the
+// world's player at the joined actor.
+void g_net_client_apply(g_net_client *client, g_world *world);
+
+void g_net_client_delete(g_net_client *client);
+
+#endif
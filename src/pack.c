@@ -0,0 +1,122 @@
+#include "pack.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(SOKOL_GLES3)
+static const enum g_pack_backend g_pack_native_backend = G_PACK_GLES3;
+#else
+static const enum g_pack_backend g_pack_native_backend = G_PACK_GLCORE;
+#endif
+
+bool g_pack_open(g_pack *pack, const char *path) {
+    *pack = (g_pack){0};
+
+    if (!g_mapped_file_open(&pack->file, path)) {
+        return false;
+    }
+
+    const uint8_t *data = pack->file.data;
+    const size_t size = pack->file.size;
+    const g_pack_header *header = (const g_pack_header *)data;
+
+    if (size < sizeof(*header) ||
+        memcmp(header->magic, G_PACK_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != G_PACK_VERSION ||
+        size < sizeof(*header) + sizeof(g_pack_entry) * header->entry_count) {
+        printf("%s isn't a version %d pack!\n", path, G_PACK_VERSION);
+        g_pack_close(pack);
+        return false;
+    }
+
+    pack->entries = (const g_pack_entry *)(data + sizeof(*header));
+    pack->entry_count = header->entry_count;
+
+    for (uint32_t i = 0; i < pack->entry_count; i++) {
+        const g_pack_entry *entry = &pack->entries[i];
+
+        if (entry->offset % G_PACK_ALIGN != 0 || entry->offset > size ||
+            entry->size > size - entry->offset) {
+            printf("%s is truncated at entry %u!\n", path, i);
+            g_pack_close(pack);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void g_pack_close(g_pack *pack) {
+    g_mapped_file_close(&pack->file);
+    pack->entries = NULL;
+    pack->entry_count = 0;
+}
+
+const g_pack_entry *g_pack_find(const g_pack *pack, enum g_pack_kind kind,
+                                enum g_pack_backend backend,
+                                const char *name) {
+    for (uint32_t i = 0; i < pack->entry_count; i++) {
+        const g_pack_entry *entry = &pack->entries[i];
+
+        if (entry->kind == kind && entry->backend == backend &&
+            strncmp(entry->name, name, G_PACK_NAME_LENGTH) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+const char *g_pack_shader(const g_pack *pack, const char *name) {
+    const g_pack_entry *entry =
+        g_pack_find(pack, G_PACK_SHADER, g_pack_native_backend, name);
+
+    // Handed straight to sokol_gfx, which wants a C string
+    if (entry == NULL || entry->size == 0 ||
+        ((const char *)g_pack_data(pack, entry))[entry->size - 1] != '\0') {
+        return NULL;
+    }
+
+    return g_pack_data(pack, entry);
+}
+
+bool g_pack_load_level(const g_pack *pack, const char *name,
+                       g_static_meshes *meshes) {
+    const g_pack_entry *level =
+        g_pack_find(pack, G_PACK_LEVEL, G_PACK_ANY, name);
+    if (level == NULL) {
+        printf("No level %s in the pack!\n", name);
+        return false;
+    }
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "pack_load_level");
+
+    const g_pack_placement *placements = g_pack_data(pack, level);
+    const size_t count = level->size / sizeof(g_pack_placement);
+
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        const g_pack_placement *placement = &placements[i];
+
+        const g_pack_entry *mesh = placement->mesh < pack->entry_count
+                                       ? &pack->entries[placement->mesh]
+                                       : NULL;
+        if (mesh == NULL || mesh->kind != G_PACK_MESH) {
+            printf("Level %s places a missing mesh %u!\n", name,
+                   placement->mesh);
+            ok = false;
+            break;
+        }
+
+        mat4 transform;
+        glm_mat4_copy((vec4 *)placement->transform, transform);
+
+        ok = g_static_meshes_add_borrowed(
+                 meshes, transform, g_pack_data(pack, mesh),
+                 mesh->size / sizeof(g_vertex)) != SIZE_MAX;
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "pack_load_level");
+    return ok;
+}
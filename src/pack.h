@@ -0,0 +1,84 @@
+// Binary asset pack written by ctri_pack: shader sources per backend, static
+// mesh vertices and level placement tables. Laid out to be mmap'ed and used
+// in place, nothing is copied on load.
+#ifndef PACK_H
+#define PACK_H
+
+#include "common.h"
+#include "mapfile.h"
+
+#define G_PACK_MAGIC "CTRIPAK"
+#define G_PACK_VERSION 1
+// Every blob starts on this boundary, relative to the file start.
+#define G_PACK_ALIGN 64
+#define G_PACK_NAME_LENGTH 32
+
+enum g_pack_kind : uint32_t {
+    // NUL terminated GLSL source
+    G_PACK_SHADER,
+    // g_vertex triangle list
+    G_PACK_MESH,
+    // g_pack_placement table
+    G_PACK_LEVEL,
+};
+
+// Shaders are per backend, everything else is G_PACK_ANY.
+enum g_pack_backend : uint32_t {
+    G_PACK_ANY,
+    G_PACK_GLCORE,
+    G_PACK_GLES3,
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+} g_pack_header;
+
+// Follows the header, one per blob.
+typedef struct {
+    // NUL padded
+    char name[G_PACK_NAME_LENGTH];
+    uint32_t kind;
+    uint32_t backend;
+    uint64_t offset;
+    uint64_t size;
+} g_pack_entry;
+
+// One static mesh of a level.
+typedef struct {
+    mat4 transform;
+    // Index of a G_PACK_MESH entry
+    uint32_t mesh;
+    uint32_t reserved[3];
+} g_pack_placement;
+
+typedef struct {
+    g_mapped_file file;
+    const g_pack_entry *entries;
+    uint32_t entry_count;
+} g_pack;
+
+// Map a pack, checking the header and that every entry is in bounds.
+bool g_pack_open(g_pack *pack, const char *path);
+void g_pack_close(g_pack *pack);
+
+// Entry of kind named name, or NULL.
+const g_pack_entry *g_pack_find(const g_pack *pack, enum g_pack_kind kind,
+                                enum g_pack_backend backend,
+                                const char *name);
+
+static inline const void *g_pack_data(const g_pack *pack,
+                                      const g_pack_entry *entry) {
+    return pack->file.data + entry->offset;
+}
+
+// Source of a shader for the sokol_gfx backend this is built for, or NULL.
+const char *g_pack_shader(const g_pack *pack, const char *name);
+
+// Add every placement of a level to meshes, borrowing their vertices from
+// the pack: it must stay open until the meshes are cleared.
+bool g_pack_load_level(const g_pack *pack, const char *name,
+                       g_static_meshes *meshes);
+
+#endif
@@ -0,0 +1,342 @@
+// Offline packer for src/pack.h. Reads a manifest of shaders, meshes and
+// levels, one per line:
+//
+//   shader NAME glcore|gles3 PATH  GLSL source
+//   mesh NAME PATH                 "x y r g b a" per vertex, triangle list
+//   level NAME PATH                "mesh x y z rotation sx sy" per placement
+//
+// Paths are relative to the manifest, # starts a comment.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pack.h"
+
+#define G_PACK_TOOL_MAX_ENTRIES 256
+#define G_PACK_TOOL_MAX_PATH 512
+
+typedef struct {
+    g_pack_entry entry;
+    uint8_t *data;
+} g_pack_tool_blob;
+
+static g_pack_tool_blob blobs[G_PACK_TOOL_MAX_ENTRIES];
+static size_t blob_count;
+
+static void usage(const char *name) {
+    printf("usage: %s MANIFEST OUT\n", name);
+}
+
+static char *g_pack_tool_read(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // Always NUL terminated, shaders keep it
+    char *data = length >= 0 ? malloc(length + 1) : NULL;
+    if (data == NULL || fread(data, 1, length, file) != (size_t)length) {
+        printf("Couldn't read %s!\n", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    data[length] = '\0';
+    *size = (size_t)length;
+    return data;
+}
+
+static bool g_pack_tool_mesh(const char *text, g_pack_tool_blob *blob) {
+    size_t capacity = 64, count = 0;
+    g_vertex *vertices = malloc(sizeof(g_vertex) * capacity);
+    if (vertices == NULL) {
+        printf("Out of memory reading mesh %s!\n", blob->entry.name);
+        return false;
+    }
+
+    for (const char *line = text; line != NULL && *line != '\0';) {
+        float x, y;
+        unsigned r, g, b, a;
+
+        if (*line != '#' &&
+            sscanf(line, "%f %f %u %u %u %u", &x, &y, &r, &g, &b, &a) == 6) {
+            if (count == capacity) {
+                g_vertex *grown =
+                    realloc(vertices, sizeof(g_vertex) * capacity * 2);
+                if (grown == NULL) {
+                    printf("Out of memory reading mesh %s!\n",
+                           blob->entry.name);
+                    free(vertices);
+                    return false;
+                }
+                vertices = grown;
+                capacity *= 2;
+            }
+
+            vertices[count++] = (g_vertex){x, y, r, g, b, a};
+        }
+
+        line = strchr(line, '\n');
+        line = line != NULL ? line + 1 : NULL;
+    }
+
+    if (count == 0 || count % 3 != 0) {
+        printf("Mesh %s has %zu vertices, not whole triangles!\n",
+               blob->entry.name, count);
+        free(vertices);
+        return false;
+    }
+
+    blob->data = (uint8_t *)vertices;
+    blob->entry.size = sizeof(g_vertex) * count;
+    return true;
+}
+
+static const g_pack_tool_blob *g_pack_tool_find_mesh(const char *name) {
+    for (size_t i = 0; i < blob_count; i++) {
+        if (blobs[i].entry.kind == G_PACK_MESH &&
+            strncmp(blobs[i].entry.name, name, G_PACK_NAME_LENGTH) == 0) {
+            return &blobs[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Meshes must come before the levels placing them.
+static bool g_pack_tool_level(const char *text, g_pack_tool_blob *blob) {
+    size_t capacity = 64, count = 0;
+    g_pack_placement *placements =
+        malloc(sizeof(g_pack_placement) * capacity);
+    if (placements == NULL) {
+        printf("Out of memory reading level %s!\n", blob->entry.name);
+        return false;
+    }
+
+    for (const char *line = text; line != NULL && *line != '\0';) {
+        char mesh_name[G_PACK_NAME_LENGTH];
+        g_transform transform;
+
+        if (*line != '#' &&
+            sscanf(line, "%31s %f %f %f %f %f %f", mesh_name,
+                   &transform.position[0], &transform.position[1],
+                   &transform.z, &transform.rotation, &transform.scale[0],
+                   &transform.scale[1]) == 7) {
+            const g_pack_tool_blob *mesh = g_pack_tool_find_mesh(mesh_name);
+            if (mesh == NULL) {
+                printf("Level %s places unknown mesh %s!\n", blob->entry.name,
+                       mesh_name);
+                free(placements);
+                return false;
+            }
+
+            if (count == capacity) {
+                g_pack_placement *grown = realloc(
+                    placements, sizeof(g_pack_placement) * capacity * 2);
+                if (grown == NULL) {
+                    printf("Out of memory reading level %s!\n",
+                           blob->entry.name);
+                    free(placements);
+                    return false;
+                }
+                placements = grown;
+                capacity *= 2;
+            }
+
+            g_pack_placement *placement = &placements[count++];
+            *placement = (g_pack_placement){
+                .mesh = (uint32_t)(mesh - blobs),
+            };
+
+            glm_mat4_identity(placement->transform);
+            g_transform_model(&transform, &placement->transform);
+        }
+
+        line = strchr(line, '\n');
+        line = line != NULL ? line + 1 : NULL;
+    }
+
+    blob->data = (uint8_t *)placements;
+    blob->entry.size = sizeof(g_pack_placement) * count;
+    return true;
+}
+
+static bool g_pack_tool_add(const char *dir, const char *line) {
+    char kind[16], name[64], arg[G_PACK_TOOL_MAX_PATH],
+        path[G_PACK_TOOL_MAX_PATH] = "";
+    const int fields = sscanf(line, "%15s %63s %511s %511s", kind, name, arg,
+                              path);
+
+    if (fields < 3 || kind[0] == '#') {
+        return true;
+    }
+
+    if (blob_count == G_PACK_TOOL_MAX_ENTRIES) {
+        printf("Too many entries, at most %d!\n", G_PACK_TOOL_MAX_ENTRIES);
+        return false;
+    }
+
+    if (strlen(name) >= G_PACK_NAME_LENGTH) {
+        printf("Name %s is longer than %d!\n", name, G_PACK_NAME_LENGTH - 1);
+        return false;
+    }
+
+    g_pack_tool_blob *blob = &blobs[blob_count];
+    *blob = (g_pack_tool_blob){0};
+    strncpy(blob->entry.name, name, G_PACK_NAME_LENGTH);
+
+    const char *file = arg;
+    if (strcmp(kind, "shader") == 0) {
+        blob->entry.kind = G_PACK_SHADER;
+
+        if (strcmp(arg, "glcore") == 0) {
+            blob->entry.backend = G_PACK_GLCORE;
+        } else if (strcmp(arg, "gles3") == 0) {
+            blob->entry.backend = G_PACK_GLES3;
+        } else {
+            printf("Unknown backend %s!\n", arg);
+            return false;
+        }
+
+        if (fields < 4) {
+            printf("Shader %s has no path!\n", name);
+            return false;
+        }
+        file = path;
+    } else if (strcmp(kind, "mesh") == 0) {
+        blob->entry.kind = G_PACK_MESH;
+    } else if (strcmp(kind, "level") == 0) {
+        blob->entry.kind = G_PACK_LEVEL;
+    } else {
+        printf("Unknown entry kind %s!\n", kind);
+        return false;
+    }
+
+    char full[G_PACK_TOOL_MAX_PATH * 2];
+    snprintf(full, sizeof(full), "%s%s", dir, file);
+
+    size_t size;
+    char *text = g_pack_tool_read(full, &size);
+    if (text == NULL) {
+        return false;
+    }
+
+    bool ok = true;
+    switch (blob->entry.kind) {
+    case G_PACK_SHADER:
+        blob->data = (uint8_t *)text;
+        blob->entry.size = size + 1;
+        text = NULL;
+        break;
+    case G_PACK_MESH:
+        ok = g_pack_tool_mesh(text, blob);
+        break;
+    case G_PACK_LEVEL:
+        ok = g_pack_tool_level(text, blob);
+        break;
+    }
+
+    free(text);
+    blob_count += ok;
+    return ok;
+}
+
+static bool g_pack_tool_pad(FILE *out) {
+    static const uint8_t zeros[G_PACK_ALIGN] = {0};
+
+    const long position = ftell(out);
+    const size_t padding = (G_PACK_ALIGN - position % G_PACK_ALIGN) %
+                           G_PACK_ALIGN;
+    return fwrite(zeros, 1, padding, out) == padding;
+}
+
+static bool g_pack_tool_write(const char *path) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        printf("Couldn't open %s for writing!\n", path);
+        return false;
+    }
+
+    g_pack_header header = {
+        .version = G_PACK_VERSION,
+        .entry_count = (uint32_t)blob_count,
+    };
+    memcpy(header.magic, G_PACK_MAGIC, sizeof(header.magic));
+
+    // Offsets follow from the sizes, so the table is written once
+    uint64_t offset = sizeof(header) + sizeof(g_pack_entry) * blob_count;
+    for (size_t i = 0; i < blob_count; i++) {
+        offset = (offset + G_PACK_ALIGN - 1) & ~(uint64_t)(G_PACK_ALIGN - 1);
+        blobs[i].entry.offset = offset;
+        offset += blobs[i].entry.size;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (size_t i = 0; ok && i < blob_count; i++) {
+        ok = fwrite(&blobs[i].entry, sizeof(g_pack_entry), 1, out) == 1;
+    }
+
+    for (size_t i = 0; ok && i < blob_count; i++) {
+        ok = g_pack_tool_pad(out) &&
+             fwrite(blobs[i].data, 1, blobs[i].entry.size, out) ==
+                 blobs[i].entry.size;
+    }
+
+    ok = fclose(out) == 0 && ok;
+    if (!ok) {
+        printf("Couldn't write %s!\n", path);
+        return false;
+    }
+
+    printf("%s: %zu entries, %llu bytes\n", path, blob_count,
+           (unsigned long long)offset);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    char *manifest = g_pack_tool_read(argv[1], &size);
+    if (manifest == NULL) {
+        return 1;
+    }
+
+    // Paths are relative to the manifest
+    char dir[G_PACK_TOOL_MAX_PATH] = "";
+    const char *slash = strrchr(argv[1], '/');
+    if (slash != NULL && (size_t)(slash - argv[1]) + 1 < sizeof(dir)) {
+        memcpy(dir, argv[1], slash - argv[1] + 1);
+    }
+
+    bool ok = true;
+    for (char *line = manifest; ok && line != NULL && *line != '\0';) {
+        char *end = strchr(line, '\n');
+        if (end != NULL) {
+            *end = '\0';
+        }
+
+        ok = g_pack_tool_add(dir, line);
+        line = end != NULL ? end + 1 : NULL;
+    }
+
+    ok = ok && g_pack_tool_write(argv[2]);
+
+    for (size_t i = 0; i < blob_count; i++) {
+        free(blobs[i].data);
+    }
+    free(manifest);
+
+    return ok ? 0 : 1;
+}
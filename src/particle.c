@@ -0,0 +1,190 @@
+#include "particle.h"
+#include "fastmath.h"
+#include "trace.h"
+
+#include <string.h>
+
+void g_particles_init(g_particles *particles, uint64_t seed) {
+    particles->tail = 0;
+    particles->count = 0;
+    g_rng_seed(&particles->rng, seed);
+}
+
+void g_particles_create(g_particles *particles,
+                        const g_particle_create_ctx *ctx) {
+    if (particles->count == MAX_G_PARTICLES) {
+        particles->tail = (particles->tail + 1) % MAX_G_PARTICLES;
+        particles->count--;
+    }
+
+    const size_t i = (particles->tail + particles->count) % MAX_G_PARTICLES;
+    particles->count++;
+
+    particles->pos_x[i] = ctx->position[0];
+    particles->pos_y[i] = ctx->position[1];
+    particles->vel_x[i] = ctx->velocity[0];
+    particles->vel_y[i] = ctx->velocity[1];
+    particles->fwd_x[i] = cosf(ctx->rotation);
+    particles->fwd_y[i] = sinf(ctx->rotation);
+    particles->angular[i] = ctx->angular;
+    particles->drag[i] = ctx->drag;
+    particles->lifetime[i] = ctx->lifetime;
+    particles->inv_lifetime[i] = 1.0f / ctx->lifetime;
+    particles->size[i] = ctx->size;
+
+    const uint8_t rgba[4] = {
+        g_color_channel(ctx->color[0]),
+        g_color_channel(ctx->color[1]),
+        g_color_channel(ctx->color[2]),
+        g_color_channel(ctx->color[3]),
+    };
+    memcpy(&particles->colors[i], rgba, sizeof(rgba));
+}
+
+void g_particles_burst(g_particles *particles, vec2 position, vec2 velocity,
+                       vec4 color, size_t count) {
+    g_rng *rng = &particles->rng;
+
+    for (size_t i = 0; i < count; i++) {
+        const float angle = rand_float(rng, 0.0f, 2.0f * GLM_PIf);
+        const float speed = rand_float(rng, 2.0f, 8.0f);
+
+        g_particles_create(
+            particles,
+            &(g_particle_create_ctx){
+                .position = {position[0], position[1]},
+                .velocity = {velocity[0] * 0.2f + cosf(angle) * speed,
+                             velocity[1] * 0.2f + sinf(angle) * speed},
+                .rotation = angle,
+                .angular = rand_float(rng, -20.0f, 20.0f),
+                .drag = 3.0f,
+                .lifetime = rand_float(rng, 0.3f, 0.8f),
+                .size = rand_float(rng, 0.1f, 0.25f),
+                .color = {color[0], color[1], color[2], color[3]},
+            });
+    }
+}
+
+// Integrate slots [begin, end), both multiples of 4. Dead slots are
+// integrated too, which is harmless since they stay dead.
+static void g_particles_integrate(float dt, g_particles *p, size_t begin,
+                                  size_t end) {
+    size_t i = begin;
+
+#if defined(__SSE2__) || defined(__wasm_simd128__)
+    const g_f4 vdt = g_f4_set1(dt);
+    const g_f4 zero = g_f4_set1(0.0f);
+    const g_f4 one = g_f4_set1(1.0f);
+
+    for (; i < end; i += 4) {
+        g_f4 vx = g_f4_load(&p->vel_x[i]);
+        g_f4 vy = g_f4_load(&p->vel_y[i]);
+
+        const g_f4 damp = g_f4_max(
+            g_f4_sub(one, g_f4_mul(g_f4_load(&p->drag[i]), vdt)), zero);
+        vx = g_f4_mul(vx, damp);
+        vy = g_f4_mul(vy, damp);
+
+        const g_f4 px = g_f4_add(g_f4_load(&p->pos_x[i]), g_f4_mul(vx, vdt));
+        const g_f4 py = g_f4_add(g_f4_load(&p->pos_y[i]), g_f4_mul(vy, vdt));
+
+        // First order rotation of the forward axis, renormalized with rsqrt
+        const g_f4 a = g_f4_mul(g_f4_load(&p->angular[i]), vdt);
+        const g_f4 fx = g_f4_load(&p->fwd_x[i]);
+        const g_f4 fy = g_f4_load(&p->fwd_y[i]);
+
+        g_f4 nfx = g_f4_sub(fx, g_f4_mul(fy, a));
+        g_f4 nfy = g_f4_add(fy, g_f4_mul(fx, a));
+
+        const g_f4 inv_len = g_f4_rsqrt(
+            g_f4_add(g_f4_mul(nfx, nfx), g_f4_mul(nfy, nfy)));
+        nfx = g_f4_mul(nfx, inv_len);
+        nfy = g_f4_mul(nfy, inv_len);
+
+        const g_f4 life = g_f4_sub(g_f4_load(&p->lifetime[i]), vdt);
+
+        g_f4_store(&p->vel_x[i], vx);
+        g_f4_store(&p->vel_y[i], vy);
+        g_f4_store(&p->pos_x[i], px);
+        g_f4_store(&p->pos_y[i], py);
+        g_f4_store(&p->fwd_x[i], nfx);
+        g_f4_store(&p->fwd_y[i], nfy);
+        g_f4_store(&p->lifetime[i], life);
+    }
+#endif
+
+    for (; i < end; i++) {
+        const float damp = glm_max(1.0f - p->drag[i] * dt, 0.0f);
+        p->vel_x[i] *= damp;
+        p->vel_y[i] *= damp;
+
+        p->pos_x[i] += p->vel_x[i] * dt;
+        p->pos_y[i] += p->vel_y[i] * dt;
+
+        const float a = p->angular[i] * dt;
+        const float fx = p->fwd_x[i] - p->fwd_y[i] * a;
+        const float fy = p->fwd_y[i] + p->fwd_x[i] * a;
+        const float inv_len = 1.0f / sqrtf(fx * fx + fy * fy);
+        p->fwd_x[i] = fx * inv_len;
+        p->fwd_y[i] = fy * inv_len;
+
+        p->lifetime[i] -= dt;
+    }
+}
+
+void g_particles_update(float dt, g_particles *particles) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "particles");
+
+    const size_t head = particles->tail + particles->count;
+
+    // The live window is at most two contiguous ranges, rounded out to whole
+    // SIMD lanes.
+    if (head <= MAX_G_PARTICLES) {
+        g_particles_integrate(dt, particles, particles->tail & ~(size_t)3,
+                              (head + 3) & ~(size_t)3);
+    } else {
+        const size_t begin = particles->tail & ~(size_t)3;
+        g_particles_integrate(dt, particles, begin, MAX_G_PARTICLES);
+
+        // Rounding up mustn't reach the lanes integrated above, which it
+        // does once the ring is nearly full
+        const size_t end = (head - MAX_G_PARTICLES + 3) & ~(size_t)3;
+        g_particles_integrate(dt, particles, 0, min(end, begin));
+    }
+
+    // Retire the dead particles at the back of the window
+    while (particles->count > 0 &&
+           particles->lifetime[particles->tail] <= 0.0f) {
+        particles->tail = (particles->tail + 1) % MAX_G_PARTICLES;
+        particles->count--;
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "particles");
+}
+
+size_t g_particles_instances(const g_particles *particles, g_instance *out) {
+    size_t n = 0;
+
+    for (size_t w = 0; w < particles->count; w++) {
+        const size_t i = (particles->tail + w) % MAX_G_PARTICLES;
+
+        const float life = particles->lifetime[i];
+        if (life <= 0.0f) {
+            continue;
+        }
+
+        g_instance *instance = &out[n++];
+
+        instance->x = particles->pos_x[i];
+        instance->y = particles->pos_y[i];
+        instance->fx = particles->fwd_x[i] * particles->size[i];
+        instance->fy = particles->fwd_y[i] * particles->size[i];
+
+        memcpy(&instance->r, &particles->colors[i], sizeof(uint32_t));
+
+        const float fade = glm_min(life * particles->inv_lifetime[i], 1.0f);
+        instance->a = (uint8_t)(instance->a * fade);
+    }
+
+    return n;
+}
@@ -0,0 +1,64 @@
+// Short lived, collision-free particles (polygon shards) for visual effects.
+#ifndef PARTICLE_H
+#define PARTICLE_H
+
+#include "common.h"
+
+#include <stdalign.h>
+
+// Must be a multiple of 4
+#define MAX_G_PARTICLES (size_t)131072
+
+// SoA ring buffer, new particles overwrite the oldest once full.
+typedef struct {
+    alignas(16) float pos_x[MAX_G_PARTICLES];
+    alignas(16) float pos_y[MAX_G_PARTICLES];
+    alignas(16) float vel_x[MAX_G_PARTICLES];
+    alignas(16) float vel_y[MAX_G_PARTICLES];
+    // Unit forward axis, rotated by angular every update
+    alignas(16) float fwd_x[MAX_G_PARTICLES];
+    alignas(16) float fwd_y[MAX_G_PARTICLES];
+    alignas(16) float angular[MAX_G_PARTICLES];
+    alignas(16) float drag[MAX_G_PARTICLES];
+    // Remaining lifetime in seconds, dead at <= 0
+    alignas(16) float lifetime[MAX_G_PARTICLES];
+    alignas(16) float inv_lifetime[MAX_G_PARTICLES];
+    alignas(16) float size[MAX_G_PARTICLES];
+    // Packed rgba8, alpha fades out with the lifetime
+    uint32_t colors[MAX_G_PARTICLES];
+
+    // Oldest slot of the live window and the window length, the window
+    // wraps around and may contain particles that died out of order.
+    size_t tail;
+    size_t count;
+
+    // Kept apart from the world's, so effects never shift the simulation.
+    g_rng rng;
+} g_particles;
+
+typedef struct {
+    vec2 position;
+    vec2 velocity;
+    float rotation;
+    float angular;
+    float drag;
+    float lifetime;
+    float size;
+    vec4 color;
+} g_particle_create_ctx;
+
+void g_particles_init(g_particles *particles, uint64_t seed);
+
+void g_particles_create(g_particles *particles,
+                        const g_particle_create_ctx *ctx);
+
+// Emit count shards flying away from position.
+void g_particles_burst(g_particles *particles, vec2 position, vec2 velocity,
+                       vec4 color, size_t count);
+
+void g_particles_update(float dt, g_particles *particles);
+
+// Write one instance per live particle, returns the instance count.
+size_t g_particles_instances(const g_particles *particles, g_instance *out);
+
+#endif
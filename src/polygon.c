@@ -0,0 +1,419 @@
+#include "polygon.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define G_POLYGON_NONE UINT32_MAX
+
+// One point of the ring being clipped, bridges duplicate their endpoints.
+typedef struct {
+    float x, y;
+    uint32_t point;
+    uint32_t prev, next;
+} g_polygon_node;
+
+typedef struct {
+    g_polygon_node *nodes;
+    uint32_t node_count;
+
+    uint32_t *indices;
+    size_t triangle_count;
+} g_polygon;
+
+// Leftmost point of a hole, holes are bridged from left to right.
+typedef struct {
+    float x, y;
+    uint32_t node;
+} g_polygon_hole;
+
+// Twice the signed area of abc, negative when counter clockwise. The sign
+// convention and the hole bridging follow mapbox's earcut.
+static inline float g_polygon_area(const g_polygon_node *a,
+                                   const g_polygon_node *b,
+                                   const g_polygon_node *c) {
+    return (b->y - a->y) * (c->x - b->x) - (b->x - a->x) * (c->y - b->y);
+}
+
+static inline bool g_polygon_equal(const g_polygon_node *a,
+                                   const g_polygon_node *b) {
+    return a->x == b->x && a->y == b->y;
+}
+
+// Whether p lies in the counter clockwise triangle abc, edges included.
+static inline bool g_polygon_in_triangle(float ax, float ay, float bx,
+                                         float by, float cx, float cy,
+                                         float px, float py) {
+    return (cx - px) * (ay - py) >= (ax - px) * (cy - py) &&
+           (ax - px) * (by - py) >= (bx - px) * (ay - py) &&
+           (bx - px) * (cy - py) >= (cx - px) * (by - py);
+}
+
+static uint32_t g_polygon_insert(g_polygon *polygon, const vec2 *points,
+                                 uint32_t point, uint32_t last) {
+    const uint32_t i = polygon->node_count++;
+    g_polygon_node *node = &polygon->nodes[i];
+
+    *node = (g_polygon_node){
+        .x = points[point][0],
+        .y = points[point][1],
+        .point = point,
+        .prev = i,
+        .next = i,
+    };
+
+    if (last != G_POLYGON_NONE) {
+        node->next = polygon->nodes[last].next;
+        node->prev = last;
+        polygon->nodes[node->next].prev = i;
+        polygon->nodes[last].next = i;
+    }
+
+    return i;
+}
+
+// Unlinks node, which keeps its own links.
+static inline void g_polygon_remove(g_polygon *polygon, uint32_t node) {
+    const g_polygon_node *n = &polygon->nodes[node];
+    polygon->nodes[n->next].prev = n->prev;
+    polygon->nodes[n->prev].next = n->next;
+}
+
+// Link the ring [start, end) counter clockwise, or clockwise for holes.
+static uint32_t g_polygon_link(g_polygon *polygon, const vec2 *points,
+                               uint32_t start, uint32_t end, bool ccw) {
+    if (start >= end) {
+        return G_POLYGON_NONE;
+    }
+
+    // Positive when counter clockwise
+    float area = 0.0f;
+    for (uint32_t i = start, j = end - 1; i < end; j = i++) {
+        area += (points[j][0] - points[i][0]) * (points[i][1] + points[j][1]);
+    }
+
+    uint32_t last = G_POLYGON_NONE;
+    if (ccw == (area > 0.0f)) {
+        for (uint32_t i = start; i < end; i++) {
+            last = g_polygon_insert(polygon, points, i, last);
+        }
+    } else {
+        for (uint32_t i = end; i > start; i--) {
+            last = g_polygon_insert(polygon, points, i - 1, last);
+        }
+    }
+
+    const g_polygon_node *n = &polygon->nodes[last];
+    if (g_polygon_equal(n, &polygon->nodes[n->next])) {
+        g_polygon_remove(polygon, last);
+        last = n->next;
+    }
+
+    return last;
+}
+
+// Drop duplicate and collinear points between start and end.
+static uint32_t g_polygon_filter(g_polygon *polygon, uint32_t start,
+                                 uint32_t end) {
+    if (end == G_POLYGON_NONE) {
+        end = start;
+    }
+
+    uint32_t p = start;
+    bool again;
+    do {
+        again = false;
+        const g_polygon_node *n = &polygon->nodes[p];
+        const g_polygon_node *prev = &polygon->nodes[n->prev];
+        const g_polygon_node *next = &polygon->nodes[n->next];
+
+        if (g_polygon_equal(n, next) || g_polygon_area(prev, n, next) == 0) {
+            g_polygon_remove(polygon, p);
+            p = end = n->prev;
+            if (p == polygon->nodes[p].next) {
+                break;
+            }
+            again = true;
+        } else {
+            p = n->next;
+        }
+    } while (again || p != end);
+
+    return end;
+}
+
+// Convex, with no reflex point of the ring inside.
+static bool g_polygon_ear(const g_polygon *polygon, uint32_t ear) {
+    const g_polygon_node *b = &polygon->nodes[ear];
+    const g_polygon_node *a = &polygon->nodes[b->prev];
+    const g_polygon_node *c = &polygon->nodes[b->next];
+
+    if (g_polygon_area(a, b, c) >= 0.0f) {
+        return false;
+    }
+
+    const float x0 = fminf(a->x, fminf(b->x, c->x));
+    const float y0 = fminf(a->y, fminf(b->y, c->y));
+    const float x1 = fmaxf(a->x, fmaxf(b->x, c->x));
+    const float y1 = fmaxf(a->y, fmaxf(b->y, c->y));
+
+    for (uint32_t p = c->next; p != b->prev;) {
+        const g_polygon_node *n = &polygon->nodes[p];
+
+        // Bridges put copies of a on the ring, those don't count
+        if (n->x >= x0 && n->x <= x1 && n->y >= y0 && n->y <= y1 &&
+            !g_polygon_equal(n, a) &&
+            g_polygon_in_triangle(a->x, a->y, b->x, b->y, c->x, c->y, n->x,
+                                  n->y) &&
+            g_polygon_area(&polygon->nodes[n->prev], n,
+                           &polygon->nodes[n->next]) >= 0.0f) {
+            return false;
+        }
+
+        p = n->next;
+    }
+
+    return true;
+}
+
+static void g_polygon_clip(g_polygon *polygon, uint32_t ear) {
+    uint32_t stop = ear;
+    // 1 after filtering a ring without ears, 2 clips whatever remains
+    int pass = 0;
+
+    while (polygon->nodes[ear].prev != polygon->nodes[ear].next) {
+        const uint32_t prev = polygon->nodes[ear].prev;
+        const uint32_t next = polygon->nodes[ear].next;
+
+        if (pass == 2 || g_polygon_ear(polygon, ear)) {
+            uint32_t *t = &polygon->indices[polygon->triangle_count++ * 3];
+            t[0] = polygon->nodes[prev].point;
+            t[1] = polygon->nodes[ear].point;
+            t[2] = polygon->nodes[next].point;
+
+            g_polygon_remove(polygon, ear);
+
+            // Skipping the next point leaves fewer slivers
+            ear = stop = pass == 2 ? next : polygon->nodes[next].next;
+            continue;
+        }
+
+        ear = next;
+        if (ear == stop && ++pass == 1) {
+            ear = stop = g_polygon_filter(polygon, ear, G_POLYGON_NONE);
+        }
+    }
+}
+
+static bool g_polygon_locally_inside(const g_polygon *polygon, uint32_t a,
+                                     uint32_t b) {
+    const g_polygon_node *n = &polygon->nodes[a];
+    const g_polygon_node *m = &polygon->nodes[b];
+    const g_polygon_node *prev = &polygon->nodes[n->prev];
+    const g_polygon_node *next = &polygon->nodes[n->next];
+
+    return g_polygon_area(prev, n, next) < 0.0f
+               ? g_polygon_area(n, m, next) >= 0.0f &&
+                     g_polygon_area(n, prev, m) >= 0.0f
+               : g_polygon_area(n, m, prev) < 0.0f ||
+                     g_polygon_area(n, next, m) < 0.0f;
+}
+
+// Whether the sector of m contains the sector of p, both on the outline.
+static bool g_polygon_sector_contains(const g_polygon *polygon, uint32_t m,
+                                      uint32_t p) {
+    const g_polygon_node *a = &polygon->nodes[m];
+    const g_polygon_node *b = &polygon->nodes[p];
+
+    return g_polygon_area(&polygon->nodes[a->prev], a,
+                          &polygon->nodes[b->prev]) < 0.0f &&
+           g_polygon_area(&polygon->nodes[b->next], a,
+                          &polygon->nodes[a->next]) < 0.0f;
+}
+
+// Outline point the leftmost point of hole can see, by casting a ray to the
+// left and taking the hit edge's endpoint, or a point in the way of it.
+static uint32_t g_polygon_bridge(const g_polygon *polygon, uint32_t hole,
+                                 uint32_t outline) {
+    const float hx = polygon->nodes[hole].x;
+    const float hy = polygon->nodes[hole].y;
+    float qx = -INFINITY;
+    uint32_t m = G_POLYGON_NONE;
+
+    uint32_t p = outline;
+    do {
+        const g_polygon_node *a = &polygon->nodes[p];
+        const g_polygon_node *b = &polygon->nodes[a->next];
+
+        if (hy <= a->y && hy >= b->y && b->y != a->y) {
+            const float x =
+                a->x + (hy - a->y) * (b->x - a->x) / (b->y - a->y);
+
+            if (x <= hx && x > qx) {
+                qx = x;
+                m = a->x < b->x ? p : a->next;
+
+                // The hole touches the edge
+                if (x == hx) {
+                    return m;
+                }
+            }
+        }
+
+        p = a->next;
+    } while (p != outline);
+
+    if (m == G_POLYGON_NONE) {
+        return G_POLYGON_NONE;
+    }
+
+    // Points inside the triangle of the hole point, the hit and m block the
+    // bridge, take the one closest in angle to the ray instead
+    const uint32_t stop = m;
+    const float mx = polygon->nodes[m].x;
+    const float my = polygon->nodes[m].y;
+    float tan_min = INFINITY;
+
+    p = m;
+    do {
+        const g_polygon_node *n = &polygon->nodes[p];
+
+        if (hx >= n->x && n->x >= mx && hx != n->x &&
+            g_polygon_in_triangle(hy < my ? hx : qx, hy, mx, my,
+                                  hy < my ? qx : hx, hy, n->x, n->y)) {
+            const float tan = fabsf(hy - n->y) / (hx - n->x);
+            const float best_x = polygon->nodes[m].x;
+
+            if (g_polygon_locally_inside(polygon, p, hole) &&
+                (tan < tan_min ||
+                 (tan == tan_min &&
+                  (n->x > best_x ||
+                   (n->x == best_x &&
+                    g_polygon_sector_contains(polygon, m, p)))))) {
+                m = p;
+                tan_min = tan;
+            }
+        }
+
+        p = n->next;
+    } while (p != stop);
+
+    return m;
+}
+
+// Join a and b with two edges, one each way, through copies of both.
+// Returns the copy of b.
+static uint32_t g_polygon_split(g_polygon *polygon, uint32_t a, uint32_t b) {
+    const uint32_t a2 = polygon->node_count++;
+    const uint32_t b2 = polygon->node_count++;
+    g_polygon_node *nodes = polygon->nodes;
+
+    nodes[a2] = nodes[a];
+    nodes[b2] = nodes[b];
+
+    const uint32_t an = nodes[a].next;
+    const uint32_t bp = nodes[b].prev;
+
+    nodes[a].next = b;
+    nodes[b].prev = a;
+
+    nodes[a2].next = an;
+    nodes[an].prev = a2;
+
+    nodes[b2].next = a2;
+    nodes[a2].prev = b2;
+
+    nodes[bp].next = b2;
+    nodes[b2].prev = bp;
+
+    return b2;
+}
+
+static int g_polygon_hole_compare(const void *a, const void *b) {
+    const g_polygon_hole *ha = a;
+    const g_polygon_hole *hb = b;
+
+    if (ha->x != hb->x) {
+        return ha->x < hb->x ? -1 : 1;
+    }
+    return (ha->y > hb->y) - (ha->y < hb->y);
+}
+
+bool g_polygon_triangulate(const vec2 *points, const uint32_t *ring_ends,
+                           size_t ring_count, g_arena *scratch,
+                           uint32_t *indices, size_t *triangle_count) {
+    *triangle_count = 0;
+    if (ring_count == 0) {
+        return true;
+    }
+
+    const size_t mark = g_arena_mark(scratch);
+    const uint32_t point_count = ring_ends[ring_count - 1];
+
+    g_polygon polygon = {
+        .nodes = g_arena_push_array(scratch, g_polygon_node,
+                                    point_count + 2 * (ring_count - 1)),
+        .indices = indices,
+    };
+    g_polygon_hole *holes =
+        g_arena_push_array(scratch, g_polygon_hole, ring_count);
+
+    if (polygon.nodes == NULL || holes == NULL) {
+        g_arena_rewind(scratch, mark);
+        return false;
+    }
+
+    uint32_t outline = g_polygon_link(&polygon, points, 0, ring_ends[0], true);
+    if (outline == G_POLYGON_NONE ||
+        polygon.nodes[outline].next == polygon.nodes[outline].prev) {
+        g_arena_rewind(scratch, mark);
+        return true;
+    }
+
+    size_t hole_count = 0;
+    for (size_t r = 1; r < ring_count; r++) {
+        const uint32_t start =
+            g_polygon_link(&polygon, points, ring_ends[r - 1], ring_ends[r],
+                           false);
+        if (start == G_POLYGON_NONE) {
+            continue;
+        }
+
+        uint32_t leftmost = start;
+        for (uint32_t p = polygon.nodes[start].next; p != start;
+             p = polygon.nodes[p].next) {
+            const g_polygon_node *n = &polygon.nodes[p];
+            const g_polygon_node *l = &polygon.nodes[leftmost];
+
+            if (n->x < l->x || (n->x == l->x && n->y < l->y)) {
+                leftmost = p;
+            }
+        }
+
+        holes[hole_count++] = (g_polygon_hole){
+            .x = polygon.nodes[leftmost].x,
+            .y = polygon.nodes[leftmost].y,
+            .node = leftmost,
+        };
+    }
+
+    qsort(holes, hole_count, sizeof(*holes), g_polygon_hole_compare);
+
+    for (size_t h = 0; h < hole_count; h++) {
+        const uint32_t hole = holes[h].node;
+        const uint32_t bridge = g_polygon_bridge(&polygon, hole, outline);
+        if (bridge == G_POLYGON_NONE) {
+            continue;
+        }
+
+        const uint32_t reverse = g_polygon_split(&polygon, bridge, hole);
+        g_polygon_filter(&polygon, reverse, polygon.nodes[reverse].next);
+        outline =
+            g_polygon_filter(&polygon, bridge, polygon.nodes[bridge].next);
+    }
+
+    g_polygon_clip(&polygon, outline);
+
+    *triangle_count = polygon.triangle_count;
+    g_arena_rewind(scratch, mark);
+    return true;
+}
@@ -0,0 +1,29 @@
+// Ear clipping triangulation of simple polygons with holes. Holes are joined
+// to the outline by bridge edges first, so the clipping sees one ring.
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include "arena.h"
+
+#include <cglm/cglm.h>
+
+// Most triangles of points spread over ring_count rings, the first of which
+// is the outline and the rest holes.
+static inline size_t g_polygon_max_triangles(size_t point_count,
+                                             size_t ring_count) {
+    return point_count + 2 * (ring_count - 1) - 2;
+}
+
+// Triangulate the rings of points, ring r ending before ring_ends[r]. Either
+// winding is accepted, holes must lie inside the outline without touching
+// each other. Writes counter clockwise triangles as point indices, at most
+// g_polygon_max_triangles of them, fewer for collinear points.
+//
+// Cost grows with the square of the point count, meant for outlines of up to
+// a few thousand points. Self intersecting input still terminates, with
+// overlapping triangles. Returns false if scratch runs out.
+bool g_polygon_triangulate(const vec2 *points, const uint32_t *ring_ends,
+                           size_t ring_count, g_arena *scratch,
+                           uint32_t *indices, size_t *triangle_count);
+
+#endif
@@ -0,0 +1,132 @@
+#include "projectile.h"
+#include "trace.h"
+
+void g_projectiles_init(g_projectiles *projectiles) {
+    projectiles->size = 0;
+    projectiles->hits = NULL;
+    projectiles->hit_count = 0;
+}
+
+bool g_projectiles_create(g_projectiles *projectiles,
+                          const g_projectile_create_ctx *ctx) {
+    if (projectiles->size >= MAX_G_PROJECTILES) {
+        return false;
+    }
+
+    size_t i = projectiles->size++;
+
+    projectiles->pos_x[i] = ctx->position[0];
+    projectiles->pos_y[i] = ctx->position[1];
+    projectiles->vel_x[i] = ctx->velocity[0];
+    projectiles->vel_y[i] = ctx->velocity[1];
+    projectiles->lifetime[i] = ctx->lifetime;
+    projectiles->ignore[i] = ctx->ignore;
+
+    return true;
+}
+
+static inline void g_projectiles_remove(g_projectiles *projectiles, size_t i) {
+    size_t last = --projectiles->size;
+
+    projectiles->pos_x[i] = projectiles->pos_x[last];
+    projectiles->pos_y[i] = projectiles->pos_y[last];
+    projectiles->vel_x[i] = projectiles->vel_x[last];
+    projectiles->vel_y[i] = projectiles->vel_y[last];
+    projectiles->lifetime[i] = projectiles->lifetime[last];
+    projectiles->ignore[i] = projectiles->ignore[last];
+}
+
+void g_projectiles_update(float dt, g_projectiles *projectiles,
+                          const g_actor_stack *stack, const g_actor_grid *grid,
+                          const g_level_walls *walls, g_arena *arena) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "projectiles");
+
+    // Hits are dropped rather than the tick if the arena is full
+    projectiles->hits =
+        g_arena_push_array(arena, g_projectile_hit, MAX_G_PROJECTILE_HITS);
+    projectiles->hit_count = 0;
+    const size_t hit_capacity =
+        projectiles->hits != NULL ? MAX_G_PROJECTILE_HITS : 0;
+
+    size_t i = 0;
+    while (i < projectiles->size) {
+        projectiles->lifetime[i] -= dt;
+        if (projectiles->lifetime[i] <= 0.0f) {
+            g_projectiles_remove(projectiles, i);
+            continue;
+        }
+
+        vec2 p = {projectiles->pos_x[i], projectiles->pos_y[i]};
+        vec2 d = {projectiles->vel_x[i] * dt, projectiles->vel_y[i] * dt};
+
+        // Only actors in front of the wall can be hit
+        float wall_t;
+        const bool wall =
+            walls != NULL && g_level_walls_raycast(walls, p, d, &wall_t);
+        if (wall) {
+            glm_vec2_scale(d, wall_t, d);
+        }
+
+        g_actor_ray_hit ray_hit;
+        if (!g_actor_grid_raycast(grid, stack, p, d, projectiles->ignore[i],
+                                  &ray_hit)) {
+            if (wall) {
+                g_projectiles_remove(projectiles, i);
+                continue;
+            }
+
+            projectiles->pos_x[i] += d[0];
+            projectiles->pos_y[i] += d[1];
+            i++;
+            continue;
+        }
+
+        if (projectiles->hit_count < hit_capacity) {
+            g_projectile_hit *hit =
+                &projectiles->hits[projectiles->hit_count++];
+
+            hit->actor = (stable_index_handle){
+                .index = ray_hit.actor,
+                .generation = stack->actor_index.generations[ray_hit.actor],
+            };
+            glm_vec2_copy(ray_hit.point, hit->point);
+            glm_vec2_copy(ray_hit.normal, hit->normal);
+            hit->velocity[0] = projectiles->vel_x[i];
+            hit->velocity[1] = projectiles->vel_y[i];
+        }
+
+        g_projectiles_remove(projectiles, i);
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "projectiles");
+}
+
+size_t g_projectiles_instances(const g_projectiles *projectiles,
+                               float fixed_overstep, float size, vec4 color,
+                               g_instance *out) {
+    const uint8_t r = g_color_channel(color[0]);
+    const uint8_t g = g_color_channel(color[1]);
+    const uint8_t b = g_color_channel(color[2]);
+    const uint8_t a = g_color_channel(color[3]);
+
+    for (size_t i = 0; i < projectiles->size; i++) {
+        const float vx = projectiles->vel_x[i];
+        const float vy = projectiles->vel_y[i];
+
+        const float len2 = vx * vx + vy * vy;
+        const float s = len2 > 0.0f ? size / sqrtf(len2) : 0.0f;
+
+        out[i] = (g_instance){
+            .x = projectiles->pos_x[i] + vx * fixed_overstep,
+            .y = projectiles->pos_y[i] + vy * fixed_overstep,
+            .fx = vx * s,
+            .fy = vy * s,
+            .r = r,
+            .g = g,
+            .b = b,
+            .a = a,
+        };
+    }
+
+    return projectiles->size;
+}
@@ -0,0 +1,65 @@
+// Pooled projectiles, integrated on the fixed tick and swept against actor
+// triangles.
+#ifndef PROJECTILE_H
+#define PROJECTILE_H
+
+#include "arena.h"
+#include "level.h"
+#include "spatial.h"
+
+#define MAX_G_PROJECTILES (size_t)16384
+#define MAX_G_PROJECTILE_HITS (size_t)1024
+
+typedef struct {
+    stable_index_handle actor;
+    // Point of impact and the hit edge's outward normal (zero if the
+    // projectile started inside the actor)
+    vec2 point;
+    vec2 normal;
+    vec2 velocity;
+} g_projectile_hit;
+
+// Dense SoA pool, removal moves the last projectile into the hole.
+typedef struct {
+    float pos_x[MAX_G_PROJECTILES];
+    float pos_y[MAX_G_PROJECTILES];
+    float vel_x[MAX_G_PROJECTILES];
+    float vel_y[MAX_G_PROJECTILES];
+    // Remaining lifetime in seconds
+    float lifetime[MAX_G_PROJECTILES];
+    // Actors with any of these mask bits are passed through
+    stable_index_mask_t ignore[MAX_G_PROJECTILES];
+
+    size_t size;
+
+    // Hits of the last g_projectiles_update, in the arena it was given
+    g_projectile_hit *hits;
+    size_t hit_count;
+} g_projectiles;
+
+typedef struct {
+    vec2 position;
+    vec2 velocity;
+    float lifetime;
+    stable_index_mask_t ignore;
+} g_projectile_create_ctx;
+
+void g_projectiles_init(g_projectiles *projectiles);
+
+// Returns false if the pool is full.
+bool g_projectiles_create(g_projectiles *projectiles,
+                          const g_projectile_create_ctx *ctx);
+
+// Advance every projectile by one fixed tick, replacing the hit buffer with
+// one pushed to arena. The grid must have been built from the same tick's
+// transforms. Projectiles hitting walls, if any, are dropped.
+void g_projectiles_update(float dt, g_projectiles *projectiles,
+                          const g_actor_stack *stack, const g_actor_grid *grid,
+                          const g_level_walls *walls, g_arena *arena);
+
+// Write one instance per projectile, returns the instance count.
+size_t g_projectiles_instances(const g_projectiles *projectiles,
+                               float fixed_overstep, float size, vec4 color,
+                               g_instance *out);
+
+#endif
@@ -0,0 +1,177 @@
+#include "render.h"
+#include "trace.h"
+
+#include <sokol/sokol_gfx.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void g_render_init(g_render *render, size_t capacity) {
+    render->pipeline_count = 0;
+    render->binding_count = 0;
+
+    render->commands = NULL;
+    render->items = NULL;
+    render->scratch = NULL;
+    render->size = 0;
+    render->capacity = capacity;
+
+    render->draw_calls = 0;
+    render->pipeline_switches = 0;
+    render->binding_switches = 0;
+}
+
+uint8_t g_render_add_pipeline(g_render *render,
+                              const g_render_pipeline *pipeline) {
+    if (render->pipeline_count >= G_RENDER_MAX_PIPELINES) {
+        printf("Reached render pipeline capacity!\n");
+        return G_RENDER_NO_PIPELINE;
+    }
+
+    render->pipelines[render->pipeline_count] = *pipeline;
+    return (uint8_t)render->pipeline_count++;
+}
+
+void g_render_begin(g_render *render, g_arena *arena) {
+    render->size = 0;
+    render->binding_count = 0;
+
+    const size_t capacity = render->capacity;
+    render->commands = g_arena_push_array(arena, g_draw_cmd, capacity);
+    render->items = g_arena_push_array(arena, g_render_sort_item, capacity);
+    render->scratch = g_arena_push_array(arena, g_render_sort_item, capacity);
+
+    // Out of frame memory, draw nothing rather than part of the frame
+    if (render->items == NULL || render->scratch == NULL) {
+        render->commands = NULL;
+    }
+}
+
+uint16_t g_render_bindings(g_render *render,
+                           const struct sg_bindings *bindings) {
+    if (render->binding_count >= G_RENDER_MAX_BINDINGS) {
+        printf("Reached render bindings capacity!\n");
+        return G_RENDER_NO_BINDINGS;
+    }
+
+    render->bindings[render->binding_count] = bindings;
+    return (uint16_t)render->binding_count++;
+}
+
+void g_render_push(g_render *render, const g_draw_cmd *cmd) {
+    if (render->commands == NULL || render->size >= render->capacity) {
+        return;
+    }
+
+    // From a pipeline that never got registered
+    if ((cmd->key >> 56) == G_RENDER_NO_PIPELINE) {
+        return;
+    }
+
+    const size_t i = render->size++;
+
+    render->commands[i] = *cmd;
+    render->items[i] = (g_render_sort_item){.key = cmd->key, .cmd = i};
+}
+
+// LSD radix sort on 8 bit digits, skipping digits every key shares.
+static void g_render_sort(g_render *render) {
+    g_render_sort_item *src = render->items;
+    g_render_sort_item *dst = render->scratch;
+    const size_t n = render->size;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {0};
+
+        for (size_t i = 0; i < n; i++) {
+            counts[(src[i].key >> shift) & 0xFF]++;
+        }
+
+        if (counts[(src[0].key >> shift) & 0xFF] == n) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            const size_t c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        g_render_sort_item *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    render->items = src;
+    render->scratch = dst;
+}
+
+void g_render_submit(g_render *render, mat4 vp) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "render_submit");
+
+    render->draw_calls = 0;
+    render->pipeline_switches = 0;
+    render->binding_switches = 0;
+
+    if (render->size == 0) {
+        G_TRACE_END(G_TRACE_SYSTEM, "render_submit");
+        return;
+    }
+
+    g_render_sort(render);
+
+    int pipeline_id = -1;
+    int bindings_id = -1;
+    const mat4 *model = NULL;
+    const vec4 *color = NULL;
+    const g_render_pipeline *pipeline = NULL;
+
+    for (size_t i = 0; i < render->size; i++) {
+        const g_draw_cmd *cmd = &render->commands[render->items[i].cmd];
+
+        const int p = (int)(cmd->key >> 56);
+        const int b = (int)((cmd->key >> 40) & 0xFFFF);
+
+        // Bindings and uniforms have to be reapplied after a pipeline switch
+        if (p != pipeline_id) {
+            pipeline_id = p;
+            pipeline = &render->pipelines[p];
+
+            sg_apply_pipeline((sg_pipeline){.id = pipeline->pipeline});
+            sg_apply_uniforms(pipeline->vp_slot,
+                              &(sg_range){.ptr = vp, .size = sizeof(mat4)});
+
+            bindings_id = -1;
+            model = NULL;
+            color = NULL;
+            render->pipeline_switches++;
+        }
+
+        if (b != bindings_id) {
+            bindings_id = b;
+            sg_apply_bindings(render->bindings[b]);
+            render->binding_switches++;
+        }
+
+        if (pipeline->model_slot >= 0 && cmd->model != model) {
+            model = cmd->model;
+            sg_apply_uniforms(pipeline->model_slot, &SG_RANGE(*model));
+        }
+
+        if (pipeline->color_slot >= 0 && cmd->color != color) {
+            color = cmd->color;
+            sg_apply_uniforms(pipeline->color_slot, &SG_RANGE(*color));
+        }
+
+        sg_draw(cmd->base_element, cmd->num_elements, cmd->num_instances);
+        render->draw_calls++;
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "render_submit");
+}
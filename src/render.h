@@ -0,0 +1,108 @@
+// Sorted draw command buffer, submitted once per frame.
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "arena.h"
+#include "common.h"
+
+// sokol_gfx decls, kept out of the header like g_static_meshes does.
+struct sg_bindings;
+
+#define G_RENDER_MAX_PIPELINES 16
+#define G_RENDER_MAX_BINDINGS 1024
+
+// Returned once the pipelines or this frame's bindings are full
+#define G_RENDER_NO_PIPELINE UINT8_MAX
+#define G_RENDER_NO_BINDINGS UINT16_MAX
+
+typedef struct {
+    // sg_pipeline id
+    uint32_t pipeline;
+
+    // Uniform slot of the frame's view projection, applied on every switch.
+    int vp_slot;
+    // Uniform slots of the per command model matrix and color, -1 if unused.
+    int model_slot;
+    int color_slot;
+} g_render_pipeline;
+
+// Sort key, from most to least significant:
+// pipeline (8 bits), bindings (16 bits), depth (24 bits, front to back).
+typedef uint64_t g_draw_key;
+
+typedef struct {
+    g_draw_key key;
+
+    // Per command uniforms, must stay alive until g_render_submit.
+    const mat4 *model;
+    const vec4 *color;
+
+    uint32_t base_element;
+    uint32_t num_elements;
+    uint32_t num_instances;
+} g_draw_cmd;
+
+typedef struct {
+    g_draw_key key;
+    uint32_t cmd;
+} g_render_sort_item;
+
+typedef struct {
+    g_render_pipeline pipelines[G_RENDER_MAX_PIPELINES];
+    size_t pipeline_count;
+
+    // Bindings referenced this frame, reset by g_render_begin.
+    const struct sg_bindings *bindings[G_RENDER_MAX_BINDINGS];
+    size_t binding_count;
+
+    // Pushed to the frame's arena by g_render_begin.
+    g_draw_cmd *commands;
+    g_render_sort_item *items;
+    g_render_sort_item *scratch;
+    size_t size;
+    size_t capacity;
+
+    // Stats of the last g_render_submit
+    size_t draw_calls;
+    size_t pipeline_switches;
+    size_t binding_switches;
+} g_render;
+
+// At most capacity commands per frame.
+void g_render_init(g_render *render, size_t capacity);
+
+// Register a pipeline for the lifetime of the renderer, returns its id or
+// G_RENDER_NO_PIPELINE.
+uint8_t g_render_add_pipeline(g_render *render,
+                              const g_render_pipeline *pipeline);
+
+// Start a new frame, dropping last frame's commands and bindings. The
+// command buffers are pushed to arena and live until it's reset.
+void g_render_begin(g_render *render, g_arena *arena);
+
+// Reference bindings for this frame, returns their id or
+// G_RENDER_NO_BINDINGS. Draws without an id have to be dropped.
+uint16_t g_render_bindings(g_render *render,
+                           const struct sg_bindings *bindings);
+
+// Quantize a z in the camera's [-10, 10] range, nearer sorts first.
+static inline uint32_t g_render_depth(float z) {
+    const float d = glm_clamp((10.0f - z) / 20.0f, 0.0f, 1.0f);
+    return (uint32_t)(d * 0xFFFFFF);
+}
+
+static inline g_draw_key g_render_key(uint8_t pipeline, uint16_t bindings,
+                                      uint32_t depth) {
+    return (g_draw_key)pipeline << 56 | (g_draw_key)bindings << 40 |
+           (g_draw_key)(depth & 0xFFFFFF) << 16;
+}
+
+// Append a command, silently dropped once the buffer is full or if its
+// pipeline is G_RENDER_NO_PIPELINE.
+void g_render_push(g_render *render, const g_draw_cmd *cmd);
+
+// Sort the frame's commands and submit them, skipping redundant state
+// changes. Must be called inside a pass.
+void g_render_submit(g_render *render, mat4 vp);
+
+#endif
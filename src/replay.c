@@ -0,0 +1,186 @@
+#include "replay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// File layout (native endianness):
+// magic[8], uint32 version, uint32 reserved, uint64 seed, g_level_params,
+// then per tick:
+// uint8 input, float mouse_world_pos[2], float camera_position[2], uint64 hash
+static const char g_replay_magic[8] = "CTRIRPL";
+
+#define G_REPLAY_TICK_SIZE (1 + sizeof(float) * 4 + sizeof(uint64_t))
+
+bool g_replay_record(g_replay *replay, const char *path, uint64_t seed,
+                     const g_level_params *level) {
+    *replay = (g_replay){
+        .mode = G_REPLAY_RECORD,
+        .seed = seed,
+        .divergence = SIZE_MAX,
+    };
+    if (level != NULL) {
+        replay->level = *level;
+    }
+
+    replay->file = fopen(path, "wb");
+    if (replay->file == NULL) {
+        printf("Couldn't open replay %s for writing!\n", path);
+        return false;
+    }
+
+    const uint32_t header[2] = {G_REPLAY_VERSION, 0};
+
+    if (fwrite(g_replay_magic, sizeof(g_replay_magic), 1, replay->file) != 1 ||
+        fwrite(header, sizeof(header), 1, replay->file) != 1 ||
+        fwrite(&seed, sizeof(seed), 1, replay->file) != 1 ||
+        fwrite(&replay->level, sizeof(replay->level), 1, replay->file) != 1) {
+        printf("Couldn't write replay %s!\n", path);
+        fclose(replay->file);
+        replay->file = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+bool g_replay_load(g_replay *replay, const char *path) {
+    *replay = (g_replay){
+        .mode = G_REPLAY_PLAY,
+        .divergence = SIZE_MAX,
+    };
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Couldn't open replay %s!\n", path);
+        return false;
+    }
+
+    char magic[8];
+    uint32_t header[2];
+
+    if (fread(magic, sizeof(magic), 1, file) != 1 ||
+        fread(header, sizeof(header), 1, file) != 1 ||
+        fread(&replay->seed, sizeof(replay->seed), 1, file) != 1 ||
+        fread(&replay->level, sizeof(replay->level), 1, file) != 1 ||
+        memcmp(magic, g_replay_magic, sizeof(magic)) != 0 ||
+        header[0] != G_REPLAY_VERSION) {
+        printf("%s isn't a version %d replay!\n", path, G_REPLAY_VERSION);
+        fclose(file);
+        return false;
+    }
+
+    const long start = ftell(file);
+    const long end =
+        start >= 0 && fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (end < start || fseek(file, start, SEEK_SET) != 0) {
+        printf("Couldn't read replay %s!\n", path);
+        fclose(file);
+        return false;
+    }
+
+    // A trailing partial tick is what an interrupted recording leaves
+    const size_t count = (size_t)(end - start) / G_REPLAY_TICK_SIZE;
+
+    replay->ticks = count <= SIZE_MAX / sizeof(g_replay_tick)
+                        ? malloc(sizeof(g_replay_tick) * max(count, 1))
+                        : NULL;
+    if (replay->ticks == NULL) {
+        printf("Couldn't allocate %zu ticks of replay %s!\n", count, path);
+        fclose(file);
+        return false;
+    }
+
+    uint8_t record[G_REPLAY_TICK_SIZE];
+    for (size_t i = 0; i < count; i++) {
+        if (fread(record, sizeof(record), 1, file) != 1) {
+            break;
+        }
+
+        g_replay_tick *tick = &replay->ticks[i];
+        tick->input = record[0];
+        memcpy(tick->mouse_world_pos, &record[1], sizeof(vec2));
+        memcpy(tick->camera_position, &record[1 + sizeof(vec2)],
+               sizeof(vec2));
+        memcpy(&tick->hash, &record[1 + sizeof(vec2) * 2], sizeof(uint64_t));
+
+        replay->size++;
+    }
+
+    fclose(file);
+    return true;
+}
+
+void g_replay_before_tick(g_replay *replay, g_input_map *input,
+                          g_camera *camera) {
+    if (replay->mode == G_REPLAY_RECORD) {
+        g_replay_tick *tick = &replay->pending;
+
+        tick->input = g_replay_pack_input(input);
+        glm_vec2_copy(camera->mouse_world_pos, tick->mouse_world_pos);
+        glm_vec2_copy(camera->position, tick->camera_position);
+        return;
+    }
+
+    if (g_replay_done(replay)) {
+        return;
+    }
+
+    g_replay_tick *tick = &replay->ticks[replay->cursor];
+
+    g_replay_unpack_input(tick->input, input);
+
+    glm_vec2_copy(tick->mouse_world_pos, camera->mouse_world_pos);
+    glm_vec2_copy(tick->camera_position, camera->position);
+}
+
+void g_replay_after_tick(g_replay *replay, uint64_t hash) {
+    if (replay->mode == G_REPLAY_RECORD) {
+        if (replay->file == NULL) {
+            return;
+        }
+
+        g_replay_tick *tick = &replay->pending;
+        tick->hash = hash;
+
+        uint8_t record[G_REPLAY_TICK_SIZE];
+        record[0] = tick->input;
+        memcpy(&record[1], tick->mouse_world_pos, sizeof(vec2));
+        memcpy(&record[1 + sizeof(vec2)], tick->camera_position,
+               sizeof(vec2));
+        memcpy(&record[1 + sizeof(vec2) * 2], &tick->hash, sizeof(uint64_t));
+
+        // Stop rather than record past a gap, the file then ends early
+        if (fwrite(record, sizeof(record), 1, replay->file) != 1) {
+            printf("Couldn't write replay tick %zu, recording stops!\n",
+                   replay->size);
+            fclose(replay->file);
+            replay->file = NULL;
+            return;
+        }
+        replay->size++;
+        return;
+    }
+
+    if (g_replay_done(replay)) {
+        return;
+    }
+
+    if (replay->divergence == SIZE_MAX &&
+        replay->ticks[replay->cursor].hash != hash) {
+        replay->divergence = replay->cursor;
+        printf("Replay diverged at tick %zu!\n", replay->cursor);
+    }
+
+    replay->cursor++;
+}
+
+void g_replay_close(g_replay *replay) {
+    // Buffered ticks are only written out here
+    if (replay->file != NULL && fclose(replay->file) != 0) {
+        printf("Couldn't finish writing the replay, it may be cut short!\n");
+    }
+    replay->file = NULL;
+
+    free(replay->ticks);
+    replay->ticks = NULL;
+}
@@ -0,0 +1,96 @@
+// Per fixed tick input recording and deterministic playback.
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "common.h"
+#include "level.h"
+
+#include <stdio.h>
+
+#define G_REPLAY_VERSION 2
+
+typedef enum {
+    G_REPLAY_RECORD,
+    G_REPLAY_PLAY,
+} g_replay_mode;
+
+// Input bits of a g_replay_tick
+enum g_replay_input : uint8_t {
+    G_REPLAY_LEFT = 1 << 0,
+    G_REPLAY_RIGHT = 1 << 1,
+    G_REPLAY_UP = 1 << 2,
+    G_REPLAY_DOWN = 1 << 3,
+    G_REPLAY_FIRE = 1 << 4,
+};
+
+static inline uint8_t g_replay_pack_input(const g_input_map *input) {
+    return G_REPLAY_LEFT * input->left | G_REPLAY_RIGHT * input->right |
+           G_REPLAY_UP * input->up | G_REPLAY_DOWN * input->down |
+           G_REPLAY_FIRE * input->fire;
+}
+
+// Unpack input bits, recomputing the direction.
+static inline void g_replay_unpack_input(uint8_t bits, g_input_map *input) {
+    input->left = bits & G_REPLAY_LEFT;
+    input->right = bits & G_REPLAY_RIGHT;
+    input->up = bits & G_REPLAY_UP;
+    input->down = bits & G_REPLAY_DOWN;
+    input->fire = bits & G_REPLAY_FIRE;
+    g_input_map_direction(input);
+}
+
+// Stored as 25 packed bytes per tick.
+typedef struct {
+    uint8_t input;
+    vec2 mouse_world_pos;
+    // The camera trails the player on the frame delta, so it's recorded too.
+    vec2 camera_position;
+    // g_world_hash after the tick
+    uint64_t hash;
+} g_replay_tick;
+
+typedef struct {
+    g_replay_mode mode;
+    uint64_t seed;
+    // Generated level played in, zeroed for none. Its walls are part of the
+    // simulation, so playback has to generate it again.
+    g_level_params level;
+
+    // Recording target and the tick being recorded
+    FILE *file;
+    g_replay_tick pending;
+
+    // Playback ticks
+    g_replay_tick *ticks;
+    size_t size;
+    size_t cursor;
+
+    // First tick whose hash didn't match the recording, SIZE_MAX if none.
+    size_t divergence;
+} g_replay;
+
+// Start recording into path, writing the header right away. level is the
+// generated level the world plays in, or NULL.
+bool g_replay_record(g_replay *replay, const char *path, uint64_t seed,
+                     const g_level_params *level);
+
+// Load a recording for playback.
+bool g_replay_load(g_replay *replay, const char *path);
+
+// Whether every recorded tick has been played back.
+static inline bool g_replay_done(const g_replay *replay) {
+    return replay->mode == G_REPLAY_PLAY && replay->cursor >= replay->size;
+}
+
+// Called before every fixed tick. Records the tick's inputs, or overwrites
+// them with the recorded ones.
+void g_replay_before_tick(g_replay *replay, g_input_map *input,
+                          g_camera *camera);
+
+// Called after every fixed tick with the world's hash.
+void g_replay_after_tick(g_replay *replay, uint64_t hash);
+
+// Flush and free the replay.
+void g_replay_close(g_replay *replay);
+
+#endif
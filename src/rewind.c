@@ -0,0 +1,376 @@
+#include "rewind.h"
+
+#include "snapshot.h"
+#include "trace.h"
+#include "world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Scalar state stored in front of the arrays.
+typedef struct {
+    g_snapshot_meta meta;
+    uint64_t projectile_count;
+    uint32_t substeps;
+    uint32_t ai_interval;
+} g_rewind_scalars;
+
+#define G_REWIND_MAX_SECTIONS (G_SNAPSHOT_MAX_SECTIONS + 8)
+
+// Stable index and actor arrays, followed by the projectile pool.
+static size_t g_rewind_sections(g_world *world, g_snapshot_section *out) {
+    g_projectiles *p = &world->projectiles;
+
+    size_t n = g_world_snapshot_sections(world, out);
+
+    out[n++] = (g_snapshot_section){0, p->pos_x, sizeof(p->pos_x)};
+    out[n++] = (g_snapshot_section){0, p->pos_y, sizeof(p->pos_y)};
+    out[n++] = (g_snapshot_section){0, p->vel_x, sizeof(p->vel_x)};
+    out[n++] = (g_snapshot_section){0, p->vel_y, sizeof(p->vel_y)};
+    out[n++] = (g_snapshot_section){0, p->lifetime, sizeof(p->lifetime)};
+    out[n++] = (g_snapshot_section){0, p->ignore, sizeof(p->ignore)};
+
+    return n;
+}
+
+static inline size_t g_rewind_pad(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+// Worst case is alternating changed and unchanged words, one token per pair.
+static inline size_t g_rewind_max_encoded(size_t state_size) {
+    return state_size * 2 + 16;
+}
+
+static void g_rewind_gather(g_world *world, uint64_t *state) {
+    g_snapshot_section sections[G_REWIND_MAX_SECTIONS];
+    const size_t count = g_rewind_sections(world, sections);
+
+    g_rewind_scalars scalars;
+    memset(&scalars, 0, sizeof(scalars));
+    g_world_snapshot_meta(world, &scalars.meta);
+    scalars.projectile_count = world->projectiles.size;
+    scalars.substeps = world->scheduler.substeps;
+    scalars.ai_interval = world->scheduler.ai_interval;
+
+    uint8_t *out = (uint8_t *)state;
+    memcpy(out, &scalars, sizeof(scalars));
+    out += g_rewind_pad(sizeof(scalars));
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(out, sections[i].data, sections[i].size);
+        memset(out + sections[i].size, 0,
+               g_rewind_pad(sections[i].size) - sections[i].size);
+        out += g_rewind_pad(sections[i].size);
+    }
+}
+
+static void g_rewind_scatter(g_world *world, const uint64_t *state) {
+    g_snapshot_section sections[G_REWIND_MAX_SECTIONS];
+    const size_t count = g_rewind_sections(world, sections);
+
+    const uint8_t *in = (const uint8_t *)state;
+
+    g_rewind_scalars scalars;
+    memcpy(&scalars, in, sizeof(scalars));
+    in += g_rewind_pad(sizeof(scalars));
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(sections[i].data, in, sections[i].size);
+        in += g_rewind_pad(sections[i].size);
+    }
+
+    g_world_snapshot_apply_meta(world, &scalars.meta);
+    world->projectiles.size = scalars.projectile_count;
+    world->projectiles.hit_count = 0;
+    world->scheduler.substeps = scalars.substeps;
+    world->scheduler.ai_interval = scalars.ai_interval;
+}
+
+bool g_rewind_init(g_rewind *rewind, g_world *world, size_t budget,
+                   size_t max_ticks) {
+    g_snapshot_section sections[G_REWIND_MAX_SECTIONS];
+    const size_t count = g_rewind_sections(world, sections);
+
+    size_t state_size = g_rewind_pad(sizeof(g_rewind_scalars));
+    for (size_t i = 0; i < count; i++) {
+        state_size += g_rewind_pad(sections[i].size);
+    }
+
+    const size_t max_encoded = g_rewind_max_encoded(state_size);
+
+    g_allocator *allocator = world->allocator;
+
+    *rewind = (g_rewind){
+        .allocator = allocator,
+        .state_size = state_size,
+        .data_capacity = max(budget, max_encoded * 2),
+        // Evicting a keyframe drops its deltas too
+        .entry_capacity = max_ticks + G_REWIND_KEYFRAME_INTERVAL,
+        .keyframe_interval = G_REWIND_KEYFRAME_INTERVAL,
+    };
+
+    // A tick count this large can't be stored anyway
+    if (rewind->entry_capacity < max_ticks ||
+        rewind->entry_capacity > SIZE_MAX / sizeof(g_rewind_entry)) {
+        printf("Can't keep %zu ticks of history!\n", max_ticks);
+        *rewind = (g_rewind){0};
+        return false;
+    }
+
+    rewind->last = g_alloc(allocator, G_ALLOC_TAG_REWIND, state_size,
+                           alignof(uint64_t));
+    rewind->state = g_alloc(allocator, G_ALLOC_TAG_REWIND, state_size,
+                            alignof(uint64_t));
+    rewind->encoded =
+        g_alloc(allocator, G_ALLOC_TAG_REWIND, max_encoded, alignof(uint64_t));
+    rewind->data = g_alloc(allocator, G_ALLOC_TAG_REWIND,
+                           rewind->data_capacity, alignof(uint64_t));
+    rewind->entries = g_alloc(allocator, G_ALLOC_TAG_REWIND,
+                              sizeof(g_rewind_entry) * rewind->entry_capacity,
+                              alignof(g_rewind_entry));
+
+    if (rewind->last == NULL || rewind->state == NULL ||
+        rewind->encoded == NULL || rewind->data == NULL ||
+        rewind->entries == NULL) {
+        g_rewind_delete(rewind);
+        return false;
+    }
+
+    memset(rewind->last, 0, state_size);
+    memset(rewind->state, 0, state_size);
+    return true;
+}
+
+// XOR state against base (zero if NULL) into runs of unchanged words and
+// literal changed words: uint32 zero words, uint32 literal words, literals.
+static size_t g_rewind_encode(const uint64_t *state, const uint64_t *base,
+                              size_t words, uint8_t *out) {
+    uint8_t *start = out;
+    size_t w = 0;
+
+    while (w < words) {
+        const size_t zeros_start = w;
+        while (w < words && state[w] == (base != NULL ? base[w] : 0)) {
+            w++;
+        }
+
+        const size_t literals_start = w;
+        while (w < words && state[w] != (base != NULL ? base[w] : 0)) {
+            w++;
+        }
+
+        const uint32_t token[2] = {(uint32_t)(literals_start - zeros_start),
+                                   (uint32_t)(w - literals_start)};
+        memcpy(out, token, sizeof(token));
+        out += sizeof(token);
+
+        for (size_t i = literals_start; i < w; i++) {
+            const uint64_t x = state[i] ^ (base != NULL ? base[i] : 0);
+            memcpy(out, &x, sizeof(x));
+            out += sizeof(x);
+        }
+    }
+
+    return out - start;
+}
+
+// XOR an encoded state onto state.
+static void g_rewind_decode(const uint8_t *in, size_t size, uint64_t *state) {
+    const uint8_t *end = in + size;
+    size_t w = 0;
+
+    while (in < end) {
+        uint32_t token[2];
+        memcpy(token, in, sizeof(token));
+        in += sizeof(token);
+
+        w += token[0];
+        for (uint32_t i = 0; i < token[1]; i++) {
+            uint64_t x;
+            memcpy(&x, in, sizeof(x));
+            in += sizeof(x);
+
+            state[w++] ^= x;
+        }
+    }
+}
+
+static inline g_rewind_entry *g_rewind_at(g_rewind *rewind, size_t i) {
+    return &rewind->entries[(rewind->first + i) % rewind->entry_capacity];
+}
+
+// Drop the oldest entry, and the deltas that depended on it.
+static void g_rewind_evict(g_rewind *rewind) {
+    do {
+        rewind->first = (rewind->first + 1) % rewind->entry_capacity;
+        rewind->count--;
+    } while (rewind->count > 0 && !g_rewind_at(rewind, 0)->keyframe);
+}
+
+// Find room for size bytes after the newest entry, evicting what overlaps.
+static size_t g_rewind_reserve(g_rewind *rewind, size_t size) {
+    size_t offset = rewind->head;
+    if (offset + size > rewind->data_capacity) {
+        offset = 0;
+    }
+
+    while (rewind->count > 0) {
+        const g_rewind_entry *oldest = g_rewind_at(rewind, 0);
+
+        if (oldest->offset + oldest->size <= offset ||
+            oldest->offset >= offset + size) {
+            break;
+        }
+
+        g_rewind_evict(rewind);
+    }
+
+    return offset;
+}
+
+void g_rewind_push(g_rewind *rewind, g_world *world,
+                   const g_input_map *input, const g_camera *camera) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "rewind_push");
+
+    const size_t words = rewind->state_size / 8;
+
+    // History must be consecutive, start over after a jump (e.g. a load)
+    if (rewind->count > 0 &&
+        g_rewind_at(rewind, rewind->count - 1)->tick + 1 != world->tick) {
+        rewind->count = 0;
+    }
+
+    if (rewind->count == rewind->entry_capacity) {
+        g_rewind_evict(rewind);
+    }
+
+    g_rewind_gather(world, rewind->state);
+
+    bool keyframe = rewind->count == 0 ||
+                    rewind->since_keyframe + 1 >= rewind->keyframe_interval;
+
+    size_t size = g_rewind_encode(rewind->state, keyframe ? NULL : rewind->last,
+                                  words, rewind->encoded);
+    size_t offset = g_rewind_reserve(rewind, size);
+
+    // Evicting everything leaves nothing for a delta to apply to
+    if (!keyframe && rewind->count == 0) {
+        keyframe = true;
+        size = g_rewind_encode(rewind->state, NULL, words, rewind->encoded);
+        offset = g_rewind_reserve(rewind, size);
+    }
+
+    memcpy(rewind->data + offset, rewind->encoded, size);
+
+    *g_rewind_at(rewind, rewind->count) = (g_rewind_entry){
+        .tick = world->tick,
+        .offset = offset,
+        .size = size,
+        .keyframe = keyframe,
+        .input = *input,
+        .camera = *camera,
+    };
+    rewind->count++;
+    rewind->head = offset + size;
+
+    rewind->since_keyframe = keyframe ? 0 : rewind->since_keyframe + 1;
+    if (keyframe) {
+        rewind->keyframes++;
+    } else {
+        rewind->deltas++;
+    }
+    rewind->bytes_encoded += size;
+
+    uint64_t *swap = rewind->last;
+    rewind->last = rewind->state;
+    rewind->state = swap;
+
+    G_TRACE_END(G_TRACE_SYSTEM, "rewind_push");
+}
+
+bool g_rewind_range(const g_rewind *rewind, uint64_t *oldest,
+                    uint64_t *newest) {
+    if (rewind->count == 0) {
+        return false;
+    }
+
+    *oldest = rewind->entries[rewind->first].tick;
+    *newest = *oldest + rewind->count - 1;
+    return true;
+}
+
+bool g_rewind_input(const g_rewind *rewind, uint64_t tick, g_input_map *input,
+                    g_camera *camera) {
+    uint64_t oldest, newest;
+    if (!g_rewind_range(rewind, &oldest, &newest) || tick < oldest ||
+        tick > newest) {
+        return false;
+    }
+
+    const g_rewind_entry *entry =
+        &rewind->entries[(rewind->first + (tick - oldest)) %
+                         rewind->entry_capacity];
+    *input = entry->input;
+    *camera = entry->camera;
+    return true;
+}
+
+bool g_rewind_restore(g_rewind *rewind, g_world *world, uint64_t tick) {
+    uint64_t oldest, newest;
+    if (!g_rewind_range(rewind, &oldest, &newest) || tick < oldest ||
+        tick > newest) {
+        return false;
+    }
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "rewind_restore");
+
+    const size_t target = tick - oldest;
+
+    size_t keyframe = target;
+    while (!g_rewind_at(rewind, keyframe)->keyframe) {
+        keyframe--;
+    }
+
+    memset(rewind->last, 0, rewind->state_size);
+    for (size_t i = keyframe; i <= target; i++) {
+        const g_rewind_entry *entry = g_rewind_at(rewind, i);
+        g_rewind_decode(rewind->data + entry->offset, entry->size,
+                        rewind->last);
+    }
+
+    g_rewind_scatter(world, rewind->last);
+
+    // The restored tick becomes the newest
+    const g_rewind_entry *entry = g_rewind_at(rewind, target);
+    rewind->count = target + 1;
+    rewind->head = entry->offset + entry->size;
+    rewind->since_keyframe = target - keyframe;
+
+    G_TRACE_END(G_TRACE_SYSTEM, "rewind_restore");
+    return true;
+}
+
+void g_rewind_delete(g_rewind *rewind) {
+    // Zeroed, never initialized or already deleted
+    if (rewind->allocator == NULL) {
+        return;
+    }
+
+    g_allocator *allocator = rewind->allocator;
+    const size_t max_encoded = g_rewind_max_encoded(rewind->state_size);
+
+    g_free(allocator, G_ALLOC_TAG_REWIND, rewind->last, rewind->state_size,
+           alignof(uint64_t));
+    g_free(allocator, G_ALLOC_TAG_REWIND, rewind->state, rewind->state_size,
+           alignof(uint64_t));
+    g_free(allocator, G_ALLOC_TAG_REWIND, rewind->encoded, max_encoded,
+           alignof(uint64_t));
+    g_free(allocator, G_ALLOC_TAG_REWIND, rewind->data, rewind->data_capacity,
+           alignof(uint64_t));
+    g_free(allocator, G_ALLOC_TAG_REWIND, rewind->entries,
+           sizeof(g_rewind_entry) * rewind->entry_capacity,
+           alignof(g_rewind_entry));
+    *rewind = (g_rewind){0};
+}
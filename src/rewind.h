@@ -0,0 +1,84 @@
+// Bounded history of recent fixed ticks, stored as keyframes and XOR deltas
+// of the simulation state, for rewinding and resimulating.
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "common.h"
+
+// g_world decl
+struct g_world;
+
+// A full state every this many ticks bounds the restore cost.
+#define G_REWIND_KEYFRAME_INTERVAL 16
+
+typedef struct {
+    uint64_t tick;
+    // Byte range of the encoded state in the data ring
+    size_t offset;
+    size_t size;
+    bool keyframe;
+
+    // What the tick ran with, so it can be resimulated
+    g_input_map input;
+    g_camera camera;
+} g_rewind_entry;
+
+typedef struct g_rewind {
+    // The world's, backs every buffer below
+    g_allocator *allocator;
+
+    // Size of the flattened simulation state, a multiple of 8
+    size_t state_size;
+    // State of the newest entry, the base of the next delta
+    uint64_t *last;
+    // Flattening and decoding target
+    uint64_t *state;
+    // Worst case encoding
+    uint8_t *encoded;
+
+    // Encoded states, oldest overwritten first
+    uint8_t *data;
+    size_t data_capacity;
+    size_t head;
+
+    // Entry ring, consecutive ticks starting with a keyframe
+    g_rewind_entry *entries;
+    size_t entry_capacity;
+    size_t first;
+    size_t count;
+
+    uint32_t keyframe_interval;
+    uint32_t since_keyframe;
+
+    // Counters
+    uint64_t keyframes;
+    uint64_t deltas;
+    uint64_t bytes_encoded;
+} g_rewind;
+
+// Keep the last max_ticks ticks of world in at most budget bytes, dropping the
+// oldest ticks first once full. The budget is raised to fit at least two
+// worst case states. Returns false if world's allocator runs out of memory,
+// leaving nothing to delete.
+bool g_rewind_init(g_rewind *rewind, struct g_world *world, size_t budget,
+                   size_t max_ticks);
+
+// Store the world's state after a fixed tick, along with the input and camera
+// the tick ran with. Called by g_world_update.
+void g_rewind_push(g_rewind *rewind, struct g_world *world,
+                   const g_input_map *input, const g_camera *camera);
+
+// Oldest and newest tick that can be restored, false if empty.
+bool g_rewind_range(const g_rewind *rewind, uint64_t *oldest,
+                    uint64_t *newest);
+
+// Input and camera tick ran with.
+bool g_rewind_input(const g_rewind *rewind, uint64_t tick, g_input_map *input,
+                    g_camera *camera);
+
+// Restore the state after tick, dropping every newer entry.
+bool g_rewind_restore(g_rewind *rewind, struct g_world *world, uint64_t tick);
+
+void g_rewind_delete(g_rewind *rewind);
+
+#endif
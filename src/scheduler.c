@@ -0,0 +1,91 @@
+#include "scheduler.h"
+
+// Share of real time a tick may cost before degrading, and below which
+// quality is restored.
+static const float g_overload_load = 0.5f;
+static const float g_idle_load = 0.2f;
+// Frames a load level has to persist before reacting
+static const uint32_t g_overload_frames = 4;
+static const uint32_t g_idle_frames = 120;
+
+void g_tick_scheduler_init(g_tick_scheduler *scheduler) {
+    *scheduler = (g_tick_scheduler){
+        .max_ticks_per_frame = 8,
+        .budget = 1.0f / 120,
+        .adaptive = true,
+        .substeps = 2,
+        .max_substeps = 2,
+        .ai_interval = 1,
+        .max_ai_interval = 4,
+    };
+}
+
+uint32_t g_tick_scheduler_plan(g_tick_scheduler *scheduler, float fixed_dt,
+                               float *accumulator) {
+    uint32_t ticks = (uint32_t)(*accumulator / fixed_dt);
+
+    uint32_t cap = scheduler->max_ticks_per_frame;
+    if (scheduler->tick_cost > 0.0f) {
+        const uint32_t affordable =
+            (uint32_t)(scheduler->budget / scheduler->tick_cost);
+        cap = max(min(affordable, cap), 1u);
+    }
+
+    if (ticks > cap) {
+        scheduler->ticks_dropped += ticks - cap;
+        *accumulator -= (ticks - cap) * fixed_dt;
+        ticks = cap;
+    }
+
+    return ticks;
+}
+
+void g_tick_scheduler_record(g_tick_scheduler *scheduler, float cost) {
+    scheduler->ticks_run++;
+
+    if (scheduler->tick_cost == 0.0f) {
+        scheduler->tick_cost = cost;
+    } else {
+        scheduler->tick_cost += (cost - scheduler->tick_cost) * 0.1f;
+    }
+}
+
+void g_tick_scheduler_adapt(g_tick_scheduler *scheduler, float fixed_dt) {
+    if (!scheduler->adaptive) {
+        return;
+    }
+
+    const float load = scheduler->tick_cost / fixed_dt;
+
+    if (load > g_overload_load) {
+        scheduler->idle_frames = 0;
+
+        if (++scheduler->overloaded_frames < g_overload_frames) {
+            return;
+        }
+        scheduler->overloaded_frames = 0;
+
+        // AI first, physics quality last
+        if (scheduler->ai_interval < scheduler->max_ai_interval) {
+            scheduler->ai_interval *= 2;
+        } else if (scheduler->substeps > 1) {
+            scheduler->substeps--;
+        }
+    } else if (load < g_idle_load) {
+        scheduler->overloaded_frames = 0;
+
+        if (++scheduler->idle_frames < g_idle_frames) {
+            return;
+        }
+        scheduler->idle_frames = 0;
+
+        if (scheduler->substeps < scheduler->max_substeps) {
+            scheduler->substeps++;
+        } else if (scheduler->ai_interval > 1) {
+            scheduler->ai_interval /= 2;
+        }
+    } else {
+        scheduler->overloaded_frames = 0;
+        scheduler->idle_frames = 0;
+    }
+}
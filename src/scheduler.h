@@ -0,0 +1,51 @@
+// Frame budgeted fixed tick scheduling, keeps slow frames from snowballing.
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "common.h"
+
+typedef struct {
+    // Hard cap on the fixed ticks run by one g_world_update.
+    uint32_t max_ticks_per_frame;
+    // Wall time (seconds) one frame may spend on fixed ticks.
+    float budget;
+    // Whether substeps and the AI rate may change under load. Off while
+    // replaying, since both change the simulation.
+    bool adaptive;
+
+    // Smoothed wall time of one fixed tick, in seconds.
+    float tick_cost;
+
+    // Physics substeps per tick, lowered under load.
+    uint32_t substeps;
+    uint32_t max_substeps;
+
+    // Multiplies the update interval of every AI level of detail, raised
+    // under load.
+    uint32_t ai_interval;
+    uint32_t max_ai_interval;
+
+    // Consecutive frames over / under the load thresholds
+    uint32_t overloaded_frames;
+    uint32_t idle_frames;
+
+    // Counters
+    uint64_t ticks_run;
+    // Backlog discarded to stay within the cap or budget
+    uint64_t ticks_dropped;
+} g_tick_scheduler;
+
+void g_tick_scheduler_init(g_tick_scheduler *scheduler);
+
+// Number of fixed ticks to run this frame. Drops any backlog beyond the cap
+// or budget from accumulator.
+uint32_t g_tick_scheduler_plan(g_tick_scheduler *scheduler, float fixed_dt,
+                               float *accumulator);
+
+// Report the measured wall time of one fixed tick.
+void g_tick_scheduler_record(g_tick_scheduler *scheduler, float cost);
+
+// Adjust substeps and AI rate once per frame, after the ticks ran.
+void g_tick_scheduler_adapt(g_tick_scheduler *scheduler, float fixed_dt);
+
+#endif
@@ -0,0 +1,202 @@
+// Authoritative replication server, steps the world headless at the fixed
+// tick rate and streams snapshots to its clients. --bots connects loopback
+// clients from the same process, for testing and load measurements.
+#define SOKOL_IMPL
+#include <sokol/sokol_gfx.h>
+#include <sokol/sokol_log.h>
+#include <sokol/sokol_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "net.h"
+#include "trace.h"
+#include "world.h"
+
+static g_world world;
+
+static g_net_server server;
+
+typedef struct {
+    g_net_client client;
+    g_input_map input;
+    g_camera camera;
+    g_rng rng;
+} g_bot;
+
+static void usage(const char *name) {
+    printf("usage: %s [--port N] [--seed N] [--ticks N] [--interval N] "
+           "[--bots N] [--fast] [--trace PATH]\n",
+           name);
+}
+
+// Wander around, picking new directions now and then.
+static void g_bot_think(g_bot *bot, uint64_t tick) {
+    if (tick % 64 == 0) {
+        g_replay_unpack_input((uint8_t)(g_rng_next(&bot->rng) & 0xf),
+                              &bot->input);
+        bot->camera.mouse_world_pos[0] = rand_float(&bot->rng, -5.0f, 5.0f);
+        bot->camera.mouse_world_pos[1] = rand_float(&bot->rng, -5.0f, 5.0f);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint16_t port = G_NET_DEFAULT_PORT;
+    uint64_t seed = (uint64_t)time(NULL);
+    uint64_t ticks = 0;
+    uint32_t interval = 2;
+    size_t bot_count = 0;
+    bool fast = false;
+    const char *trace_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = (uint16_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = max((uint32_t)strtoul(argv[++i], NULL, 10), 1u);
+        } else if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc) {
+            bot_count = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    sg_setup(&(sg_desc){
+        .logger.func = slog_func,
+    });
+    stm_setup();
+
+    if (trace_path != NULL &&
+        !g_trace_init(trace_path, G_TRACE_DETAIL, 1)) {
+        return 1;
+    }
+    g_trace_thread_name("server thread");
+
+    if (!g_world_init(&world, &g_heap_allocator, seed)) {
+        return 1;
+    }
+
+    if (!g_net_server_init(&server, port)) {
+        g_world_delete(&world);
+        return 1;
+    }
+    server.send_interval = interval;
+
+    // --bots is unchecked, a count too large fails here
+    g_bot *bots = bot_count > 0 ? calloc(bot_count, sizeof(g_bot)) : NULL;
+    if (bot_count > 0 && bots == NULL) {
+        printf("Couldn't allocate %zu bots!\n", bot_count);
+        g_net_server_delete(&server);
+        g_world_delete(&world);
+        return 1;
+    }
+
+    for (size_t i = 0; i < bot_count; i++) {
+        if (!g_net_client_init(&bots[i].client, "127.0.0.1", port)) {
+            for (size_t j = 0; j < i; j++) {
+                g_net_client_delete(&bots[j].client);
+            }
+            free(bots);
+            g_net_server_delete(&server);
+            g_world_delete(&world);
+            return 1;
+        }
+        g_rng_seed(&bots[i].rng, seed + i);
+    }
+
+    printf("serving on port %u, seed %llu\n", port, (unsigned long long)seed);
+
+    const uint64_t start = stm_now();
+    uint64_t net_time = 0;
+
+    for (uint64_t t = 0; ticks == 0 || t < ticks; t++) {
+        const double now = stm_sec(stm_since(start));
+        g_trace_frame();
+
+        for (size_t i = 0; i < bot_count; i++) {
+            g_bot_think(&bots[i], world.tick);
+            g_net_client_update(&bots[i].client, g_fixed_dt, now,
+                                &bots[i].input, &bots[i].camera);
+        }
+
+        const uint64_t receive_start = stm_now();
+        g_net_server_receive(&server, &world, now);
+        g_net_server_players(&server, &world, g_fixed_dt);
+        net_time += stm_since(receive_start);
+
+        g_world_update(g_fixed_dt, &world);
+
+        const uint64_t send_start = stm_now();
+        g_net_server_send(&server, &world);
+        net_time += stm_since(send_start);
+
+        if (!fast) {
+            const double deadline = (t + 1) * (double)g_fixed_dt;
+            const double remaining = deadline - stm_sec(stm_since(start));
+
+            if (remaining > 0.0) {
+                nanosleep(&(struct timespec){.tv_nsec = remaining * 1e9},
+                          NULL);
+            }
+        }
+    }
+
+    const double seconds = stm_sec(stm_since(start));
+
+    printf("ticks: %llu\n", (unsigned long long)ticks);
+    printf("elapsed: %.3f s\n", seconds);
+    printf("clients: %zu\n", server.client_count);
+    printf("snapshots sent: %llu\n",
+           (unsigned long long)server.snapshots_sent);
+    printf("bytes/snapshot: %.1f\n",
+           server.snapshots_sent > 0
+               ? (double)server.bytes_sent / server.snapshots_sent
+               : 0.0);
+    printf("server net ms/tick: %.3f\n", stm_ms(net_time) / ticks);
+    printf("server net us/client/tick: %.2f\n",
+           server.client_count > 0
+               ? stm_us(net_time) / ticks / server.client_count
+               : 0.0);
+
+    int ret = 0;
+    if (bot_count > 0) {
+        uint64_t received = 0, dropped = 0, errors = 0;
+
+        for (size_t i = 0; i < bot_count; i++) {
+            received += bots[i].client.snapshots_received;
+            dropped += bots[i].client.snapshots_dropped;
+            errors += bots[i].client.checksum_errors;
+        }
+
+        printf("bot snapshots received: %llu\n", (unsigned long long)received);
+        printf("bot snapshots dropped: %llu\n", (unsigned long long)dropped);
+        printf("bot checksum errors: %llu\n", (unsigned long long)errors);
+
+        if (received == 0 || errors > 0) {
+            ret = 2;
+        }
+    }
+
+    for (size_t i = 0; i < bot_count; i++) {
+        g_net_client_delete(&bots[i].client);
+    }
+    free(bots);
+
+    g_net_server_delete(&server);
+    g_world_delete(&world);
+    g_trace_shutdown();
+    sg_shutdown();
+
+    return ret;
+}
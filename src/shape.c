@@ -0,0 +1,373 @@
+#include "shape.h"
+#include "common.h"
+#include "fastmath.h"
+
+#include <float.h>
+#include <stdio.h>
+
+g_shape_registry g_shapes;
+
+static inline float g_vec2_cross(const vec2 a, const vec2 b) {
+    return a[0] * b[1] - a[1] * b[0];
+}
+
+static g_shape_id g_shapes_push(const g_shape *shape) {
+    if (g_shapes.count == G_SHAPE_MAX) {
+        printf("Too many shapes, at most %d!\n", G_SHAPE_MAX);
+        return G_SHAPE_NONE;
+    }
+
+    g_shapes.shapes[g_shapes.count] = *shape;
+    return (g_shape_id)g_shapes.count++;
+}
+
+g_shape_id g_shapes_add_polygon(const vec2 *vertices, uint32_t count) {
+    if (count < 3 || count > G_SHAPE_MAX_VERTICES) {
+        printf("Shapes take 3 to %d vertices, not %u!\n",
+               G_SHAPE_MAX_VERTICES, count);
+        return G_SHAPE_NONE;
+    }
+
+    g_shape shape = {
+        .kind = count == 3 ? G_SHAPE_KIND_TRIANGLE : G_SHAPE_KIND_POLYGON,
+        .vertex_count = count,
+    };
+
+    float area = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        area += g_vec2_cross(vertices[i], vertices[(i + 1) % count]);
+    }
+
+    // Clockwise input is reversed
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t from = area < 0.0f ? count - 1 - i : i;
+        glm_vec2_copy((float *)vertices[from], shape.vertices[i]);
+        shape.radius =
+            glm_max(shape.radius, g_vec2_length(shape.vertices[i]));
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        vec2 edge, next;
+        glm_vec2_sub(shape.vertices[(i + 1) % count], shape.vertices[i],
+                     edge);
+        glm_vec2_sub(shape.vertices[(i + 2) % count],
+                     shape.vertices[(i + 1) % count], next);
+
+        // Every corner turns left, which also rules out zero length edges
+        if (g_vec2_cross(edge, next) <= 0.0f) {
+            printf("Shape isn't convex!\n");
+            return G_SHAPE_NONE;
+        }
+
+        glm_vec2_normalize(edge);
+        shape.normals[i][0] = edge[1];
+        shape.normals[i][1] = -edge[0];
+    }
+
+    return g_shapes_push(&shape);
+}
+
+g_shape_id g_shapes_add_regular(uint32_t sides, float radius) {
+    vec2 vertices[G_SHAPE_MAX_VERTICES];
+    const uint32_t count = min(sides, (uint32_t)G_SHAPE_MAX_VERTICES);
+
+    for (uint32_t i = 0; i < count; i++) {
+        float s, c;
+        g_sincosf(2.0f * GLM_PIf * (float)i / (float)count, &s, &c);
+        vertices[i][0] = c * radius;
+        vertices[i][1] = s * radius;
+    }
+
+    // Rejects sides out of range before reading vertices
+    return g_shapes_add_polygon(vertices, sides);
+}
+
+g_shape_id g_shapes_add_circle(float radius) {
+    return g_shapes_push(&(g_shape){
+        .kind = G_SHAPE_KIND_CIRCLE,
+        .radius = radius,
+    });
+}
+
+void g_shapes_init(void) {
+    if (g_shapes.count != 0) {
+        return;
+    }
+
+    g_shapes_add_polygon(g_unit_triangle, 3);
+    g_shapes_add_regular(4, 0.5f);
+    g_shapes_add_regular(6, 0.5f);
+    g_shapes_add_circle(0.5f);
+}
+
+uint32_t g_shape_triangulate(const g_shape *shape, vec2 *out) {
+    vec2 circle[G_SHAPE_CIRCLE_SIDES];
+    const vec2 *vertices = shape->vertices;
+    uint32_t count = shape->vertex_count;
+
+    if (shape->kind == G_SHAPE_KIND_CIRCLE) {
+        for (uint32_t i = 0; i < G_SHAPE_CIRCLE_SIDES; i++) {
+            float s, c;
+            g_sincosf(2.0f * GLM_PIf * (float)i / G_SHAPE_CIRCLE_SIDES, &s,
+                      &c);
+            circle[i][0] = c * shape->radius;
+            circle[i][1] = s * shape->radius;
+        }
+
+        vertices = circle;
+        count = G_SHAPE_CIRCLE_SIDES;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 1; i + 1 < count; i++) {
+        glm_vec2_copy((float *)vertices[0], out[n++]);
+        glm_vec2_copy((float *)vertices[i], out[n++]);
+        glm_vec2_copy((float *)vertices[i + 1], out[n++]);
+    }
+
+    return n;
+}
+
+void g_shape_orient(const g_shape *shape, float rotation, const vec2 scale,
+                    g_shape_pose *out) {
+    const float sx = scale[0];
+    const float sy = scale[1];
+
+    float s, c;
+    g_sincosf(rotation, &s, &c);
+
+    out->kind = shape->kind;
+    out->vertex_count = shape->vertex_count;
+    out->radius = g_shape_scaled_radius(shape, scale);
+
+    // Normals take the inverse scale, only a sign per axis when uniform
+    const bool uniform = fabsf(sx) == fabsf(sy);
+    const float nx = uniform ? (sx < 0.0f ? -1.0f : 1.0f) : 1.0f / sx;
+    const float ny = uniform ? (sy < 0.0f ? -1.0f : 1.0f) : 1.0f / sy;
+
+    for (uint32_t i = 0; i < shape->vertex_count; i++) {
+        const float x = shape->vertices[i][0] * sx;
+        const float y = shape->vertices[i][1] * sy;
+        out->vertices[i][0] = c * x - s * y;
+        out->vertices[i][1] = s * x + c * y;
+
+        const float n0 = shape->normals[i][0] * nx;
+        const float n1 = shape->normals[i][1] * ny;
+        out->normals[i][0] = c * n0 - s * n1;
+        out->normals[i][1] = s * n0 + c * n1;
+
+        if (!uniform) {
+            glm_vec2_normalize(out->normals[i]);
+        }
+    }
+}
+
+// Range of points, moved by offset, along axis.
+static inline void g_shape_project(const vec2 *points, uint32_t count,
+                                   const vec2 offset, const vec2 axis,
+                                   float *lo, float *hi) {
+    float p_lo = FLT_MAX;
+    float p_hi = -FLT_MAX;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const float p = points[i][0] * axis[0] + points[i][1] * axis[1];
+        p_lo = glm_min(p_lo, p);
+        p_hi = glm_max(p_hi, p);
+    }
+
+    const float o = offset[0] * axis[0] + offset[1] * axis[1];
+    *lo = p_lo + o;
+    *hi = p_hi + o;
+}
+
+// Test the edge normals of a as axes, with b offset from a. False on a
+// separating axis, otherwise lowers contact's overlap to the least one.
+static inline bool g_shape_axes(const g_shape_pose *a, uint32_t a_count,
+                                const g_shape_pose *b, uint32_t b_count,
+                                const vec2 offset, g_shape_contact *contact) {
+    for (uint32_t i = 0; i < a_count; i++) {
+        float a_lo, a_hi, b_lo, b_hi;
+        g_shape_project(a->vertices, a_count, GLM_VEC2_ZERO, a->normals[i],
+                        &a_lo, &a_hi);
+        g_shape_project(b->vertices, b_count, offset, a->normals[i], &b_lo,
+                        &b_hi);
+
+        if (b_hi < a_lo || a_hi < b_lo) {
+            return false;
+        }
+
+        const float overlap = glm_min(a_hi, b_hi) - glm_max(a_lo, b_lo);
+        if (overlap < contact->overlap) {
+            contact->overlap = overlap;
+            glm_vec2_copy((float *)a->normals[i], contact->normal);
+        }
+    }
+
+    return true;
+}
+
+// Point the normal from a towards b.
+static inline void g_shape_contact_face(g_shape_contact *contact,
+                                        const vec2 offset) {
+    if (glm_vec2_dot(contact->normal, (float *)offset) < 0.0f) {
+        glm_vec2_negate(contact->normal);
+    }
+}
+
+// Counts are constants in the kernels below, so each one gets its own
+// unrolled loops.
+static inline void g_shape_polygons(const g_shape_pose *a, uint32_t a_count,
+                                    const g_shape_pose *b, uint32_t b_count,
+                                    const vec2 offset,
+                                    g_shape_contact *contact) {
+    const vec2 back = {-offset[0], -offset[1]};
+
+    contact->overlap = FLT_MAX;
+    contact->intersection =
+        g_shape_axes(a, a_count, b, b_count, offset, contact) &&
+        g_shape_axes(b, b_count, a, a_count, back, contact);
+
+    if (contact->intersection) {
+        g_shape_contact_face(contact, offset);
+    }
+}
+
+static void g_shape_tri_tri(const g_shape_pose *a, const g_shape_pose *b,
+                            const vec2 offset, g_shape_contact *contact) {
+    g_shape_polygons(a, 3, b, 3, offset, contact);
+}
+
+static void g_shape_tri_poly(const g_shape_pose *a, const g_shape_pose *b,
+                             const vec2 offset, g_shape_contact *contact) {
+    g_shape_polygons(a, 3, b, b->vertex_count, offset, contact);
+}
+
+static void g_shape_poly_tri(const g_shape_pose *a, const g_shape_pose *b,
+                             const vec2 offset, g_shape_contact *contact) {
+    g_shape_polygons(a, a->vertex_count, b, 3, offset, contact);
+}
+
+static void g_shape_poly_poly(const g_shape_pose *a, const g_shape_pose *b,
+                              const vec2 offset, g_shape_contact *contact) {
+    g_shape_polygons(a, a->vertex_count, b, b->vertex_count, offset,
+                     contact);
+}
+
+// Axes are the polygon's normals and the direction from its closest vertex
+// to the circle's center.
+static void g_shape_circle_poly(const g_shape_pose *a, const g_shape_pose *b,
+                                const vec2 offset, g_shape_contact *contact) {
+    const uint32_t count = b->vertex_count;
+    const float r = a->radius;
+    // Circle center relative to the polygon
+    const vec2 center = {-offset[0], -offset[1]};
+
+    contact->intersection = false;
+    contact->overlap = FLT_MAX;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float lo, hi;
+        g_shape_project(b->vertices, count, GLM_VEC2_ZERO, b->normals[i], &lo,
+                        &hi);
+
+        const float c = glm_vec2_dot((float *)center, (float *)b->normals[i]);
+        if (c + r < lo || hi < c - r) {
+            return;
+        }
+
+        const float overlap = glm_min(hi, c + r) - glm_max(lo, c - r);
+        if (overlap < contact->overlap) {
+            contact->overlap = overlap;
+            glm_vec2_copy((float *)b->normals[i], contact->normal);
+        }
+    }
+
+    uint32_t closest = 0;
+    float closest_distance = FLT_MAX;
+    for (uint32_t i = 0; i < count; i++) {
+        const float d = glm_vec2_distance2((float *)center,
+                                           (float *)b->vertices[i]);
+        if (d < closest_distance) {
+            closest_distance = d;
+            closest = i;
+        }
+    }
+
+    // Zero when the center sits on a corner, already covered by the normals
+    if (closest_distance > 0.0f) {
+        vec2 axis;
+        glm_vec2_sub((float *)center, (float *)b->vertices[closest], axis);
+        glm_vec2_scale(axis, 1.0f / sqrtf(closest_distance), axis);
+
+        float lo, hi;
+        g_shape_project(b->vertices, count, GLM_VEC2_ZERO, axis, &lo, &hi);
+
+        const float c = glm_vec2_dot((float *)center, axis);
+        if (c + r < lo || hi < c - r) {
+            return;
+        }
+
+        const float overlap = glm_min(hi, c + r) - glm_max(lo, c - r);
+        if (overlap < contact->overlap) {
+            contact->overlap = overlap;
+            glm_vec2_copy(axis, contact->normal);
+        }
+    }
+
+    contact->intersection = true;
+    g_shape_contact_face(contact, offset);
+}
+
+static void g_shape_poly_circle(const g_shape_pose *a, const g_shape_pose *b,
+                                const vec2 offset, g_shape_contact *contact) {
+    const vec2 back = {-offset[0], -offset[1]};
+    g_shape_circle_poly(b, a, back, contact);
+    if (contact->intersection) {
+        glm_vec2_negate(contact->normal);
+    }
+}
+
+static void g_shape_circle_circle(const g_shape_pose *a,
+                                  const g_shape_pose *b, const vec2 offset,
+                                  g_shape_contact *contact) {
+    const float reach = a->radius + b->radius;
+    const float distance2 = glm_vec2_norm2((float *)offset);
+
+    contact->intersection = distance2 <= reach * reach;
+    if (!contact->intersection) {
+        return;
+    }
+
+    const float distance = sqrtf(distance2);
+    contact->overlap = reach - distance;
+
+    // Any direction will do for concentric circles
+    if (distance > 0.0f) {
+        glm_vec2_scale((float *)offset, 1.0f / distance, contact->normal);
+    } else {
+        contact->normal[0] = 1.0f;
+        contact->normal[1] = 0.0f;
+    }
+}
+
+const g_shape_collide_fn g_shape_collide_table[G_SHAPE_KIND_COUNT]
+                                              [G_SHAPE_KIND_COUNT] = {
+    [G_SHAPE_KIND_TRIANGLE] =
+        {
+            [G_SHAPE_KIND_TRIANGLE] = g_shape_tri_tri,
+            [G_SHAPE_KIND_POLYGON] = g_shape_tri_poly,
+            [G_SHAPE_KIND_CIRCLE] = g_shape_poly_circle,
+        },
+    [G_SHAPE_KIND_POLYGON] =
+        {
+            [G_SHAPE_KIND_TRIANGLE] = g_shape_poly_tri,
+            [G_SHAPE_KIND_POLYGON] = g_shape_poly_poly,
+            [G_SHAPE_KIND_CIRCLE] = g_shape_poly_circle,
+        },
+    [G_SHAPE_KIND_CIRCLE] =
+        {
+            [G_SHAPE_KIND_TRIANGLE] = g_shape_circle_poly,
+            [G_SHAPE_KIND_POLYGON] = g_shape_circle_poly,
+            [G_SHAPE_KIND_CIRCLE] = g_shape_circle_circle,
+        },
+};
@@ -0,0 +1,121 @@
+// Convex collision shapes, registered once and shared by every actor using
+// them. Edge normals are computed at registration, so placing a shape only
+// rotates them. Pairs are tested by a kernel picked per kind pair.
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <cglm/cglm.h>
+
+#include <stdint.h>
+
+#define G_SHAPE_MAX_VERTICES 8
+#define G_SHAPE_MAX 32
+// Circles are drawn as polygons of this many sides
+#define G_SHAPE_CIRCLE_SIDES 16
+// Most points g_shape_triangulate writes
+#define G_SHAPE_MAX_TRIANGLE_POINTS ((G_SHAPE_CIRCLE_SIDES - 2) * 3)
+
+enum g_shape_kind : uint8_t {
+    G_SHAPE_KIND_TRIANGLE,
+    G_SHAPE_KIND_POLYGON,
+    G_SHAPE_KIND_CIRCLE,
+    G_SHAPE_KIND_COUNT,
+};
+
+typedef uint8_t g_shape_id;
+
+#define G_SHAPE_NONE (g_shape_id)UINT8_MAX
+
+// Registered by g_shapes_init in this order, each with a diameter of 1
+enum g_shape_builtin : g_shape_id {
+    // g_unit_triangle, the shape of zero initialized actors
+    G_SHAPE_TRIANGLE,
+    G_SHAPE_QUAD,
+    G_SHAPE_HEXAGON,
+    G_SHAPE_CIRCLE,
+    G_SHAPE_BUILTIN_COUNT,
+};
+
+typedef struct {
+    enum g_shape_kind kind;
+    // Zero for circles
+    uint32_t vertex_count;
+    // Counter clockwise
+    vec2 vertices[G_SHAPE_MAX_VERTICES];
+    // Outward unit normal of the edge from vertex i to vertex i + 1
+    vec2 normals[G_SHAPE_MAX_VERTICES];
+    // Bounding circle around the origin, the circle itself for circles
+    float radius;
+} g_shape;
+
+typedef struct {
+    g_shape shapes[G_SHAPE_MAX];
+    size_t count;
+} g_shape_registry;
+
+extern g_shape_registry g_shapes;
+
+// Register the built in shapes, does nothing once they are.
+void g_shapes_init(void);
+
+// Register a convex polygon of either winding, returns its id. G_SHAPE_NONE
+// if it isn't convex, has more than G_SHAPE_MAX_VERTICES or the registry is
+// full.
+g_shape_id g_shapes_add_polygon(const vec2 *vertices, uint32_t count);
+// Regular polygon with a corner along +x, like g_unit_triangle.
+g_shape_id g_shapes_add_regular(uint32_t sides, float radius);
+g_shape_id g_shapes_add_circle(float radius);
+
+static inline const g_shape *g_shape_get(g_shape_id id) {
+    return &g_shapes.shapes[id];
+}
+
+// Counter clockwise triangle list of shape for drawing, a fan from its first
+// vertex. Returns the point count, at most G_SHAPE_MAX_TRIANGLE_POINTS.
+uint32_t g_shape_triangulate(const g_shape *shape, vec2 *out);
+
+// Radius of the bounding circle of shape scaled by scale, the pose's radius.
+// Circles take the larger scale.
+static inline float g_shape_scaled_radius(const g_shape *shape,
+                                          const vec2 scale) {
+    return shape->radius * glm_max(fabsf(scale[0]), fabsf(scale[1]));
+}
+
+// A shape rotated and scaled, still around the origin.
+typedef struct {
+    enum g_shape_kind kind;
+    uint32_t vertex_count;
+    float radius;
+    vec2 vertices[G_SHAPE_MAX_VERTICES];
+    vec2 normals[G_SHAPE_MAX_VERTICES];
+} g_shape_pose;
+
+// Normals are only renormalized for non uniform scales. Circles take the
+// larger scale.
+void g_shape_orient(const g_shape *shape, float rotation, const vec2 scale,
+                    g_shape_pose *out);
+
+typedef struct {
+    bool intersection;
+    // Depth along normal, the axis of least overlap
+    float overlap;
+    // Unit length, pointing from the first shape towards the second
+    vec2 normal;
+} g_shape_contact;
+
+// Kernel testing b, offset from a, against a.
+typedef void (*g_shape_collide_fn)(const g_shape_pose *a,
+                                   const g_shape_pose *b, const vec2 offset,
+                                   g_shape_contact *contact);
+
+extern const g_shape_collide_fn g_shape_collide_table[G_SHAPE_KIND_COUNT]
+                                                     [G_SHAPE_KIND_COUNT];
+
+// Separating axis test of a against b, offset from a.
+static inline void g_shape_collide(const g_shape_pose *a,
+                                   const g_shape_pose *b, const vec2 offset,
+                                   g_shape_contact *contact) {
+    g_shape_collide_table[a->kind][b->kind](a, b, offset, contact);
+}
+
+#endif
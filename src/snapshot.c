@@ -0,0 +1,403 @@
+#include "snapshot.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const char g_snapshot_magic[8] = "CTRISNP";
+
+size_t g_world_snapshot_sections(g_world *world, g_snapshot_section *out) {
+    stable_index *index = &world->actors.actor_index;
+    g_actor_stack *actors = &world->actors;
+    const size_t capacity = index->capacity;
+
+    size_t n = 0;
+
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_INDEX_AVAILABLE,
+                                    index->available,
+                                    sizeof(stable_index_t) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_INDEX_GENERATIONS,
+                                    index->generations,
+                                    sizeof(stable_index_t) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_INDEX_MASKS, index->masks,
+                                    sizeof(stable_index_mask_t) * capacity};
+
+    for (size_t v = 0; v < index->view_size; v++) {
+        out[n++] = (g_snapshot_section){
+            G_SNAPSHOT_VIEW_INDICES + (uint32_t)v, index->views[v].indices,
+            sizeof(stable_index_t) * index->views[v].capacity};
+    }
+
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_COLORS, actors->colors,
+                                    sizeof(*actors->colors) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_TRANSFORMS,
+                                    actors->transforms,
+                                    sizeof(*actors->transforms) * capacity};
+    out[n++] = (g_snapshot_section){
+        G_SNAPSHOT_ACTOR_GLOBAL_TRANSFORMS, actors->global_transforms,
+        sizeof(*actors->global_transforms) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_VELOCITIES,
+                                    actors->velocities,
+                                    sizeof(*actors->velocities) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_DRAG, actors->drag,
+                                    sizeof(*actors->drag) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_MASS, actors->mass,
+                                    sizeof(*actors->mass) * capacity};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_ACTOR_SHAPES, actors->shapes,
+                                    sizeof(*actors->shapes) * capacity};
+
+    // Only rebuilt every few ticks, so part of the simulation state
+    g_flow_field *flow = &world->flow;
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FLOW_ORIGIN, flow->origin,
+                                    sizeof(flow->origin)};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FLOW_BUILT, &flow->built,
+                                    sizeof(flow->built)};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FLOW_DIRECTIONS,
+                                    flow->direction, sizeof(flow->direction)};
+
+    // Slot assignment depends on the order allies joined, the slot offsets
+    // are laid out again from the member count
+    g_formation *formation = &world->formation;
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FORMATION_MEMBERS,
+                                    formation->members,
+                                    sizeof(formation->members)};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FORMATION_COUNT,
+                                    &formation->member_count,
+                                    sizeof(formation->member_count)};
+    out[n++] = (g_snapshot_section){G_SNAPSHOT_FORMATION_SLOTS,
+                                    formation->slots,
+                                    sizeof(formation->slots)};
+
+    return n;
+}
+
+void g_world_snapshot_meta(const g_world *world, g_snapshot_meta *meta) {
+    const stable_index *index = &world->actors.actor_index;
+
+    memset(meta, 0, sizeof(*meta));
+
+    meta->capacity = index->capacity;
+    meta->available_size = index->availiable_size;
+    meta->view_count = index->view_size;
+    for (size_t v = 0; v < index->view_size && v < G_SNAPSHOT_MAX_VIEWS;
+         v++) {
+        meta->view_masks[v] = index->views[v].mask;
+        meta->view_sizes[v] = index->views[v].size;
+    }
+
+    meta->static_count = world->static_meshes.size;
+    meta->level = world->level;
+
+    meta->tick = world->tick;
+    meta->seed = world->seed;
+    meta->rng = world->rng;
+    meta->physics_tick = world->physics_tick;
+    meta->camera = world->camera;
+    meta->player = world->player;
+}
+
+bool g_world_snapshot_compatible(const g_world *world,
+                                 const g_snapshot_meta *meta) {
+    const stable_index *index = &world->actors.actor_index;
+
+    if (meta->capacity != index->capacity ||
+        meta->view_count != index->view_size ||
+        meta->view_count > G_SNAPSHOT_MAX_VIEWS) {
+        return false;
+    }
+
+    for (size_t v = 0; v < index->view_size; v++) {
+        if (meta->view_masks[v] != index->views[v].mask) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void g_world_snapshot_apply_meta(g_world *world, const g_snapshot_meta *meta) {
+    stable_index *index = &world->actors.actor_index;
+
+    index->availiable_size = meta->available_size;
+    for (size_t v = 0; v < index->view_size; v++) {
+        index->views[v].size = meta->view_sizes[v];
+    }
+
+    world->tick = meta->tick;
+    world->seed = meta->seed;
+    world->rng = meta->rng;
+    world->physics_tick = meta->physics_tick;
+    world->camera = meta->camera;
+    world->player = meta->player;
+
+    // Colliding with another level's walls would diverge, go without
+    if (memcmp(&world->level, &meta->level, sizeof(meta->level)) != 0) {
+        if (world->walls != NULL || meta->level.radius > 0.0f) {
+            printf("Restored state comes from another level, dropping its "
+                   "walls!\n");
+        }
+        world->walls = NULL;
+        memset(&world->level, 0, sizeof(world->level));
+    }
+}
+
+static bool write_section(FILE *file, g_snapshot_entry *entry,
+                          const void *data) {
+    static const uint8_t zeros[G_SNAPSHOT_ALIGN] = {0};
+
+    long pos = ftell(file);
+    size_t pad = (G_SNAPSHOT_ALIGN - pos % G_SNAPSHOT_ALIGN) % G_SNAPSHOT_ALIGN;
+
+    if (pad > 0 && fwrite(zeros, pad, 1, file) != 1) {
+        return false;
+    }
+
+    entry->offset = (uint64_t)pos + pad;
+    return entry->size == 0 || fwrite(data, entry->size, 1, file) == 1;
+}
+
+bool g_world_snapshot_save(g_world *world, const char *path) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "snapshot_save");
+
+    g_snapshot_section sections[G_SNAPSHOT_MAX_SECTIONS];
+    size_t count = g_world_snapshot_sections(world, sections);
+
+    g_snapshot_meta meta;
+    g_world_snapshot_meta(world, &meta);
+
+    g_static_meshes *meshes = &world->static_meshes;
+
+    // Sizes as fixed width integers
+    g_arena *scratch = g_scratch();
+    const size_t mark = scratch != NULL ? g_arena_mark(scratch) : 0;
+    uint64_t *static_sizes =
+        scratch != NULL
+            ? g_arena_push_array(scratch, uint64_t, meshes->size + 1)
+            : NULL;
+    if (static_sizes == NULL) {
+        printf("Couldn't allocate snapshot %s!\n", path);
+        G_TRACE_END(G_TRACE_SYSTEM, "snapshot_save");
+        return false;
+    }
+
+    // Meshes' vertices aren't contiguous, borrowed ones live in packs
+    const size_t vertices_size = sizeof(g_vertex) * meshes->vertex_count;
+    g_vertex *static_vertices =
+        g_alloc(world->allocator, G_ALLOC_TAG_OTHER, vertices_size,
+                alignof(g_vertex));
+    if (static_vertices == NULL) {
+        g_arena_rewind(scratch, mark);
+        G_TRACE_END(G_TRACE_SYSTEM, "snapshot_save");
+        return false;
+    }
+
+    size_t vertex_offset = 0;
+    for (size_t i = 0; i < meshes->size; i++) {
+        static_sizes[i] = meshes->sizes[i];
+
+        memcpy(&static_vertices[vertex_offset], meshes->vertices[i],
+               sizeof(g_vertex) * meshes->sizes[i]);
+        vertex_offset += meshes->sizes[i];
+    }
+
+    sections[count++] =
+        (g_snapshot_section){G_SNAPSHOT_META, &meta, sizeof(meta)};
+    sections[count++] = (g_snapshot_section){
+        G_SNAPSHOT_STATIC_TRANSFORMS, meshes->transforms,
+        sizeof(mat4) * meshes->size};
+    sections[count++] = (g_snapshot_section){
+        G_SNAPSHOT_STATIC_SIZES, static_sizes, sizeof(uint64_t) * meshes->size};
+    sections[count++] = (g_snapshot_section){
+        G_SNAPSHOT_STATIC_VERTICES, static_vertices, vertices_size};
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        printf("Couldn't open snapshot %s for writing!\n", path);
+        g_free(world->allocator, G_ALLOC_TAG_OTHER, static_vertices,
+               vertices_size, alignof(g_vertex));
+        g_arena_rewind(scratch, mark);
+        G_TRACE_END(G_TRACE_SYSTEM, "snapshot_save");
+        return false;
+    }
+
+    g_snapshot_header header = {
+        .version = G_SNAPSHOT_VERSION,
+        .section_count = (uint32_t)count,
+    };
+    memcpy(header.magic, g_snapshot_magic, sizeof(header.magic));
+
+    g_snapshot_entry entries[G_SNAPSHOT_MAX_SECTIONS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        entries[i].id = sections[i].id;
+        entries[i].size = sections[i].size;
+    }
+
+    // Write the table once to reserve it, then again with the offsets
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entries, sizeof(g_snapshot_entry), count, file) == count;
+
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = write_section(file, &entries[i], sections[i].data);
+    }
+
+    ok = ok && fseek(file, sizeof(header), SEEK_SET) == 0 &&
+         fwrite(entries, sizeof(g_snapshot_entry), count, file) == count;
+
+    ok = fclose(file) == 0 && ok;
+    g_free(world->allocator, G_ALLOC_TAG_OTHER, static_vertices, vertices_size,
+           alignof(g_vertex));
+    g_arena_rewind(scratch, mark);
+
+    if (!ok) {
+        printf("Couldn't write snapshot %s!\n", path);
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "snapshot_save");
+    return ok;
+}
+
+bool g_snapshot_open(g_snapshot_file *file, const char *path) {
+    if (!g_mapped_file_open(file, path)) {
+        return false;
+    }
+
+    const g_snapshot_header *header = (const g_snapshot_header *)file->data;
+
+    if (file->size < sizeof(*header) ||
+        memcmp(header->magic, g_snapshot_magic, sizeof(header->magic)) != 0 ||
+        header->version != G_SNAPSHOT_VERSION ||
+        file->size < sizeof(*header) + sizeof(g_snapshot_entry) *
+                                           header->section_count) {
+        printf("%s isn't a version %d snapshot!\n", path, G_SNAPSHOT_VERSION);
+        g_snapshot_close(file);
+        return false;
+    }
+
+    return true;
+}
+
+void g_snapshot_close(g_snapshot_file *file) { g_mapped_file_close(file); }
+
+const void *g_snapshot_find(const g_snapshot_file *file, uint32_t id,
+                            size_t *size) {
+    const g_snapshot_header *header = (const g_snapshot_header *)file->data;
+    const g_snapshot_entry *entries =
+        (const g_snapshot_entry *)(file->data + sizeof(*header));
+
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        if (entries[i].id != id) {
+            continue;
+        }
+
+        // Either can be anything in a damaged file, so no sums
+        if (entries[i].size > file->size ||
+            entries[i].offset > file->size - entries[i].size) {
+            return NULL;
+        }
+
+        *size = entries[i].size;
+        return file->data + entries[i].offset;
+    }
+
+    return NULL;
+}
+
+bool g_world_snapshot_load(g_world *world, const char *path) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "snapshot_load");
+
+    g_snapshot_file file;
+    if (!g_snapshot_open(&file, path)) {
+        G_TRACE_END(G_TRACE_SYSTEM, "snapshot_load");
+        return false;
+    }
+
+    size_t size;
+    const g_snapshot_meta *meta =
+        g_snapshot_find(&file, G_SNAPSHOT_META, &size);
+
+    if (meta == NULL || size != sizeof(*meta) ||
+        !g_world_snapshot_compatible(world, meta)) {
+        printf("Snapshot %s doesn't match this world's layout!\n", path);
+        g_snapshot_close(&file);
+        G_TRACE_END(G_TRACE_SYSTEM, "snapshot_load");
+        return false;
+    }
+
+    // Validate every section before touching the world
+    g_snapshot_section sections[G_SNAPSHOT_MAX_SECTIONS];
+    const size_t count = g_world_snapshot_sections(world, sections);
+    const void *sources[G_SNAPSHOT_MAX_SECTIONS];
+
+    for (size_t i = 0; i < count; i++) {
+        sources[i] = g_snapshot_find(&file, sections[i].id, &size);
+
+        if (sources[i] == NULL || size != sections[i].size) {
+            printf("Snapshot %s is missing section %u!\n", path,
+                   sections[i].id);
+            g_snapshot_close(&file);
+            G_TRACE_END(G_TRACE_SYSTEM, "snapshot_load");
+            return false;
+        }
+
+        // Shapes index the registry, which may hold fewer than when saved
+        if (sections[i].id == G_SNAPSHOT_ACTOR_SHAPES) {
+            const g_shape_id *shapes = sources[i];
+
+            for (size_t s = 0; s < size / sizeof(*shapes); s++) {
+                if (shapes[s] >= g_shapes.count) {
+                    printf("Snapshot %s uses unregistered shape %u!\n", path,
+                           shapes[s]);
+                    g_snapshot_close(&file);
+                    G_TRACE_END(G_TRACE_SYSTEM, "snapshot_load");
+                    return false;
+                }
+            }
+        }
+    }
+
+    size_t transforms_size, sizes_size, vertices_size;
+    const mat4 *static_transforms = g_snapshot_find(
+        &file, G_SNAPSHOT_STATIC_TRANSFORMS, &transforms_size);
+    const uint64_t *static_sizes =
+        g_snapshot_find(&file, G_SNAPSHOT_STATIC_SIZES, &sizes_size);
+    const g_vertex *static_vertices =
+        g_snapshot_find(&file, G_SNAPSHOT_STATIC_VERTICES, &vertices_size);
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(sections[i].data, sources[i], sections[i].size);
+    }
+
+    g_world_snapshot_apply_meta(world, meta);
+
+    // Transient state isn't part of the snapshot
+    g_projectiles_init(&world->projectiles);
+    g_particles_init(&world->particles, g_world_particle_seed(world->seed));
+
+    g_static_meshes_clear(&world->static_meshes);
+
+    if (static_transforms != NULL && static_sizes != NULL &&
+        static_vertices != NULL) {
+        const size_t static_count = transforms_size / sizeof(mat4);
+        const size_t vertex_count = vertices_size / sizeof(g_vertex);
+        size_t offset = 0;
+
+        for (size_t i = 0; i < static_count &&
+                           i < sizes_size / sizeof(uint64_t) &&
+                           offset + static_sizes[i] <= vertex_count;
+             i++) {
+            mat4 transform;
+            glm_mat4_copy((vec4 *)static_transforms[i], transform);
+
+            g_static_meshes_add(&world->static_meshes, transform,
+                                &static_vertices[offset], static_sizes[i]);
+            offset += static_sizes[i];
+        }
+    }
+
+    g_snapshot_close(&file);
+
+    G_TRACE_END(G_TRACE_SYSTEM, "snapshot_load");
+    return true;
+}
@@ -0,0 +1,115 @@
+// Flat, versioned binary snapshots of a g_world, laid out to be mmap'ed.
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "mapfile.h"
+#include "world.h"
+
+#define G_SNAPSHOT_VERSION 5
+// Every section starts on this boundary, relative to the file start.
+#define G_SNAPSHOT_ALIGN 64
+#define G_SNAPSHOT_MAX_VIEWS 8
+#define G_SNAPSHOT_MAX_SECTIONS 32
+
+enum g_snapshot_section_id : uint32_t {
+    G_SNAPSHOT_META,
+    G_SNAPSHOT_INDEX_AVAILABLE,
+    G_SNAPSHOT_INDEX_GENERATIONS,
+    G_SNAPSHOT_INDEX_MASKS,
+    G_SNAPSHOT_ACTOR_COLORS,
+    G_SNAPSHOT_ACTOR_TRANSFORMS,
+    G_SNAPSHOT_ACTOR_GLOBAL_TRANSFORMS,
+    G_SNAPSHOT_ACTOR_VELOCITIES,
+    G_SNAPSHOT_ACTOR_DRAG,
+    G_SNAPSHOT_ACTOR_MASS,
+    // Ids into the process global g_shapes, filled in registration order, so
+    // they only mean the same shape within one process. Loads reject ids
+    // that aren't registered.
+    G_SNAPSHOT_ACTOR_SHAPES,
+    G_SNAPSHOT_STATIC_TRANSFORMS,
+    G_SNAPSHOT_STATIC_SIZES,
+    G_SNAPSHOT_STATIC_VERTICES,
+    G_SNAPSHOT_FLOW_ORIGIN,
+    G_SNAPSHOT_FLOW_BUILT,
+    G_SNAPSHOT_FLOW_DIRECTIONS,
+    G_SNAPSHOT_FORMATION_MEMBERS,
+    G_SNAPSHOT_FORMATION_COUNT,
+    G_SNAPSHOT_FORMATION_SLOTS,
+    // One section per view, G_SNAPSHOT_VIEW_INDICES + view
+    G_SNAPSHOT_VIEW_INDICES,
+};
+
+// Everything that isn't a plain array.
+typedef struct {
+    uint64_t capacity;
+    uint64_t available_size;
+    uint64_t view_count;
+    stable_index_mask_t view_masks[G_SNAPSHOT_MAX_VIEWS];
+    stable_index_t view_sizes[G_SNAPSHOT_MAX_VIEWS];
+
+    uint64_t static_count;
+    // Generated level the walls came from, zeroed without walls. Walls
+    // aren't stored, they only come back if the world is in that level.
+    g_level_params level;
+
+    uint64_t tick;
+    uint64_t seed;
+    g_rng rng;
+    float physics_tick;
+
+    g_camera camera;
+    g_player player;
+} g_snapshot_meta;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t section_count;
+} g_snapshot_header;
+
+// Follows the header, one per section.
+typedef struct {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+} g_snapshot_entry;
+
+// A section of live world memory.
+typedef struct {
+    uint32_t id;
+    void *data;
+    size_t size;
+} g_snapshot_section;
+
+// A snapshot file, mapped read-only where mmap is available.
+typedef g_mapped_file g_snapshot_file;
+
+// Fill out with the fixed size simulation state arrays of world (stable index,
+// actor SoA arrays, flow field and formation), returns the section count.
+size_t g_world_snapshot_sections(g_world *world, g_snapshot_section *out);
+
+void g_world_snapshot_meta(const g_world *world, g_snapshot_meta *meta);
+
+// Check meta against world's layout (capacity, views).
+bool g_world_snapshot_compatible(const g_world *world,
+                                 const g_snapshot_meta *meta);
+
+// Apply meta, keeping the view indices arrays as they are. world's walls are
+// dropped unless meta comes from the same generated level.
+void g_world_snapshot_apply_meta(g_world *world, const g_snapshot_meta *meta);
+
+bool g_world_snapshot_save(g_world *world, const char *path);
+
+bool g_snapshot_open(g_snapshot_file *file, const char *path);
+void g_snapshot_close(g_snapshot_file *file);
+
+// Pointer to a section inside the file, or NULL.
+const void *g_snapshot_find(const g_snapshot_file *file, uint32_t id,
+                            size_t *size);
+
+// Load a snapshot into an initialized world. Static meshes are rebuilt,
+// projectiles and particles are cleared.
+bool g_world_snapshot_load(g_world *world, const char *path);
+
+#endif
@@ -0,0 +1,629 @@
+#include "spatial.h"
+#include "arena.h"
+#include "trace.h"
+
+#include <string.h>
+
+// Actors spanning more cells than this (per axis) are clamped, keep the cell
+// size above the largest actor.
+#define G_GRID_MAX_SPAN 4
+
+static inline uint32_t cell_hash(int32_t x, int32_t y) {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u) &
+           (G_GRID_BUCKETS - 1);
+}
+
+static inline void cell_range(const g_actor_grid *grid, vec2 aabb[2],
+                              int32_t range[4]) {
+    range[0] = (int32_t)floorf(aabb[0][0] * grid->inv_cell_size);
+    range[1] = (int32_t)floorf(aabb[0][1] * grid->inv_cell_size);
+    range[2] = (int32_t)floorf(aabb[1][0] * grid->inv_cell_size);
+    range[3] = (int32_t)floorf(aabb[1][1] * grid->inv_cell_size);
+}
+
+void g_actor_grid_init(g_actor_grid *grid, float cell_size) {
+    grid->cell_size = cell_size;
+    grid->inv_cell_size = 1.0f / cell_size;
+    grid->entry_count = 0;
+    grid->stamp = 0;
+    glm_aabb2d_invalidate(grid->bounds);
+
+    memset(grid->bucket_start, 0, sizeof(grid->bucket_start));
+    memset(grid->stamps, 0, sizeof(grid->stamps));
+}
+
+void g_actor_grid_build(g_actor_grid *grid, const g_actor_stack *stack) {
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "grid_build");
+
+    const stable_index_view *alive = stack->alive_view;
+
+    memset(grid->bucket_start, 0, sizeof(grid->bucket_start));
+    glm_aabb2d_invalidate(grid->bounds);
+
+    // Count the entries of every bucket
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+
+        const g_transform *transform = &stack->transforms[idx];
+        g_shape_pose *pose = &grid->poses[idx];
+        float *position = grid->positions[idx];
+        vec2 *aabb = grid->aabbs[idx];
+
+        g_shape_orient(g_shape_get(stack->shapes[idx]), transform->rotation,
+                       transform->scale, pose);
+        glm_vec2_copy((float *)transform->position, position);
+
+        if (pose->kind == G_SHAPE_KIND_CIRCLE) {
+            glm_vec2_subs(position, pose->radius, aabb[0]);
+            glm_vec2_adds(position, pose->radius, aabb[1]);
+        } else {
+            glm_aabb2d_invalidate(aabb);
+            for (uint32_t k = 0; k < pose->vertex_count; k++) {
+                glm_vec2_minv(aabb[0], pose->vertices[k], aabb[0]);
+                glm_vec2_maxv(aabb[1], pose->vertices[k], aabb[1]);
+            }
+            glm_vec2_add(aabb[0], position, aabb[0]);
+            glm_vec2_add(aabb[1], position, aabb[1]);
+        }
+        glm_vec2_minv(grid->bounds[0], aabb[0], grid->bounds[0]);
+        glm_vec2_maxv(grid->bounds[1], aabb[1], grid->bounds[1]);
+
+        int32_t r[4];
+        cell_range(grid, aabb, r);
+        r[2] = min(r[2], r[0] + G_GRID_MAX_SPAN - 1);
+        r[3] = min(r[3], r[1] + G_GRID_MAX_SPAN - 1);
+
+        for (int32_t y = r[1]; y <= r[3]; y++) {
+            for (int32_t x = r[0]; x <= r[2]; x++) {
+                grid->bucket_start[cell_hash(x, y)]++;
+            }
+        }
+    }
+
+    // Inclusive prefix sum, every bucket now points at its end
+    uint32_t total = 0;
+    for (size_t b = 0; b < G_GRID_BUCKETS; b++) {
+        total += grid->bucket_start[b];
+        grid->bucket_start[b] = total;
+    }
+    grid->bucket_start[G_GRID_BUCKETS] = total;
+    grid->entry_count = total;
+
+    // Fill backwards, leaving every bucket pointing at its start
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+
+        int32_t r[4];
+        cell_range(grid, grid->aabbs[idx], r);
+        r[2] = min(r[2], r[0] + G_GRID_MAX_SPAN - 1);
+        r[3] = min(r[3], r[1] + G_GRID_MAX_SPAN - 1);
+
+        for (int32_t y = r[1]; y <= r[3]; y++) {
+            for (int32_t x = r[0]; x <= r[2]; x++) {
+                grid->entries[--grid->bucket_start[cell_hash(x, y)]] = idx;
+            }
+        }
+    }
+
+    G_TRACE_END(G_TRACE_SYSTEM, "grid_build");
+}
+
+static inline size_t query_bucket(g_actor_grid *grid, uint32_t bucket,
+                                  vec2 rect[2], stable_index_t *out,
+                                  size_t count, size_t max) {
+    const uint32_t end = grid->bucket_start[bucket + 1];
+
+    for (uint32_t e = grid->bucket_start[bucket]; e < end && count < max;
+         e++) {
+        const stable_index_t idx = grid->entries[e];
+
+        if (grid->stamps[idx] == grid->stamp) {
+            continue;
+        }
+        grid->stamps[idx] = grid->stamp;
+
+        // Hashed buckets are shared between distant cells
+        if (glm_aabb2d_aabb(grid->aabbs[idx], rect)) {
+            out[count++] = idx;
+        }
+    }
+
+    return count;
+}
+
+size_t g_actor_grid_query_rect(g_actor_grid *grid, vec2 rect[2],
+                               stable_index_t *out, size_t max) {
+    if (++grid->stamp == 0) {
+        memset(grid->stamps, 0, sizeof(grid->stamps));
+        grid->stamp = 1;
+    }
+
+    int32_t r[4];
+    cell_range(grid, rect, r);
+
+    const int64_t cells =
+        ((int64_t)r[2] - r[0] + 1) * ((int64_t)r[3] - r[1] + 1);
+
+    size_t count = 0;
+
+    // Big rects touch every bucket anyway
+    if (cells >= (int64_t)G_GRID_BUCKETS) {
+        for (uint32_t b = 0; b < G_GRID_BUCKETS && count < max; b++) {
+            count = query_bucket(grid, b, rect, out, count, max);
+        }
+        return count;
+    }
+
+    for (int32_t y = r[1]; y <= r[3] && count < max; y++) {
+        for (int32_t x = r[0]; x <= r[2] && count < max; x++) {
+            count = query_bucket(grid, cell_hash(x, y), rect, out, count, max);
+        }
+    }
+
+    return count;
+}
+
+// Slots of a g_visited before it moves to the scratch arena
+#define G_VISITED_INLINE 256
+
+// Actors already considered by one query, replaces the grid's stamps so
+// queries don't write to the grid. An open addressed set of idx + 1 that
+// doubles into the calling thread's scratch arena as it fills, so a query
+// costs as much as its candidates rather than the actor capacity.
+typedef struct {
+    stable_index_t *slots;
+    uint32_t mask;
+    uint32_t count;
+
+    g_arena *scratch;
+    size_t mark;
+
+    stable_index_t inline_slots[G_VISITED_INLINE];
+} g_visited;
+
+static inline void g_visited_init(g_visited *visited) {
+    memset(visited->inline_slots, 0, sizeof(visited->inline_slots));
+    visited->slots = visited->inline_slots;
+    visited->mask = G_VISITED_INLINE - 1;
+    visited->count = 0;
+    visited->scratch = NULL;
+}
+
+// Drop the scratch tables, if any.
+static inline void g_visited_release(g_visited *visited) {
+    if (visited->scratch != NULL) {
+        g_arena_rewind(visited->scratch, visited->mark);
+    }
+}
+
+static inline uint32_t g_visited_slot(uint32_t mask, stable_index_t idx) {
+    return (idx * 2654435761u) & mask;
+}
+
+// Double the table, staying in the current one if that fails. No more than
+// MAX_G_ACTORS indices are ever added, so it never needs to grow past that.
+static void g_visited_grow(g_visited *visited) {
+    const uint32_t size = (visited->mask + 1) * 2;
+    if (size > 2 * MAX_G_ACTORS) {
+        return;
+    }
+
+    if (visited->scratch == NULL) {
+        visited->scratch = g_scratch();
+        if (visited->scratch == NULL) {
+            return;
+        }
+        visited->mark = g_arena_mark(visited->scratch);
+    }
+
+    stable_index_t *slots =
+        g_arena_push_array(visited->scratch, stable_index_t, size);
+    if (slots == NULL) {
+        return;
+    }
+    memset(slots, 0, sizeof(stable_index_t) * size);
+
+    for (uint32_t i = 0; i <= visited->mask; i++) {
+        const stable_index_t value = visited->slots[i];
+        if (value == 0) {
+            continue;
+        }
+
+        uint32_t slot = g_visited_slot(size - 1, value - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        slots[slot] = value;
+    }
+
+    visited->slots = slots;
+    visited->mask = size - 1;
+}
+
+// Whether idx is seen for the first time, marking it.
+static inline bool g_visit(g_visited *visited, stable_index_t idx) {
+    if (visited->count * 2 > visited->mask) {
+        g_visited_grow(visited);
+    }
+
+    uint32_t slot = g_visited_slot(visited->mask, idx);
+    for (uint32_t probes = 0; probes <= visited->mask; probes++) {
+        if (visited->slots[slot] == idx + 1) {
+            return false;
+        }
+        if (visited->slots[slot] == 0) {
+            visited->slots[slot] = idx + 1;
+            visited->count++;
+            return true;
+        }
+        slot = (slot + 1) & visited->mask;
+    }
+
+    // Full and out of scratch, the candidate may come up twice
+    return true;
+}
+
+static inline bool circle_aabb(const vec2 center, float radius2,
+                               const vec2 aabb[2]) {
+    const float dx = center[0] - glm_clamp(center[0], aabb[0][0], aabb[1][0]);
+    const float dy = center[1] - glm_clamp(center[1], aabb[0][1], aabb[1][1]);
+    return dx * dx + dy * dy <= radius2;
+}
+
+static inline size_t circle_bucket(const g_actor_grid *grid,
+                                   const g_actor_stack *stack,
+                                   g_visited *visited, uint32_t bucket,
+                                   const vec2 center, float radius2,
+                                   stable_index_mask_t mask,
+                                   stable_index_t *out, size_t count,
+                                   size_t max) {
+    const stable_index_mask_t *masks = stack->actor_index.masks;
+    const uint32_t end = grid->bucket_start[bucket + 1];
+
+    for (uint32_t e = grid->bucket_start[bucket]; e < end && count < max;
+         e++) {
+        const stable_index_t idx = grid->entries[e];
+
+        if (g_visit(visited, idx) &&
+            stable_index_mask_contains(masks[idx], mask) &&
+            circle_aabb(center, radius2, grid->aabbs[idx])) {
+            out[count++] = idx;
+        }
+    }
+
+    return count;
+}
+
+size_t g_actor_grid_query_circle(const g_actor_grid *grid,
+                                 const g_actor_stack *stack,
+                                 const vec2 center, float radius,
+                                 stable_index_mask_t mask,
+                                 stable_index_t *out, size_t max) {
+    g_visited visited;
+    g_visited_init(&visited);
+    const float radius2 = radius * radius;
+
+    vec2 rect[2] = {
+        {center[0] - radius, center[1] - radius},
+        {center[0] + radius, center[1] + radius},
+    };
+
+    int32_t r[4];
+    cell_range(grid, rect, r);
+
+    const int64_t cells =
+        ((int64_t)r[2] - r[0] + 1) * ((int64_t)r[3] - r[1] + 1);
+
+    size_t count = 0;
+
+    // Big circles touch every bucket anyway
+    if (cells >= (int64_t)G_GRID_BUCKETS) {
+        for (uint32_t b = 0; b < G_GRID_BUCKETS && count < max; b++) {
+            count = circle_bucket(grid, stack, &visited, b, center, radius2,
+                                  mask, out, count, max);
+        }
+        g_visited_release(&visited);
+        return count;
+    }
+
+    for (int32_t y = r[1]; y <= r[3] && count < max; y++) {
+        for (int32_t x = r[0]; x <= r[2] && count < max; x++) {
+            count = circle_bucket(grid, stack, &visited, cell_hash(x, y),
+                                  center, radius2, mask, out, count, max);
+        }
+    }
+
+    g_visited_release(&visited);
+    return count;
+}
+
+// Insert idx into the sorted k nearest, if it's closer than the farthest.
+static inline size_t nearest_insert(stable_index_t *out, float *distance2,
+                                    size_t count, size_t k,
+                                    stable_index_t idx, float d2) {
+    if (count == k && d2 >= distance2[count - 1]) {
+        return count;
+    }
+
+    size_t i = count < k ? count++ : count - 1;
+    for (; i > 0 && distance2[i - 1] > d2; i--) {
+        out[i] = out[i - 1];
+        distance2[i] = distance2[i - 1];
+    }
+    out[i] = idx;
+    distance2[i] = d2;
+
+    return count;
+}
+
+size_t g_actor_grid_query_nearest(const g_actor_grid *grid,
+                                  const g_actor_stack *stack,
+                                  const vec2 center, size_t k,
+                                  float max_distance,
+                                  stable_index_mask_t mask,
+                                  stable_index_t *out) {
+    k = min(k, G_GRID_MAX_NEAREST);
+    if (k == 0 || grid->entry_count == 0) {
+        return 0;
+    }
+
+    const stable_index_mask_t *masks = stack->actor_index.masks;
+
+    g_visited visited;
+    g_visited_init(&visited);
+    float distance2[G_GRID_MAX_NEAREST];
+    size_t count = 0;
+
+    const float max_distance2 = max_distance * max_distance;
+    const int32_t cx = (int32_t)floorf(center[0] * grid->inv_cell_size);
+    const int32_t cy = (int32_t)floorf(center[1] * grid->inv_cell_size);
+
+    // Nothing lies past the farthest corner of the bounds, which also keeps
+    // huge or infinite distances from overflowing the ring count
+    const float far_x = glm_max(fabsf(center[0] - grid->bounds[0][0]),
+                                fabsf(center[0] - grid->bounds[1][0]));
+    const float far_y = glm_max(fabsf(center[1] - grid->bounds[0][1]),
+                                fabsf(center[1] - grid->bounds[1][1]));
+    const float reach =
+        glm_min(max_distance, sqrtf(far_x * far_x + far_y * far_y));
+
+    // Rings of cells around the center's, every actor is in the cell of its
+    // position. Nothing in ring n is closer than n - 1 cells.
+    const int32_t rings = (int32_t)(reach * grid->inv_cell_size) + 2;
+    for (int32_t n = 0; n < rings; n++) {
+        const float bound = (n - 1) * grid->cell_size;
+        if (n > 1 && count == k && bound * bound > distance2[count - 1]) {
+            break;
+        }
+
+        for (int32_t y = cy - n; y <= cy + n; y++) {
+            // Only the first and last column of the middle rows
+            const int32_t step = (y == cy - n || y == cy + n) ? 1 : 2 * n;
+
+            for (int32_t x = cx - n; x <= cx + n; x += max(step, 1)) {
+                const uint32_t bucket = cell_hash(x, y);
+                const uint32_t end = grid->bucket_start[bucket + 1];
+
+                for (uint32_t e = grid->bucket_start[bucket]; e < end; e++) {
+                    const stable_index_t idx = grid->entries[e];
+
+                    if (!g_visit(&visited, idx) ||
+                        !stable_index_mask_contains(masks[idx], mask)) {
+                        continue;
+                    }
+
+                    const float *position = stack->transforms[idx].position;
+                    const float dx = position[0] - center[0];
+                    const float dy = position[1] - center[1];
+                    const float d2 = dx * dx + dy * dy;
+
+                    if (d2 <= max_distance2) {
+                        count = nearest_insert(out, distance2, count, k, idx,
+                                               d2);
+                    }
+                }
+            }
+        }
+    }
+
+    g_visited_release(&visited);
+    return count;
+}
+
+// Intersect the segment p + t * d, t in [0, 1], with a circle around the
+// origin. On a hit, t is the entry time and normal the outward normal there,
+// or zero if the segment starts inside.
+static bool segment_circle(const vec2 p, const vec2 d, float radius, float *t,
+                           vec2 normal) {
+    const float c = glm_vec2_dot((float *)p, (float *)p) - radius * radius;
+    glm_vec2_zero(normal);
+
+    if (c <= 0.0f) {
+        *t = 0.0f;
+        return true;
+    }
+
+    const float a = glm_vec2_dot((float *)d, (float *)d);
+    const float b = glm_vec2_dot((float *)p, (float *)d);
+    const float disc = b * b - a * c;
+
+    // Outside and moving away, or missing it
+    if (a == 0.0f || b >= 0.0f || disc < 0.0f) {
+        return false;
+    }
+
+    const float te = (-b - sqrtf(disc)) / a;
+    if (te > 1.0f) {
+        return false;
+    }
+
+    *t = te;
+    normal[0] = p[0] + te * d[0];
+    normal[1] = p[1] + te * d[1];
+    return true;
+}
+
+// Clip the segment p + t * d, t in [0, 1], against a shape around the origin
+// (Cyrus-Beck for polygons). On a hit, t is the entry time and normal the
+// (unnormalized) entry normal, or zero if the segment starts inside.
+static bool segment_pose(const vec2 p, const vec2 d, const g_shape_pose *pose,
+                         float *t, vec2 normal) {
+    if (pose->kind == G_SHAPE_KIND_CIRCLE) {
+        return segment_circle(p, d, pose->radius, t, normal);
+    }
+
+    float t_enter = 0.0f;
+    float t_exit = 1.0f;
+    glm_vec2_zero(normal);
+
+    // Pose normals stay outward for mirrored shapes too
+    for (uint32_t i = 0; i < pose->vertex_count; i++) {
+        const float *n = pose->normals[i];
+        const float *v = pose->vertices[i];
+
+        const float num = n[0] * (v[0] - p[0]) + n[1] * (v[1] - p[1]);
+        const float den = n[0] * d[0] + n[1] * d[1];
+
+        if (den == 0.0f) {
+            // Parallel to the edge and outside of it
+            if (num < 0.0f) {
+                return false;
+            }
+            continue;
+        }
+
+        const float te = num / den;
+
+        if (den < 0.0f) {
+            if (te > t_enter) {
+                t_enter = te;
+                glm_vec2_copy((float *)n, normal);
+            }
+        } else {
+            t_exit = glm_min(t_exit, te);
+        }
+
+        if (t_enter > t_exit) {
+            return false;
+        }
+    }
+
+    *t = t_enter;
+    return true;
+}
+
+bool g_actor_grid_raycast(const g_actor_grid *grid,
+                          const g_actor_stack *stack, const vec2 origin,
+                          const vec2 delta, stable_index_mask_t ignore,
+                          g_actor_ray_hit *hit) {
+    const stable_index_mask_t *masks = stack->actor_index.masks;
+
+    g_visited visited;
+    g_visited_init(&visited);
+    float best_t = FLT_MAX;
+    vec2 best_normal = GLM_VEC2_ZERO_INIT;
+
+    // Walk the cells along the segment (Amanatides-Woo), t in segment units
+    int32_t x = (int32_t)floorf(origin[0] * grid->inv_cell_size);
+    int32_t y = (int32_t)floorf(origin[1] * grid->inv_cell_size);
+
+    const int32_t step_x = delta[0] > 0.0f ? 1 : -1;
+    const int32_t step_y = delta[1] > 0.0f ? 1 : -1;
+
+    const float delta_x =
+        delta[0] != 0.0f ? grid->cell_size / fabsf(delta[0]) : FLT_MAX;
+    const float delta_y =
+        delta[1] != 0.0f ? grid->cell_size / fabsf(delta[1]) : FLT_MAX;
+
+    float next_x = delta[0] != 0.0f
+                       ? ((x + (step_x > 0)) * grid->cell_size - origin[0]) /
+                             delta[0]
+                       : FLT_MAX;
+    float next_y = delta[1] != 0.0f
+                       ? ((y + (step_y > 0)) * grid->cell_size - origin[1]) /
+                             delta[1]
+                       : FLT_MAX;
+
+    for (;;) {
+        const uint32_t bucket = cell_hash(x, y);
+        const uint32_t end = grid->bucket_start[bucket + 1];
+
+        for (uint32_t e = grid->bucket_start[bucket]; e < end; e++) {
+            const stable_index_t idx = grid->entries[e];
+
+            if (!g_visit(&visited, idx) || (masks[idx] & ignore)) {
+                continue;
+            }
+
+            const float *position = grid->positions[idx];
+            const vec2 local = {origin[0] - position[0],
+                                origin[1] - position[1]};
+
+            float t;
+            vec2 normal;
+            if (segment_pose(local, delta, &grid->poses[idx], &t, normal) &&
+                t < best_t) {
+                best_t = t;
+                hit->actor = idx;
+                glm_vec2_copy(normal, best_normal);
+            }
+        }
+
+        // Hits inside this cell can't be beaten by later cells
+        const float exit = glm_min(next_x, next_y);
+        if (best_t <= exit || exit >= 1.0f) {
+            break;
+        }
+
+        if (next_x < next_y) {
+            x += step_x;
+            next_x += delta_x;
+        } else {
+            y += step_y;
+            next_y += delta_y;
+        }
+    }
+
+    g_visited_release(&visited);
+
+    if (best_t == FLT_MAX) {
+        return false;
+    }
+
+    hit->t = best_t;
+    glm_vec2_copy((vec2){origin[0], origin[1]}, hit->point);
+    glm_vec2_muladds((vec2){delta[0], delta[1]}, best_t, hit->point);
+    glm_vec2_normalize_to(best_normal, hit->normal);
+
+    return true;
+}
+
+void g_actor_grid_query_batch(const g_actor_grid *grid,
+                              const g_actor_stack *stack,
+                              g_actor_query *queries, size_t begin,
+                              size_t end) {
+    G_TRACE_BEGIN(G_TRACE_DETAIL, "actor_query_batch");
+
+    for (size_t i = begin; i < end; i++) {
+        g_actor_query *q = &queries[i];
+
+        switch (q->type) {
+        case G_ACTOR_QUERY_CIRCLE:
+            q->count = g_actor_grid_query_circle(grid, stack, q->origin,
+                                                 q->radius, q->mask, q->out,
+                                                 q->max);
+            break;
+        case G_ACTOR_QUERY_NEAREST:
+            q->count = g_actor_grid_query_nearest(grid, stack, q->origin,
+                                                  q->max, q->radius, q->mask,
+                                                  q->out);
+            break;
+        case G_ACTOR_QUERY_RAYCAST:
+            q->count = g_actor_grid_raycast(grid, stack, q->origin, q->delta,
+                                            q->mask, &q->hit);
+            break;
+        }
+    }
+
+    G_TRACE_END(G_TRACE_DETAIL, "actor_query_batch");
+}
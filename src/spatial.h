@@ -0,0 +1,115 @@
+// Uniform hash grid over the alive actors, rebuilt once per fixed tick, and
+// the gameplay queries answered from it.
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "common.h"
+
+// Must be a power of two
+#define G_GRID_BUCKETS (size_t)4096
+#define G_GRID_MAX_ENTRIES (MAX_G_ACTORS * 16)
+// Most results of one g_actor_grid_query_nearest
+#define G_GRID_MAX_NEAREST (size_t)32
+
+typedef struct g_actor_grid {
+    float cell_size;
+    float inv_cell_size;
+
+    // Oriented shape, position and world space bounds of every indexed actor,
+    // by actor index.
+    g_shape_pose poses[MAX_G_ACTORS];
+    vec2 positions[MAX_G_ACTORS];
+    vec2 aabbs[MAX_G_ACTORS][2];
+    // Around every aabb, invalid when empty
+    vec2 bounds[2];
+
+    // Bucket b holds entries[bucket_start[b]..bucket_start[b + 1]]
+    uint32_t bucket_start[G_GRID_BUCKETS + 1];
+    stable_index_t entries[G_GRID_MAX_ENTRIES];
+    size_t entry_count;
+
+    // Query stamps, used to report an actor spanning several cells once.
+    uint32_t stamps[MAX_G_ACTORS];
+    uint32_t stamp;
+} g_actor_grid;
+
+void g_actor_grid_init(g_actor_grid *grid, float cell_size);
+
+// Rebuild the grid from the alive actors' current (fixed tick) transforms.
+void g_actor_grid_build(g_actor_grid *grid, const g_actor_stack *stack);
+
+// Collect up to max actors whose bounds overlap rect, returns the count.
+size_t g_actor_grid_query_rect(g_actor_grid *grid, vec2 rect[2],
+                               stable_index_t *out, size_t max);
+
+// The queries below only read the grid, so any number of them may run at
+// once, including from several threads.
+
+// Collect up to max actors whose bounds overlap the circle and whose mask
+// contains mask, returns the count.
+size_t g_actor_grid_query_circle(const g_actor_grid *grid,
+                                 const g_actor_stack *stack,
+                                 const vec2 center, float radius,
+                                 stable_index_mask_t mask,
+                                 stable_index_t *out, size_t max);
+
+// Collect the k (at most G_GRID_MAX_NEAREST) actors whose position is
+// closest to center, within max_distance and whose mask contains mask.
+// Sorted nearest first, returns the count.
+size_t g_actor_grid_query_nearest(const g_actor_grid *grid,
+                                  const g_actor_stack *stack,
+                                  const vec2 center, size_t k,
+                                  float max_distance,
+                                  stable_index_mask_t mask,
+                                  stable_index_t *out);
+
+typedef struct {
+    stable_index_t actor;
+    // Along the segment, in [0, 1]
+    float t;
+    vec2 point;
+    // Entry edge's outward unit normal, zero if the segment starts inside
+    vec2 normal;
+} g_actor_ray_hit;
+
+// First actor shape hit by the segment origin + t * delta, t in [0, 1],
+// skipping actors with any of the ignore mask bits.
+bool g_actor_grid_raycast(const g_actor_grid *grid,
+                          const g_actor_stack *stack, const vec2 origin,
+                          const vec2 delta, stable_index_mask_t ignore,
+                          g_actor_ray_hit *hit);
+
+enum g_actor_query_type : uint8_t {
+    G_ACTOR_QUERY_CIRCLE,
+    G_ACTOR_QUERY_NEAREST,
+    G_ACTOR_QUERY_RAYCAST,
+};
+
+// One query of a batch, see the functions above for the parameters.
+typedef struct {
+    enum g_actor_query_type type;
+    // Required bits for circles and nearest, ignored bits for raycasts
+    stable_index_mask_t mask;
+    vec2 origin;
+    // Circle radius or nearest max distance
+    float radius;
+    // Raycast segment
+    vec2 delta;
+
+    // Circle and nearest results, up to max (the k of nearest)
+    stable_index_t *out;
+    size_t max;
+    size_t count;
+
+    // Raycast result, count is 1 on a hit
+    g_actor_ray_hit hit;
+} g_actor_query;
+
+// Run queries [begin, end) of a batch. Disjoint ranges of one batch can be
+// handed to different threads.
+void g_actor_grid_query_batch(const g_actor_grid *grid,
+                              const g_actor_stack *stack,
+                              g_actor_query *queries, size_t begin,
+                              size_t end);
+
+#endif
@@ -0,0 +1,242 @@
+#include "telemetry.h"
+
+#include <sokol/sokol_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const g_telemetry_series_names[G_TELEMETRY_SERIES_COUNT] = {
+    [G_TELEMETRY_FRAME] = "frame_ms",
+    [G_TELEMETRY_WORLD_UPDATE] = "world_update_ms",
+    [G_TELEMETRY_PHYSICS] = "physics_ms",
+    [G_TELEMETRY_TRANSFORM] = "transform_ms",
+    [G_TELEMETRY_DRAW] = "draw_ms",
+    [G_TELEMETRY_ALIVE] = "alive",
+    [G_TELEMETRY_PAIRS_TESTED] = "pairs_tested",
+    [G_TELEMETRY_CONTACTS] = "contacts",
+    [G_TELEMETRY_DRAW_CALLS] = "draw_calls",
+    [G_TELEMETRY_HEAP_KIB] = "heap_kib",
+};
+
+void g_telemetry_init(g_telemetry *telemetry) {
+    memset(telemetry, 0, sizeof(*telemetry));
+}
+
+void g_telemetry_sample_world(g_telemetry *telemetry, const g_world *world) {
+    const uint64_t physics = world->stage_time[G_WORLD_STAGE_PHYSICS];
+    const uint64_t transform = world->stage_time[G_WORLD_STAGE_TRANSFORM];
+
+    g_telemetry_add(telemetry, G_TELEMETRY_PHYSICS,
+                    stm_ms(physics - telemetry->physics_time));
+    g_telemetry_add(telemetry, G_TELEMETRY_TRANSFORM,
+                    stm_ms(transform - telemetry->transform_time));
+    g_telemetry_add(telemetry, G_TELEMETRY_PAIRS_TESTED,
+                    world->actors.pairs_tested - telemetry->pairs_tested);
+    g_telemetry_add(telemetry, G_TELEMETRY_CONTACTS,
+                    world->actors.contacts - telemetry->contacts);
+
+    telemetry->physics_time = physics;
+    telemetry->transform_time = transform;
+    telemetry->pairs_tested = world->actors.pairs_tested;
+    telemetry->contacts = world->actors.contacts;
+
+    telemetry->pending[G_TELEMETRY_ALIVE] = world->actors.alive_view->size;
+
+    telemetry->allocator = world->allocator;
+    telemetry->pending[G_TELEMETRY_HEAP_KIB] =
+        g_alloc_live(world->allocator) / 1024.0f;
+}
+
+void g_telemetry_commit(g_telemetry *telemetry) {
+    uint32_t slot;
+    if (telemetry->size < G_TELEMETRY_WINDOW) {
+        slot = telemetry->size++;
+    } else {
+        slot = telemetry->head;
+        telemetry->head = (telemetry->head + 1) % G_TELEMETRY_WINDOW;
+    }
+
+    for (size_t s = 0; s < G_TELEMETRY_SERIES_COUNT; s++) {
+        telemetry->samples[s][slot] = telemetry->pending[s];
+        telemetry->pending[s] = 0.0f;
+    }
+
+    telemetry->frames++;
+}
+
+static int g_telemetry_compare(const void *a, const void *b) {
+    const float x = *(const float *)a;
+    const float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank on a sorted window
+static inline float g_telemetry_rank(const float *sorted, uint32_t size,
+                                     float p) {
+    return sorted[(uint32_t)(p * (size - 1) + 0.5f)];
+}
+
+void g_telemetry_summarize(const g_telemetry *telemetry,
+                           enum g_telemetry_series series,
+                           g_telemetry_stats *stats) {
+    const uint32_t size = telemetry->size;
+    if (size == 0) {
+        *stats = (g_telemetry_stats){0};
+        return;
+    }
+
+    // Order doesn't matter, the ring can be sorted as is
+    float sorted[G_TELEMETRY_WINDOW];
+    memcpy(sorted, telemetry->samples[series], sizeof(float) * size);
+    qsort(sorted, size, sizeof(float), g_telemetry_compare);
+
+    double sum = 0.0;
+    for (uint32_t i = 0; i < size; i++) {
+        sum += sorted[i];
+    }
+
+    *stats = (g_telemetry_stats){
+        .min = sorted[0],
+        .mean = (float)(sum / size),
+        .p50 = g_telemetry_rank(sorted, size, 0.50f),
+        .p95 = g_telemetry_rank(sorted, size, 0.95f),
+        .p99 = g_telemetry_rank(sorted, size, 0.99f),
+        .max = sorted[size - 1],
+    };
+}
+
+bool g_telemetry_dump_csv(const g_telemetry *telemetry, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return false;
+    }
+
+    fprintf(file, "frame");
+    for (size_t s = 0; s < G_TELEMETRY_SERIES_COUNT; s++) {
+        fprintf(file, ",%s", g_telemetry_series_names[s]);
+    }
+    fprintf(file, "\n");
+
+    const uint64_t first = telemetry->frames - telemetry->size;
+    for (uint32_t i = 0; i < telemetry->size; i++) {
+        const uint32_t slot = (telemetry->head + i) % G_TELEMETRY_WINDOW;
+
+        fprintf(file, "%llu", (unsigned long long)(first + i));
+        for (size_t s = 0; s < G_TELEMETRY_SERIES_COUNT; s++) {
+            fprintf(file, ",%g", telemetry->samples[s][slot]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    return true;
+}
+
+bool g_telemetry_dump_json(const g_telemetry *telemetry, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"frames\": %llu, \"window\": %u, \"series\": {\n",
+            (unsigned long long)telemetry->frames, telemetry->size);
+
+    for (size_t s = 0; s < G_TELEMETRY_SERIES_COUNT; s++) {
+        g_telemetry_stats stats;
+        g_telemetry_summarize(telemetry, s, &stats);
+
+        fprintf(file,
+                "  \"%s\": {\"min\": %g, \"mean\": %g, \"p50\": %g, "
+                "\"p95\": %g, \"p99\": %g, \"max\": %g}%s\n",
+                g_telemetry_series_names[s], stats.min, stats.mean,
+                stats.p50, stats.p95, stats.p99, stats.max,
+                s + 1 < G_TELEMETRY_SERIES_COUNT ? "," : "");
+    }
+
+    fprintf(file, "}, \"memory\": {\n");
+
+    for (size_t t = 0; telemetry->allocator != NULL && t < G_ALLOC_TAG_COUNT;
+         t++) {
+        const g_alloc_stats *stats = &telemetry->allocator->stats[t];
+
+        fprintf(file,
+                "  \"%s\": {\"live\": %llu, \"peak\": %llu, "
+                "\"allocations\": %llu, \"failures\": %llu}%s\n",
+                g_alloc_tag_names[t], (unsigned long long)stats->live,
+                (unsigned long long)stats->peak,
+                (unsigned long long)stats->allocations,
+                (unsigned long long)stats->failures,
+                t + 1 < G_ALLOC_TAG_COUNT ? "," : "");
+    }
+
+    fprintf(file, "}}\n");
+
+    fclose(file);
+    return true;
+}
+
+// Two triangles, counter clockwise
+static size_t g_telemetry_quad(g_vertex *vertices, size_t size,
+                               size_t capacity, float x0, float y0, float x1,
+                               float y1, const uint8_t color[4]) {
+    if (size + 6 > capacity) {
+        return size;
+    }
+
+    const float corners[6][2] = {
+        {x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1},
+    };
+
+    for (int i = 0; i < 6; i++) {
+        vertices[size++] = (g_vertex){
+            corners[i][0], corners[i][1], color[0], color[1], color[2],
+            color[3],
+        };
+    }
+
+    return size;
+}
+
+size_t g_telemetry_overlay(const g_telemetry *telemetry, g_vertex *vertices,
+                           size_t capacity) {
+    static const uint8_t background[4] = {32, 32, 32, 160};
+    static const uint8_t p50_color[4] = {40, 200, 80, 255};
+    static const uint8_t p95_color[4] = {240, 200, 40, 255};
+    static const uint8_t p99_color[4] = {230, 40, 40, 255};
+    static const uint8_t budget_color[4] = {255, 255, 255, 255};
+
+    // Top left corner, rows grow downward
+    const float left = -0.98f, width = 0.6f;
+    const float top = 0.96f, row = 0.05f, bar = 0.035f;
+    const float scale = width / G_TELEMETRY_OVERLAY_MS;
+
+    size_t size = 0;
+    for (size_t s = 0; s < G_TELEMETRY_TIMING_COUNT; s++) {
+        g_telemetry_stats stats;
+        g_telemetry_summarize(telemetry, s, &stats);
+
+        const float y1 = top - s * row;
+        const float y0 = y1 - bar;
+        const float p50 = left + min(stats.p50 * scale, width);
+        const float p95 = left + min(stats.p95 * scale, width);
+        const float p99 = left + min(stats.p99 * scale, width);
+
+        size = g_telemetry_quad(vertices, size, capacity, left, y0,
+                                left + width, y1, background);
+        size = g_telemetry_quad(vertices, size, capacity, left, y0, p50, y1,
+                                p50_color);
+        size = g_telemetry_quad(vertices, size, capacity, p50, y0 + bar / 4,
+                                p95, y1 - bar / 4, p95_color);
+        size = g_telemetry_quad(vertices, size, capacity, p99 - 0.004f, y0,
+                                p99, y1, p99_color);
+
+        const float budget = left + 1000.0f / 60.0f * scale;
+        size = g_telemetry_quad(vertices, size, capacity, budget - 0.002f, y0,
+                                budget + 0.002f, y1, budget_color);
+    }
+
+    return size;
+}
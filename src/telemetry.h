@@ -0,0 +1,105 @@
+// Always on frame telemetry, independent of tracing. Every frame appends one
+// sample per series to a fixed ring, percentiles are computed over the ring
+// on demand.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "world.h"
+
+// Frames kept, a little over 8 seconds at 60 Hz
+#define G_TELEMETRY_WINDOW 512
+
+// Full width of the overlay bars, two 60 Hz frames
+#define G_TELEMETRY_OVERLAY_MS 33.3f
+
+enum g_telemetry_series : uint8_t {
+    // Timings, in milliseconds
+    G_TELEMETRY_FRAME,
+    G_TELEMETRY_WORLD_UPDATE,
+    G_TELEMETRY_PHYSICS,
+    G_TELEMETRY_TRANSFORM,
+    G_TELEMETRY_DRAW,
+    // Counters, per frame
+    G_TELEMETRY_ALIVE,
+    G_TELEMETRY_PAIRS_TESTED,
+    G_TELEMETRY_CONTACTS,
+    G_TELEMETRY_DRAW_CALLS,
+    // Live bytes of the world's allocator, in KiB
+    G_TELEMETRY_HEAP_KIB,
+    G_TELEMETRY_SERIES_COUNT,
+};
+
+// Series before this one are timings
+#define G_TELEMETRY_TIMING_COUNT G_TELEMETRY_ALIVE
+
+// Vertices of a full overlay, 5 quads per timing
+#define G_TELEMETRY_OVERLAY_VERTICES (G_TELEMETRY_TIMING_COUNT * 5 * 6)
+
+extern const char *const g_telemetry_series_names[G_TELEMETRY_SERIES_COUNT];
+
+typedef struct {
+    float min;
+    float mean;
+    float p50;
+    float p95;
+    float p99;
+    float max;
+} g_telemetry_stats;
+
+typedef struct g_telemetry {
+    float samples[G_TELEMETRY_SERIES_COUNT][G_TELEMETRY_WINDOW];
+    // Oldest sample once the ring is full
+    uint32_t head;
+    uint32_t size;
+
+    // Accumulated for the frame in progress
+    float pending[G_TELEMETRY_SERIES_COUNT];
+
+    // World totals at the last g_telemetry_sample_world, for deltas
+    uint64_t physics_time;
+    uint64_t transform_time;
+    uint64_t pairs_tested;
+    uint64_t contacts;
+
+    // Allocator of the last sampled world, dumped per tag
+    const g_allocator *allocator;
+
+    // Counters
+    uint64_t frames;
+} g_telemetry;
+
+void g_telemetry_init(g_telemetry *telemetry);
+
+// Add to a series of the frame in progress.
+static inline void g_telemetry_add(g_telemetry *telemetry,
+                                   enum g_telemetry_series series,
+                                   float value) {
+    telemetry->pending[series] += value;
+}
+
+// Add the world's stage times and physics counters since the last call, and
+// its alive actors and live memory.
+void g_telemetry_sample_world(g_telemetry *telemetry, const g_world *world);
+
+// Append the frame in progress to the ring, evicting the oldest frame once
+// full.
+void g_telemetry_commit(g_telemetry *telemetry);
+
+// Stats of a series over the ring, zeroed while it's empty.
+void g_telemetry_summarize(const g_telemetry *telemetry,
+                           enum g_telemetry_series series,
+                           g_telemetry_stats *stats);
+
+// One row per frame in the ring, oldest first.
+bool g_telemetry_dump_csv(const g_telemetry *telemetry, const char *path);
+
+// Stats of every series, and the per tag memory of the sampled world.
+bool g_telemetry_dump_json(const g_telemetry *telemetry, const char *path);
+
+// Overlay triangles in clip space, a row of bars per timing: p50, p95 and p99
+// against G_TELEMETRY_OVERLAY_MS, with a mark at 60 Hz. Returns the vertex
+// count, at most capacity.
+size_t g_telemetry_overlay(const g_telemetry *telemetry, g_vertex *vertices,
+                           size_t capacity);
+
+#endif
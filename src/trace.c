@@ -0,0 +1,328 @@
+#include "trace.h"
+
+#include <sokol/sokol_time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define G_TRACE_THREADED
+#include <pthread.h>
+#include <time.h>
+#endif
+
+// Background drain period
+#define G_TRACE_FLUSH_MS 10
+
+// Single producer, the owning thread, and single consumer, the drain. head
+// and tail only grow, indices wrap modulo G_TRACE_RING_EVENTS.
+typedef struct g_trace_ring {
+    g_trace_event events[G_TRACE_RING_EVENTS];
+    atomic_uint_least32_t head;
+    atomic_uint_least32_t tail;
+    atomic_uint_least32_t dropped;
+
+    uint32_t thread;
+    char name[G_TRACE_MAX_NAME_LENGTH + 1];
+    atomic_bool named;
+
+    struct g_trace_ring *next;
+} g_trace_ring;
+
+g_trace_filter g_trace_filters;
+
+static struct {
+    FILE *file;
+    uint32_t sample_every;
+    uint64_t frame;
+
+    // Rings are never freed, threads keep theirs across g_trace_init calls
+    // and the drain walks them lock-free
+    _Atomic(g_trace_ring *) rings;
+    atomic_uint_least32_t thread_count;
+
+    // Interning is rare, a spinlock keeps the event path free of it
+    atomic_flag names_lock;
+    const char *names[G_TRACE_MAX_NAMES];
+    atomic_uint_least16_t name_count;
+    // Names already written to the file
+    uint16_t names_written;
+
+#ifdef G_TRACE_THREADED
+    pthread_t drain;
+    atomic_bool running;
+#endif
+} g_trace;
+
+static _Thread_local g_trace_ring *g_trace_local;
+
+static g_trace_ring *g_trace_ring_get(void) {
+    if (g_trace_local != NULL) {
+        return g_trace_local;
+    }
+
+    g_trace_ring *ring = calloc(1, sizeof(g_trace_ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+
+    ring->thread = atomic_fetch_add(&g_trace.thread_count, 1) + 1;
+
+    ring->next = atomic_load(&g_trace.rings);
+    while (!atomic_compare_exchange_weak(&g_trace.rings, &ring->next, ring)) {
+    }
+
+    g_trace_local = ring;
+    return ring;
+}
+
+void g_trace_record(uint16_t name, enum g_trace_phase phase,
+                    enum g_trace_level level, int32_t value) {
+    g_trace_ring *ring = g_trace_ring_get();
+    if (ring == NULL) {
+        return;
+    }
+
+    const uint32_t head =
+        atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const uint32_t tail =
+        atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail >= G_TRACE_RING_EVENTS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    ring->events[head % G_TRACE_RING_EVENTS] = (g_trace_event){
+        .time = stm_now(),
+        .value = value,
+        .name = name,
+        .phase = phase,
+        .level = level,
+    };
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+uint16_t g_trace_intern(const char *name) {
+    while (atomic_flag_test_and_set_explicit(&g_trace.names_lock,
+                                             memory_order_acquire)) {
+    }
+
+    const uint16_t count = atomic_load(&g_trace.name_count);
+
+    uint16_t id = 0;
+    for (uint16_t i = 0; i < count && id == 0; i++) {
+        if (g_trace.names[i] == name || strcmp(g_trace.names[i], name) == 0) {
+            id = i + 1;
+        }
+    }
+
+    if (id == 0 && count < G_TRACE_MAX_NAMES) {
+        g_trace.names[count] = name;
+        atomic_store(&g_trace.name_count, count + 1);
+        id = count + 1;
+    }
+
+    atomic_flag_clear_explicit(&g_trace.names_lock, memory_order_release);
+
+    // Out of names, everything else shares the last one
+    return id != 0 ? id : G_TRACE_MAX_NAMES;
+}
+
+void g_trace_thread_name(const char *name) {
+    // Don't give untraced threads a ring just for their name
+    if (!atomic_load_explicit(&g_trace_filters.active, memory_order_relaxed)) {
+        return;
+    }
+
+    g_trace_ring *ring = g_trace_ring_get();
+    if (ring == NULL) {
+        return;
+    }
+
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    atomic_store_explicit(&ring->named, true, memory_order_release);
+}
+
+static void g_trace_write_string(FILE *file, uint32_t type, uint32_t id,
+                                 uint32_t thread, const char *string) {
+    const uint32_t length = (uint32_t)strnlen(string, G_TRACE_MAX_NAME_LENGTH);
+    const g_trace_chunk chunk = {
+        .type = type,
+        .id = id,
+        .thread = thread,
+        .count = length,
+    };
+
+    fwrite(&chunk, sizeof(chunk), 1, file);
+    fwrite(string, 1, length, file);
+}
+
+// Copy out everything recorded so far. Only ever runs on one thread at a
+// time: the drain thread, or the caller once it's stopped.
+static void g_trace_drain(void) {
+    FILE *file = g_trace.file;
+
+    const uint16_t name_count = atomic_load(&g_trace.name_count);
+    for (; g_trace.names_written < name_count; g_trace.names_written++) {
+        g_trace_write_string(file, G_TRACE_CHUNK_NAME,
+                             g_trace.names_written + 1, 0,
+                             g_trace.names[g_trace.names_written]);
+    }
+
+    for (g_trace_ring *ring = atomic_load(&g_trace.rings); ring != NULL;
+         ring = ring->next) {
+        if (atomic_exchange_explicit(&ring->named, false,
+                                     memory_order_acquire)) {
+            g_trace_write_string(file, G_TRACE_CHUNK_THREAD, 0, ring->thread,
+                                 ring->name);
+        }
+
+        const uint32_t dropped =
+            atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (dropped > 0) {
+            const g_trace_chunk chunk = {
+                .type = G_TRACE_CHUNK_DROPPED,
+                .thread = ring->thread,
+                .count = dropped,
+            };
+            fwrite(&chunk, sizeof(chunk), 1, file);
+        }
+
+        const uint32_t tail =
+            atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        const uint32_t head =
+            atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (head == tail) {
+            continue;
+        }
+
+        const g_trace_chunk chunk = {
+            .type = G_TRACE_CHUNK_EVENTS,
+            .thread = ring->thread,
+            .count = head - tail,
+        };
+        fwrite(&chunk, sizeof(chunk), 1, file);
+
+        for (uint32_t i = tail; i != head; i++) {
+            g_trace_event event = ring->events[i % G_TRACE_RING_EVENTS];
+            event.time = (uint64_t)stm_ns(event.time);
+            fwrite(&event, sizeof(event), 1, file);
+        }
+
+        atomic_store_explicit(&ring->tail, head, memory_order_release);
+    }
+}
+
+#ifdef G_TRACE_THREADED
+static void *g_trace_drain_thread(void *arg) {
+    (void)arg;
+
+    const struct timespec period = {
+        .tv_nsec = G_TRACE_FLUSH_MS * 1000000L,
+    };
+
+    while (atomic_load(&g_trace.running)) {
+        nanosleep(&period, NULL);
+        g_trace_drain();
+    }
+
+    return NULL;
+}
+#endif
+
+bool g_trace_init(const char *path, enum g_trace_level level,
+                  uint32_t sample_every) {
+    g_trace.file = fopen(path, "wb");
+    if (g_trace.file == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return false;
+    }
+
+    const g_trace_file_header header = {
+        .magic = G_TRACE_MAGIC,
+        .version = G_TRACE_VERSION,
+    };
+    fwrite(&header, sizeof(header), 1, g_trace.file);
+
+    // Rings left from an earlier session drop what was recorded after its
+    // last drain and name their threads again in the new file
+    for (g_trace_ring *ring = atomic_load(&g_trace.rings); ring != NULL;
+         ring = ring->next) {
+        atomic_store_explicit(&ring->tail, atomic_load(&ring->head),
+                              memory_order_release);
+        atomic_store_explicit(&ring->dropped, 0, memory_order_relaxed);
+        if (ring->name[0] != '\0') {
+            atomic_store_explicit(&ring->named, true, memory_order_release);
+        }
+    }
+    g_trace.names_written = 0;
+
+    g_trace.sample_every = sample_every > 0 ? sample_every : 1;
+    g_trace.frame = 0;
+
+    atomic_store(&g_trace_filters.level, level);
+    atomic_store(&g_trace_filters.skip_frame, false);
+    atomic_store(&g_trace_filters.active, true);
+
+#ifdef G_TRACE_THREADED
+    atomic_store(&g_trace.running, true);
+    if (pthread_create(&g_trace.drain, NULL, g_trace_drain_thread, NULL) !=
+        0) {
+        printf("Couldn't start the trace thread, draining at exit only!\n");
+        atomic_store(&g_trace.running, false);
+    }
+#endif
+
+    return true;
+}
+
+void g_trace_shutdown(void) {
+    if (g_trace.file == NULL) {
+        return;
+    }
+
+    atomic_store(&g_trace_filters.active, false);
+
+#ifdef G_TRACE_THREADED
+    if (atomic_exchange(&g_trace.running, false)) {
+        pthread_join(g_trace.drain, NULL);
+    }
+#endif
+
+    // Events recorded while the drain stopped can still be in the rings
+    g_trace_drain();
+
+    fclose(g_trace.file);
+    g_trace.file = NULL;
+
+    // The rings stay, other threads still point at theirs
+}
+
+void g_trace_frame(void) {
+    if (g_trace.file == NULL) {
+        return;
+    }
+
+    g_trace.frame++;
+    atomic_store_explicit(&g_trace_filters.skip_frame,
+                          g_trace.frame % g_trace.sample_every != 0,
+                          memory_order_relaxed);
+
+#ifdef G_TRACE_THREADED
+    if (atomic_load_explicit(&g_trace.running, memory_order_relaxed)) {
+        return;
+    }
+#endif
+
+    // No drain thread, keep the rings from filling up
+    if (g_trace.frame % 16 == 0) {
+        g_trace_drain();
+    }
+}
+
+void g_trace_set_level(enum g_trace_level level) {
+    atomic_store(&g_trace_filters.level, level);
+}
@@ -0,0 +1,141 @@
+// Low overhead tracing. Every thread appends compact binary events to its own
+// lock-free ring, a background thread drains the rings to a file and
+// ctri_trace converts it to the Chrome trace format offline.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Lower is coarser, events above the runtime level are skipped
+enum g_trace_level : uint8_t {
+    G_TRACE_FRAME = 0,
+    G_TRACE_SYSTEM = 1,
+    G_TRACE_DETAIL = 2,
+};
+
+// Events above this level compile out, -1 removes tracing entirely.
+#ifndef G_TRACE_MAX_LEVEL
+#define G_TRACE_MAX_LEVEL 2
+#endif
+
+enum g_trace_phase : uint8_t {
+    G_TRACE_PHASE_BEGIN,
+    G_TRACE_PHASE_END,
+    G_TRACE_PHASE_INSTANT,
+    G_TRACE_PHASE_COUNTER,
+};
+
+// Events per thread ring, a full ring drops new events until drained
+#define G_TRACE_RING_EVENTS 16384
+#define G_TRACE_MAX_NAMES 1024
+#define G_TRACE_MAX_NAME_LENGTH 63
+
+typedef struct {
+    // sokol_time ticks in the rings, nanoseconds in the file
+    uint64_t time;
+    // Counter value, unused otherwise
+    int32_t value;
+    uint16_t name;
+    uint8_t phase;
+    uint8_t level;
+} g_trace_event;
+
+// Runtime filters, read without synchronization on every event
+typedef struct {
+    // Off until g_trace_init succeeds
+    atomic_bool active;
+    // Frames left out by sampling
+    atomic_bool skip_frame;
+    atomic_uint_least8_t level;
+} g_trace_filter;
+
+extern g_trace_filter g_trace_filters;
+
+// Start tracing to path. Every sample_every frames only one is recorded, see
+// g_trace_frame. Returns false if the file can't be opened.
+bool g_trace_init(const char *path, enum g_trace_level level,
+                  uint32_t sample_every);
+
+// Drain every ring one last time and close the file.
+void g_trace_shutdown(void);
+
+// Mark a frame boundary on the main thread, applies sampling.
+void g_trace_frame(void);
+
+void g_trace_set_level(enum g_trace_level level);
+
+// Name the calling thread in the exported trace. Does nothing while tracing
+// is off, so threads are named after g_trace_init.
+void g_trace_thread_name(const char *name);
+
+// Id of a name, the same for equal strings. Call sites cache it, see
+// G_TRACE_EVENT.
+uint16_t g_trace_intern(const char *name);
+
+void g_trace_record(uint16_t name, enum g_trace_phase phase,
+                    enum g_trace_level level, int32_t value);
+
+static inline bool g_trace_enabled(enum g_trace_level level) {
+    return atomic_load_explicit(&g_trace_filters.active,
+                                memory_order_relaxed) &&
+           !atomic_load_explicit(&g_trace_filters.skip_frame,
+                                 memory_order_relaxed) &&
+           level <= atomic_load_explicit(&g_trace_filters.level,
+                                         memory_order_relaxed);
+}
+
+// Ids start at 1, a call site interns its name on its first recorded event
+#define G_TRACE_EVENT(lvl, name, phase, value)                                 \
+    do {                                                                       \
+        if ((int)(lvl) <= G_TRACE_MAX_LEVEL && g_trace_enabled(lvl)) {         \
+            static atomic_uint_least16_t g_trace_id_;                          \
+            uint16_t id_ = atomic_load_explicit(&g_trace_id_,                  \
+                                                memory_order_relaxed);         \
+            if (id_ == 0) {                                                    \
+                id_ = g_trace_intern(name);                                    \
+                atomic_store_explicit(&g_trace_id_, id_,                       \
+                                      memory_order_relaxed);                   \
+            }                                                                  \
+            g_trace_record(id_, (phase), (lvl), (value));                      \
+        }                                                                      \
+    } while (0)
+
+#define G_TRACE_BEGIN(level, name)                                             \
+    G_TRACE_EVENT(level, name, G_TRACE_PHASE_BEGIN, 0)
+#define G_TRACE_END(level, name)                                               \
+    G_TRACE_EVENT(level, name, G_TRACE_PHASE_END, 0)
+#define G_TRACE_INSTANT(level, name)                                           \
+    G_TRACE_EVENT(level, name, G_TRACE_PHASE_INSTANT, 0)
+#define G_TRACE_COUNTER(level, name, value)                                    \
+    G_TRACE_EVENT(level, name, G_TRACE_PHASE_COUNTER, (int32_t)(value))
+
+// File layout, little endian: a g_trace_file_header, then chunks. Each chunk
+// is a g_trace_chunk followed by its payload.
+#define G_TRACE_MAGIC 0x45435254u // "TRCE"
+#define G_TRACE_VERSION 1
+
+enum g_trace_chunk_type : uint32_t {
+    // count g_trace_events of one thread
+    G_TRACE_CHUNK_EVENTS,
+    // A name, id in id, count bytes without terminator
+    G_TRACE_CHUNK_NAME,
+    // A thread name, thread id in thread, count bytes without terminator
+    G_TRACE_CHUNK_THREAD,
+    // Events one thread dropped since the last chunk, in count
+    G_TRACE_CHUNK_DROPPED,
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+} g_trace_file_header;
+
+typedef struct {
+    uint32_t type;
+    uint32_t id;
+    uint32_t thread;
+    uint32_t count;
+} g_trace_chunk;
+
+#endif
@@ -0,0 +1,210 @@
+// Offline converter from the binary trace written by src/trace.c to the
+// Chrome trace format, for chrome://tracing or Perfetto.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+static void usage(const char *name) {
+    printf("usage: %s TRACE [OUT.json]\n", name);
+}
+
+static char *g_trace_read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("Couldn't open %s!\n", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = length > 0 ? malloc(length) : NULL;
+    if (data == NULL || fread(data, 1, length, file) != (size_t)length) {
+        printf("Couldn't read %s!\n", path);
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+// Names are plain identifiers in practice, escape just enough to stay valid
+static void g_trace_write_json_string(FILE *out, const char *string,
+                                      size_t length) {
+    fputc('"', out);
+    for (size_t i = 0; i < length; i++) {
+        const char c = string[i];
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if ((unsigned char)c >= 0x20) {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t size;
+    char *data = g_trace_read_file(argv[1], &size);
+    if (data == NULL) {
+        return 1;
+    }
+
+    g_trace_file_header header = {0};
+    if (size >= sizeof(header)) {
+        memcpy(&header, data, sizeof(header));
+    }
+
+    if (header.magic != G_TRACE_MAGIC) {
+        printf("%s isn't a trace!\n", argv[1]);
+        free(data);
+        return 1;
+    }
+
+    if (header.version != G_TRACE_VERSION) {
+        printf("Unsupported trace version %u!\n", header.version);
+        free(data);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (argc == 3 && (out = fopen(argv[2], "w")) == NULL) {
+        printf("Couldn't open %s!\n", argv[2]);
+        free(data);
+        return 1;
+    }
+
+    // Names can be written after the first events using them, so chunks are
+    // walked twice
+    const char *names[G_TRACE_MAX_NAMES + 1] = {0};
+    uint32_t name_lengths[G_TRACE_MAX_NAMES + 1] = {0};
+
+    for (int pass = 0; pass < 2; pass++) {
+        size_t offset = sizeof(header);
+        bool first = true;
+        uint64_t events = 0, dropped = 0;
+
+        if (pass == 1) {
+            fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        }
+
+        while (offset + sizeof(g_trace_chunk) <= size) {
+            g_trace_chunk chunk;
+            memcpy(&chunk, data + offset, sizeof(chunk));
+            offset += sizeof(chunk);
+
+            const size_t payload = chunk.type == G_TRACE_CHUNK_EVENTS
+                                       ? sizeof(g_trace_event) * chunk.count
+                                   : chunk.type == G_TRACE_CHUNK_DROPPED
+                                       ? 0
+                                       : chunk.count;
+            if (offset + payload > size) {
+                printf("Truncated trace, stopping at byte %zu\n", offset);
+                break;
+            }
+
+            const char *bytes = data + offset;
+            offset += payload;
+
+            if (chunk.type == G_TRACE_CHUNK_NAME) {
+                if (pass == 0 && chunk.id <= G_TRACE_MAX_NAMES) {
+                    names[chunk.id] = bytes;
+                    name_lengths[chunk.id] = chunk.count;
+                }
+                continue;
+            }
+
+            if (chunk.type == G_TRACE_CHUNK_DROPPED) {
+                dropped += chunk.count;
+                continue;
+            }
+
+            if (pass == 0) {
+                continue;
+            }
+
+            if (chunk.type == G_TRACE_CHUNK_THREAD) {
+                fprintf(out,
+                        "%s{\"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+                        "\"name\": \"thread_name\", \"args\": {\"name\": ",
+                        first ? "" : ",\n", chunk.thread);
+                g_trace_write_json_string(out, bytes, chunk.count);
+                fprintf(out, "}}");
+                first = false;
+                continue;
+            }
+
+            if (chunk.type != G_TRACE_CHUNK_EVENTS) {
+                continue;
+            }
+
+            static const char phases[] = {
+                [G_TRACE_PHASE_BEGIN] = 'B',
+                [G_TRACE_PHASE_END] = 'E',
+                [G_TRACE_PHASE_INSTANT] = 'i',
+                [G_TRACE_PHASE_COUNTER] = 'C',
+            };
+
+            for (uint32_t i = 0; i < chunk.count; i++) {
+                g_trace_event event;
+                memcpy(&event, bytes + sizeof(event) * i, sizeof(event));
+
+                if (event.phase > G_TRACE_PHASE_COUNTER) {
+                    continue;
+                }
+
+                fprintf(out, "%s{\"ph\": \"%c\", \"pid\": 1, \"tid\": %u, ",
+                        first ? "" : ",\n", phases[event.phase],
+                        chunk.thread);
+                fprintf(out, "\"ts\": %llu.%03llu, \"name\": ",
+                        (unsigned long long)(event.time / 1000),
+                        (unsigned long long)(event.time % 1000));
+
+                if (event.name <= G_TRACE_MAX_NAMES &&
+                    names[event.name] != NULL) {
+                    g_trace_write_json_string(out, names[event.name],
+                                              name_lengths[event.name]);
+                } else {
+                    fprintf(out, "\"#%u\"", event.name);
+                }
+
+                if (event.phase == G_TRACE_PHASE_INSTANT) {
+                    fprintf(out, ", \"s\": \"t\"");
+                } else if (event.phase == G_TRACE_PHASE_COUNTER) {
+                    fprintf(out, ", \"args\": {\"value\": %d}", event.value);
+                }
+
+                fprintf(out, "}");
+                first = false;
+                events++;
+            }
+        }
+
+        if (pass == 1) {
+            fprintf(out, "\n]}\n");
+            fprintf(stderr, "%llu events, %llu dropped\n",
+                    (unsigned long long)events, (unsigned long long)dropped);
+        }
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(data);
+
+    return 0;
+}
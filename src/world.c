@@ -1,17 +1,70 @@
 #include "world.h"
+#include "trace.h"
 
-#include <minitrace/minitrace.h>
 #include <sokol/sokol_time.h>
 
-void g_world_init(g_world *world) {
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const g_world_stage_names[G_WORLD_STAGE_COUNT] = {
+    [G_WORLD_STAGE_PHYSICS] = "physics",
+    [G_WORLD_STAGE_GRID] = "grid",
+    [G_WORLD_STAGE_PLAYER] = "player",
+    [G_WORLD_STAGE_FLOW] = "flow",
+    [G_WORLD_STAGE_AI_LOD] = "ai_lod",
+    [G_WORLD_STAGE_ALLIES] = "allies",
+    [G_WORLD_STAGE_ENEMIES] = "enemies",
+    [G_WORLD_STAGE_PROJECTILES] = "projectiles",
+    [G_WORLD_STAGE_PARTICLES] = "particles",
+    [G_WORLD_STAGE_TRANSFORM] = "transform",
+};
+
+static const float g_fire_interval = 1.0f / 16;
+static const float g_projectile_speed = 40.0f;
+
+// Allies spawned by g_world_init, next to the player, an enemy and a neutral.
+static const size_t g_world_allies = 100;
+
+bool g_world_init(g_world *world, g_allocator *allocator, uint64_t seed) {
+    world->allocator = allocator;
     world->start_time = stm_now();
+    world->tick = 0;
+    world->seed = seed;
+    world->physics_tick = 0.0f;
+    g_rng_seed(&world->rng, seed);
+    world->walls = NULL;
+    memset(&world->level, 0, sizeof(world->level));
+    world->replay = NULL;
+    world->rewind = NULL;
+    memset(world->stage_time, 0, sizeof(world->stage_time));
+    g_tick_scheduler_init(&world->scheduler);
 
-    world->static_meshes = g_static_meshes_init(8);
+    // Unwind whatever succeeded, the caller has nothing to delete
+    if (!g_arena_init(&world->tick_arena, allocator, G_ALLOC_TAG_FRAME,
+                      G_WORLD_TICK_ARENA_SIZE)) {
+        printf("Couldn't allocate the world!\n");
+        return false;
+    }
+
+    if (!g_static_meshes_init(&world->static_meshes, allocator,
+                              G_WORLD_STATIC_MESHES)) {
+        printf("Couldn't allocate the world!\n");
+        g_arena_delete(&world->tick_arena);
+        return false;
+    }
+
+    if (!g_actor_stack_init(&world->actors, allocator)) {
+        printf("Couldn't allocate the world!\n");
+        g_static_meshes_delete(&world->static_meshes);
+        g_arena_delete(&world->tick_arena);
+        return false;
+    }
 
     mat4 transform = GLM_MAT4_IDENTITY_INIT;
     glm_translated_z(transform, -8.0f);
 
-    g_static_meshes_add(
+    const size_t mesh = g_static_meshes_add(
         &world->static_meshes, transform,
         (g_vertex[]){
             {g_unit_triangle[0][0], g_unit_triangle[0][1], 128, 128, 128, 255},
@@ -20,7 +73,22 @@ void g_world_init(g_world *world) {
         },
         3);
 
-    g_actor_stack_init(&world->actors);
+    // A failed create hands back {0, 0}, a live handle, so check room up front
+    if (mesh == SIZE_MAX ||
+        stable_index_remaining_cap(&world->actors.actor_index) <
+            3 + g_world_allies) {
+        printf("Couldn't populate the world!\n");
+        g_world_delete(world);
+        return false;
+    }
+
+    g_actor_grid_init(&world->grid, 2.0f);
+    g_flow_field_init(&world->flow, 1.0f);
+    g_formation_init(&world->formation);
+    g_ai_lod_init(&world->ai_lod);
+    g_projectiles_init(&world->projectiles);
+    g_particles_init(&world->particles, g_world_particle_seed(seed));
+
     glm_vec2((vec2){0.0f, 0.0f}, world->camera.position);
     world->camera.view_height = 15.0f;
 
@@ -41,8 +109,8 @@ void g_world_init(g_world *world) {
                              .transform.z = -1.0f,
                              .transform.position =
                                  {
-                                     rand_float(-10.0f, 10.0f),
-                                     rand_float(-10.0f, 10.0f),
+                                     rand_float(&world->rng, -10.0f, 10.0f),
+                                     rand_float(&world->rng, -10.0f, 10.0f),
                                  },
                              .transform.scale = {1.0f, 1.0f},
                              .drag = 4.0f,
@@ -60,7 +128,7 @@ void g_world_init(g_world *world) {
                              .mass = 1.0f,
                          });
 
-    for (int i = 0; i < 100; i++) {
+    for (size_t i = 0; i < g_world_allies; i++) {
         g_actor_stack_create(&world->actors,
                              &(g_actor_stack_create_ctx){
                                  .color = {0.0f, 0.5f, 1.0f, 1.0},
@@ -68,43 +136,360 @@ void g_world_init(g_world *world) {
                                  .transform.z = -1.0f,
                                  .transform.position =
                                      {
-                                         rand_float(-10.0f, 10.0f),
-                                         rand_float(-10.0f, 10.0f),
+                                         rand_float(&world->rng, -10.0f, 10.0f),
+                                         rand_float(&world->rng, -10.0f, 10.0f),
                                      },
                                  .transform.scale = {0.5f, 0.5f},
                                  .drag = 4.0f,
                                  .mass = 0.25f,
                              });
     }
+
+    return true;
+}
+
+// Spawn the player's projectiles along its facing direction.
+static void g_world_player_fire(float dt, g_world *world) {
+    g_player *player = &world->player;
+
+    player->fire_cooldown = glm_max(player->fire_cooldown - dt, 0.0f);
+
+    if (!player->input_map.fire || player->fire_cooldown > 0.0f ||
+        !g_actor_stack_valid(&world->actors, player->actor_handle)) {
+        return;
+    }
+
+    player->fire_cooldown = g_fire_interval;
+
+    const g_transform *transform =
+        &world->actors.transforms[player->actor_handle.index];
+
+    for (int i = -2; i <= 2; i++) {
+        const float angle = transform->rotation + i * 0.05f;
+        const vec2 dir = {cosf(angle), sinf(angle)};
+
+        g_projectiles_create(
+            &world->projectiles,
+            &(g_projectile_create_ctx){
+                .position = {transform->position[0] + dir[0] * 0.5f,
+                             transform->position[1] + dir[1] * 0.5f},
+                .velocity = {dir[0] * g_projectile_speed,
+                             dir[1] * g_projectile_speed},
+                .lifetime = 2.0f,
+                .ignore = ACTOR_TYPE_PLAYER | ACTOR_TYPE_ALLY,
+            });
+    }
+}
+
+// Knock back every actor hit this tick and shatter some shards off of it.
+static void g_world_projectile_hits(g_world *world) {
+    for (size_t i = 0; i < world->projectiles.hit_count; i++) {
+        g_projectile_hit *hit = &world->projectiles.hits[i];
+
+        if (!g_actor_stack_valid(&world->actors, hit->actor)) {
+            continue;
+        }
+
+        const float mass = world->actors.mass[hit->actor.index];
+        if (mass <= 0.0f) {
+            continue;
+        }
+
+        glm_vec2_muladds(hit->velocity, 0.02f / mass,
+                         world->actors.velocities[hit->actor.index].linear);
+
+        g_particles_burst(&world->particles, hit->point, hit->velocity,
+                          world->actors.colors[hit->actor.index], 16);
+    }
+}
+
+// Push moving actors out of the walls and stop them going further in.
+static void g_world_collide_walls(g_world *world) {
+    g_actor_stack *actors = &world->actors;
+    const stable_index_view *alive = actors->alive_view;
+
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+        if (actors->mass[idx] <= 0.0f) {
+            continue;
+        }
+
+        float *position = actors->transforms[idx].position;
+        vec2 push;
+        if (!g_level_walls_push(world->walls, position,
+                                actors->poses[idx].radius, push)) {
+            continue;
+        }
+
+        glm_vec2_add(position, push, position);
+
+        // Slide along the wall, dropping the velocity into it
+        const float length = glm_vec2_norm(push);
+        if (length > 0.0f) {
+            vec2 normal;
+            glm_vec2_divs(push, length, normal);
+
+            float *linear = actors->velocities[idx].linear;
+            const float into = glm_vec2_dot(linear, normal);
+            if (into < 0.0f) {
+                glm_vec2_mulsubs(normal, into, linear);
+            }
+        }
+    }
+}
+
+// Advance the simulation by one fixed tick.
+static void g_world_tick(g_world *world) {
+    g_tick_scheduler *scheduler = &world->scheduler;
+
+    // Player update and fire consume the input, keep what the tick saw
+    const g_input_map input = world->player.input_map;
+    const g_camera camera = world->camera;
+
+    // Resimulating runs many ticks per update, give back their data
+    const size_t mark = g_arena_mark(&world->tick_arena);
+
+    uint64_t lap = stm_now();
+    uint64_t *stage_time = world->stage_time;
+
+    const uint32_t substeps = scheduler->substeps;
+    for (uint32_t i = 0; i < substeps; i++) {
+        g_actor_stack_phys(g_fixed_dt / substeps, &world->actors);
+    }
+    if (world->walls != NULL) {
+        g_world_collide_walls(world);
+    }
+    stage_time[G_WORLD_STAGE_PHYSICS] += stm_laptime(&lap);
+
+    g_actor_grid_build(&world->grid, &world->actors);
+    stage_time[G_WORLD_STAGE_GRID] += stm_laptime(&lap);
+
+    g_player_update(g_fixed_dt, &world->player, &world->actors,
+                    &world->camera);
+    stage_time[G_WORLD_STAGE_PLAYER] += stm_laptime(&lap);
+
+    const stable_index_handle player = world->player.actor_handle;
+    if ((world->tick % G_FLOW_INTERVAL == 0 || !world->flow.built) &&
+        g_actor_stack_valid(&world->actors, player)) {
+        g_flow_field_build(&world->flow, &world->static_meshes,
+                           world->actors.transforms[player.index].position);
+    }
+    stage_time[G_WORLD_STAGE_FLOW] += stm_laptime(&lap);
+
+    g_ai_lod_plan(&world->ai_lod, &world->actors, player, world->tick,
+                  scheduler->ai_interval, g_fixed_dt);
+    stage_time[G_WORLD_STAGE_AI_LOD] += stm_laptime(&lap);
+
+    g_ally_update(&world->ai_lod, &world->actors, player, &world->formation,
+                  &world->grid);
+    stage_time[G_WORLD_STAGE_ALLIES] += stm_laptime(&lap);
+
+    g_enemy_update(&world->ai_lod, &world->actors, player, &world->flow);
+    stage_time[G_WORLD_STAGE_ENEMIES] += stm_laptime(&lap);
+
+    g_world_player_fire(g_fixed_dt, world);
+    g_projectiles_update(g_fixed_dt, &world->projectiles, &world->actors,
+                         &world->grid, world->walls, &world->tick_arena);
+    g_world_projectile_hits(world);
+    world->projectiles.hits = NULL;
+    world->projectiles.hit_count = 0;
+    stage_time[G_WORLD_STAGE_PROJECTILES] += stm_laptime(&lap);
+
+    world->tick++;
+    g_arena_rewind(&world->tick_arena, mark);
+
+    if (world->rewind != NULL) {
+        g_rewind_push(world->rewind, world, &input, &camera);
+    }
 }
 
 void g_world_update(float dt, g_world *world) {
-    MTR_BEGIN("frame", "world_update");
+    G_TRACE_BEGIN(G_TRACE_FRAME, "world_update");
+    g_arena_reset(&world->tick_arena);
     world->elapsed_time = stm_since(world->start_time);
 
     world->physics_tick += dt;
 
-    MTR_BEGIN("frame", "physics");
-    while (world->physics_tick >= g_fixed_dt) {
-        for (int i = 0; i < 2; i++) {
-            g_actor_stack_phys(g_fixed_dt / 2.0f, &world->actors);
+    g_tick_scheduler *scheduler = &world->scheduler;
+
+    // Substeps and AI rate change the simulation, keep replays exact.
+    if (world->replay != NULL) {
+        scheduler->adaptive = false;
+    }
+
+    const uint32_t ticks =
+        g_tick_scheduler_plan(scheduler, g_fixed_dt, &world->physics_tick);
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "physics");
+    for (uint32_t t = 0; t < ticks; t++) {
+        const uint64_t tick_start = stm_now();
+
+        if (world->replay != NULL) {
+            g_replay_before_tick(world->replay, &world->player.input_map,
+                                 &world->camera);
         }
-        g_player_update(g_fixed_dt, &world->player, &world->actors,
-                        &world->camera);
-        g_ally_update(g_fixed_dt, &world->actors, world->player.actor_handle);
-        g_enemy_update(g_fixed_dt, &world->actors, world->player.actor_handle);
+
+        g_world_tick(world);
+        if (world->replay != NULL) {
+            g_replay_after_tick(world->replay, g_world_hash(world));
+        }
+
         world->physics_tick -= g_fixed_dt;
+
+        g_tick_scheduler_record(scheduler, stm_sec(stm_since(tick_start)));
     }
-    MTR_END("frame", "physics");
+    G_TRACE_END(G_TRACE_SYSTEM, "physics");
+
+    g_tick_scheduler_adapt(scheduler, g_fixed_dt);
+
+    uint64_t lap = stm_now();
+    g_particles_update(dt, &world->particles);
+    world->stage_time[G_WORLD_STAGE_PARTICLES] += stm_laptime(&lap);
 
     g_camera_update(&world->player, &world->actors, dt, &world->camera);
 
+    lap = stm_now();
     g_actor_stack_transform(&world->actors, world->physics_tick);
+    world->stage_time[G_WORLD_STAGE_TRANSFORM] += stm_laptime(&lap);
+
+    const g_alloc_stats *memory = world->allocator->stats;
+    G_TRACE_COUNTER(G_TRACE_SYSTEM, "index_kib",
+                    memory[G_ALLOC_TAG_INDEX].live / 1024);
+    G_TRACE_COUNTER(G_TRACE_SYSTEM, "actors_kib",
+                    memory[G_ALLOC_TAG_ACTORS].live / 1024);
+    G_TRACE_COUNTER(G_TRACE_SYSTEM, "meshes_kib",
+                    memory[G_ALLOC_TAG_MESHES].live / 1024);
 
-    MTR_END("frame", "world_update");
+    G_TRACE_END(G_TRACE_FRAME, "world_update");
 }
 
 void g_world_delete(g_world *world) {
     g_actor_stack_delete(&world->actors);
     g_static_meshes_delete(&world->static_meshes);
+    g_arena_delete(&world->tick_arena);
+}
+
+bool g_world_load_level(g_world *world, const g_pack *pack, const char *name) {
+    g_static_meshes_clear(&world->static_meshes);
+    world->walls = NULL;
+    memset(&world->level, 0, sizeof(world->level));
+
+    // Obstacles moved, route around the new ones on the next tick
+    world->flow.built = false;
+
+    return g_pack_load_level(pack, name, &world->static_meshes);
+}
+
+bool g_world_load_generated(g_world *world, const g_level *level) {
+    g_static_meshes_clear(&world->static_meshes);
+    world->walls = &level->walls;
+    world->level = level->params;
+    world->flow.built = false;
+
+    mat4 transform = GLM_MAT4_IDENTITY_INIT;
+    glm_translated_z(transform, G_LEVEL_DEPTH);
+
+    for (size_t b = 0; b < level->batch_count; b++) {
+        const g_level_batch *batch = &level->batches[b];
+
+        if (g_static_meshes_add_borrowed(&world->static_meshes, transform,
+                                         &level->vertices[batch->first],
+                                         batch->count) == SIZE_MAX) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool g_world_rewind(g_world *world, uint64_t tick) {
+    if (world->rewind == NULL ||
+        !g_rewind_restore(world->rewind, world, tick)) {
+        return false;
+    }
+
+    g_actor_stack_transform(&world->actors, world->physics_tick);
+    return true;
+}
+
+bool g_world_resimulate(g_world *world, uint64_t tick) {
+    if (world->rewind == NULL || tick > world->tick) {
+        return false;
+    }
+
+    G_TRACE_BEGIN(G_TRACE_SYSTEM, "resimulate");
+
+    const uint64_t current = world->tick;
+    const float physics_tick = world->physics_tick;
+    const g_camera camera = world->camera;
+    const g_input_map input_map = world->player.input_map;
+
+    // Restoring drops the newer entries, along with their inputs
+    const size_t count = current - tick;
+    g_arena *scratch = g_scratch();
+    if (scratch == NULL) {
+        G_TRACE_END(G_TRACE_SYSTEM, "resimulate");
+        return false;
+    }
+
+    const size_t mark = g_arena_mark(scratch);
+    g_input_map *inputs = g_arena_push_array(scratch, g_input_map, count);
+    g_camera *cameras = g_arena_push_array(scratch, g_camera, count);
+    if (inputs == NULL || cameras == NULL) {
+        printf("Too many ticks to resimulate: %zu!\n", count);
+        g_arena_rewind(scratch, mark);
+        G_TRACE_END(G_TRACE_SYSTEM, "resimulate");
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        g_rewind_input(world->rewind, tick + 1 + i, &inputs[i], &cameras[i]);
+    }
+
+    const bool restored = g_world_rewind(world, tick);
+
+    for (size_t i = 0; restored && i < count; i++) {
+        world->player.input_map = inputs[i];
+        world->camera = cameras[i];
+        g_world_tick(world);
+    }
+
+    g_arena_rewind(scratch, mark);
+
+    // The accumulator and camera follow the frame, not the tick
+    world->physics_tick = physics_tick;
+    world->camera = camera;
+    world->player.input_map = input_map;
+    g_actor_stack_transform(&world->actors, world->physics_tick);
+
+    G_TRACE_END(G_TRACE_SYSTEM, "resimulate");
+    return restored;
+}
+
+uint64_t g_world_hash(const g_world *world) {
+    const g_actor_stack *actors = &world->actors;
+    const stable_index_view *alive = actors->alive_view;
+
+    uint64_t hash = G_HASH_SEED;
+    hash = g_hash_bytes(hash, &world->tick, sizeof(world->tick));
+    hash = g_hash_bytes(hash, alive->indices,
+                        sizeof(stable_index_t) * alive->size);
+
+    for (size_t i = 0; i < alive->size; i++) {
+        const stable_index_t idx = alive->indices[i];
+
+        hash = g_hash_bytes(hash, &actors->transforms[idx],
+                            sizeof(g_transform));
+        hash = g_hash_bytes(hash, &actors->velocities[idx],
+                            sizeof(g_velocity));
+    }
+
+    const g_projectiles *projectiles = &world->projectiles;
+    hash = g_hash_bytes(hash, &projectiles->size, sizeof(projectiles->size));
+    hash = g_hash_bytes(hash, projectiles->pos_x,
+                        sizeof(float) * projectiles->size);
+    hash = g_hash_bytes(hash, projectiles->pos_y,
+                        sizeof(float) * projectiles->size);
+
+    return hash;
 }
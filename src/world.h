@@ -1,13 +1,70 @@
 #ifndef WORLD_H
 #define WORLD_H
 
+#include "ailod.h"
 #include "common.h"
+#include "flow.h"
+#include "formation.h"
+#include "level.h"
+#include "pack.h"
+#include "particle.h"
+#include "projectile.h"
+#include "replay.h"
+#include "rewind.h"
+#include "scheduler.h"
+#include "spatial.h"
 
 static const float g_fixed_dt = 1.0f / 64;
 
-typedef struct {
+// Transient data of a g_world_update, like projectile hits
+#define G_WORLD_TICK_ARENA_SIZE ((size_t)256 << 10)
+// Enough for every batch of a generated level
+#define G_WORLD_STATIC_MESHES                                                  \
+    (G_LEVEL_MAX_CHUNKS * G_LEVEL_MAX_CHUNKS + 1)
+// sg_desc.buffer_pool_size with room for a buffer per static mesh
+#define G_WORLD_BUFFER_POOL_SIZE (G_WORLD_STATIC_MESHES + 128)
+
+// Parts of g_world_update whose wall time is tracked, for benchmarks.
+enum g_world_stage : uint8_t {
+    G_WORLD_STAGE_PHYSICS,
+    G_WORLD_STAGE_GRID,
+    G_WORLD_STAGE_PLAYER,
+    G_WORLD_STAGE_FLOW,
+    G_WORLD_STAGE_AI_LOD,
+    G_WORLD_STAGE_ALLIES,
+    G_WORLD_STAGE_ENEMIES,
+    G_WORLD_STAGE_PROJECTILES,
+    G_WORLD_STAGE_PARTICLES,
+    G_WORLD_STAGE_TRANSFORM,
+    G_WORLD_STAGE_COUNT,
+};
+
+extern const char *const g_world_stage_names[G_WORLD_STAGE_COUNT];
+
+typedef struct g_world {
+    // Backs the actor stack and static meshes, accounted per tag.
+    g_allocator *allocator;
+    // Reset at the top of g_world_update, and rewound after every tick.
+    g_arena tick_arena;
+
     g_actor_stack actors;
     g_static_meshes static_meshes;
+    // Optional, from the generated level the static meshes show.
+    const g_level_walls *walls;
+    // Parameters of that level, zeroed without walls.
+    g_level_params level;
+
+    // Rebuilt every fixed tick, after physics.
+    g_actor_grid grid;
+    // Toward the player, rebuilt every G_FLOW_INTERVAL ticks.
+    g_flow_field flow;
+    // Ally slots around the player.
+    g_formation formation;
+    // Enemies and allies due for an AI update, replanned every fixed tick.
+    g_ai_lod ai_lod;
+    g_projectiles projectiles;
+    // Visual only, updated with the frame delta.
+    g_particles particles;
 
     g_camera camera;
     g_player player;
@@ -18,10 +75,50 @@ typedef struct {
     uint64_t elapsed_time;
 
     float physics_tick;
+    g_tick_scheduler scheduler;
+    // Fixed ticks simulated so far
+    uint64_t tick;
+
+    uint64_t seed;
+    g_rng rng;
+
+    // Wall time spent in every stage so far, in sokol_time ticks
+    uint64_t stage_time[G_WORLD_STAGE_COUNT];
+
+    // Optional, records or plays back the input of every fixed tick.
+    g_replay *replay;
+    // Optional, keeps the state of recent fixed ticks for rewinding.
+    g_rewind *rewind;
 } g_world;
 
-void g_world_init(g_world *world);
+// Particles get a stream of their own, apart from the world's rng.
+static inline uint64_t g_world_particle_seed(uint64_t seed) {
+    return seed ^ 0x9e3779b97f4a7c15ULL;
+}
+
+// Everything random in the simulation derives from seed. Returns false if
+// allocator runs out of memory.
+bool g_world_init(g_world *world, g_allocator *allocator, uint64_t seed);
 void g_world_update(float dt, g_world *world);
 void g_world_delete(g_world *world);
 
+// Replace the static meshes with a level from pack, which must stay open
+// while the world uses them.
+bool g_world_load_level(g_world *world, const g_pack *pack, const char *name);
+
+// Replace the static meshes with the batches of a generated level, and its
+// walls. The level must stay alive while the world uses them.
+bool g_world_load_generated(g_world *world, const g_level *level);
+
+// Restore the state after a past fixed tick kept by world->rewind, dropping
+// the newer history.
+bool g_world_rewind(g_world *world, uint64_t tick);
+
+// Rewind to tick, then simulate back up to the current tick with the current
+// input. Returns false if tick is no longer kept.
+bool g_world_resimulate(g_world *world, uint64_t tick);
+
+// Hash of the simulation state, for divergence checks.
+uint64_t g_world_hash(const g_world *world);
+
 #endif
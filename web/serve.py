@@ -0,0 +1,23 @@
+#!/usr/bin/env python3
+# Serves a web build with the cross origin isolation headers the threaded
+# build (CTRI_WEB_THREADS) needs for SharedArrayBuffer.
+#
+#   python3 web/serve.py [DIR] [PORT]
+import http.server
+import sys
+
+
+class Handler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+
+
+directory = sys.argv[1] if len(sys.argv) > 1 else "build"
+port = int(sys.argv[2]) if len(sys.argv) > 2 else 8000
+
+handler = lambda *args: Handler(*args, directory=directory)
+with http.server.ThreadingHTTPServer(("", port), handler) as server:
+    print(f"Serving {directory} on http://localhost:{port}")
+    server.serve_forever()